@@ -0,0 +1,186 @@
+/*
+ * @compile_bench.c
+ *
+ * @brief C for Stack VM
+ * @details
+ * Compiler throughput on an input file in three modes: lexing only, lexing and
+ * parsing, and the full compilation (inlining and code generation, output
+ * discarded). Each mode runs in a child process so its peak RSS is its own,
+ * and reports the best of -r runs as one JSON object per line for tracking
+ * over commits.
+ *
+ *   gcc -O2 -pthread -Icompiler/include bench/compile_bench.c compiler/[a-z]*.c -o compile_bench
+ *   ./corpus_gen > corpus.c
+ *   ./compile_bench [-r runs] [-m lex|parse|full] corpus.c tests/nqueen.c
+ *
+ * @author Emiliano Augusto Gonzalez (egonzalez . hiperion @ gmail . com)
+ * @date 2024
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/stackvm_c_compiler
+ */
+
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "c_stackvm.h"
+#include "arena.h"
+#include "context.h"
+#include "codegenir.h"
+#include "inliner.h"
+#include "lexer.h"
+#include "output.h"
+#include "parser.h"
+#include "preprocess.h"
+#include "util.h"
+
+enum {
+    MODE_LEX,
+    MODE_PARSE,
+    MODE_FULL,
+    MODES
+};
+
+static const char *modes[MODES] = { "lex", "parse", "full" };
+
+typedef struct {
+           double secs;
+    unsigned long tokens;
+    unsigned long nodes;
+    unsigned long allocs;
+    unsigned long bytes;
+} bench_result_t;
+
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void bench_compile(int mode, preprocess_buffer_t *src, FILE *null, bench_result_t *r) {
+    jmp_buf on_error;
+    arena_stats_t stats;
+    compiler_ctx_t *ctx = compiler_ctx_make();
+
+    compiler_ctx_enter(ctx);
+    ctx->outfp = null;
+    ctx->on_error = &on_error;
+    if (setjmp(on_error)) {
+        fprintf(stderr, "compile_bench: the input does not compile\n");
+        exit(1);
+    }
+
+    lexer_set_buffer(ctx, src->body, src->len);
+    double t0 = bench_now();
+    if (mode == MODE_LEX) {
+        while (get_ttype(lexer_read_token(ctx)) != TTYPE_NULL)
+            r->tokens++;
+    } else {
+        list_t *toplevels = parser_read_toplevels(ctx);
+        // the inliner makes nodes too
+        r->nodes = ctx->parser.nodes;
+        if (mode == MODE_FULL) {
+            inliner_run(ctx, toplevels);
+            codegenir_emit_data_section(ctx);
+            for (iter_t i = list_iter(toplevels); !list_iter_end(i);)
+                codegenir_emit_toplevel(ctx, list_iter_next(&i));
+            codegenir_emit_end(ctx);
+            output_flush(ctx);
+        }
+    }
+    r->secs = bench_now() - t0;
+
+    arena_get_stats(util_arena_root(), &stats);
+    r->allocs = stats.allocs;
+    r->bytes = stats.bytes;
+    lexer_close(ctx);
+    compiler_ctx_free(ctx);
+}
+
+static void bench_mode(int mode, char *path, int runs) {
+    preprocess_buffer_t src = { 0 };
+    bench_result_t best = { 0 }, r;
+    struct rusage ru;
+    FILE *fp = fopen(path, "r"), *null = fopen("/dev/null", "w");
+
+    if (!fp || !null) {
+        fprintf(stderr, "compile_bench: can't open %s\n", fp ? "/dev/null" : path);
+        exit(1);
+    }
+    preprocess_file(fp, &src);
+    fclose(fp);
+
+    for (int n = 0; n < runs; n++) {
+        memset(&r, 0, sizeof(r));
+        bench_compile(mode, &src, null, &r);
+        if (!n || r.secs < best.secs)
+            best = r;
+    }
+    // the token count of the other modes, from a run that is not timed
+    if (mode != MODE_LEX) {
+        memset(&r, 0, sizeof(r));
+        bench_compile(MODE_LEX, &src, null, &r);
+        best.tokens = r.tokens;
+    }
+    getrusage(RUSAGE_SELF, &ru);
+
+    printf("{\"input\":\"%s\",\"mode\":\"%s\",\"bytes\":%zu,\"runs\":%d,\"seconds\":%.6f,\"tokens\":%lu,\"nodes\":%lu,"
+            "\"tokens_per_s\":%.0f,\"nodes_per_s\":%.0f,\"peak_rss_kb\":%ld,\"allocs\":%lu,\"alloc_bytes\":%lu,\"allocs_per_node\":%.2f}\n",
+            path, modes[mode], src.len, runs, best.secs, best.tokens, best.nodes, best.tokens / best.secs, mode == MODE_LEX ? 0 : best.nodes / best.secs,
+            ru.ru_maxrss, best.allocs, best.bytes, best.nodes ? (double) best.allocs / best.nodes : 0);
+    fflush(stdout);
+    preprocess_free(&src);
+    fclose(null);
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: compile_bench [-r runs] [-m lex|parse|full] file...\n");
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    int runs = 5, only = -1, first = 1;
+
+    for (; first < argc && argv[first][0] == '-'; first += 2) {
+        if (first + 1 >= argc)
+            usage();
+        if (!strcmp(argv[first], "-r")) {
+            if ((runs = atoi(argv[first + 1])) < 1)
+                usage();
+        } else if (!strcmp(argv[first], "-m")) {
+            for (only = 0; only < MODES && strcmp(argv[first + 1], modes[only]); only++)
+                ;
+            if (only == MODES)
+                usage();
+        } else
+            usage();
+    }
+    if (first >= argc)
+        usage();
+
+    for (int n = first; n < argc; n++) {
+        for (int mode = 0; mode < MODES; mode++) {
+            if (only >= 0 && mode != only)
+                continue;
+            pid_t pid = fork();
+            if (pid < 0) {
+                perror("fork");
+                return 1;
+            }
+            if (!pid) {
+                bench_mode(mode, argv[n], runs);
+                exit(0);
+            }
+            int status;
+            waitpid(pid, &status, 0);
+            if (!WIFEXITED(status) || WEXITSTATUS(status))
+                return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,28 @@
+#! /bin/bash
+#
+# Compile throughput of the synthetic corpus shapes and the test programs.
+# Prints one JSON object per line, tagged with the commit, e.g.
+#   bench/compile_bench.sh >> bench-results.jsonl
+#
+
+set -e
+cd "$(dirname "$0")/.."
+
+out=$(mktemp -d)
+trap 'rm -rf "$out"' EXIT
+
+gcc -O2 bench/corpus_gen.c -o "$out/corpus_gen"
+gcc -O2 -pthread -Icompiler/include bench/compile_bench.c compiler/[a-z]*.c -o "$out/compile_bench"
+
+"$out/corpus_gen"                                     > "$out/mixed.c"
+"$out/corpus_gen" -f 5000 -d 1 -s 1 -e 1 -a 1         > "$out/functions.c"
+"$out/corpus_gen" -f 1 -d 500 -s 1 -e 1 -a 1          > "$out/nesting.c"
+"$out/corpus_gen" -f 1 -d 1 -s 5000 -e 1 -a 1         > "$out/structs.c"
+"$out/corpus_gen" -f 1 -d 1 -s 1 -e 20000 -a 1        > "$out/expressions.c"
+"$out/corpus_gen" -f 1 -d 1 -s 1 -e 1 -a 200000       > "$out/arrays.c"
+
+commit=$(git rev-parse --short HEAD 2>/dev/null || echo unknown)
+{
+    (cd "$out" && ./compile_bench -r "${RUNS:-5}" mixed.c functions.c nesting.c structs.c expressions.c arrays.c)
+    "$out/compile_bench" -r "${RUNS:-5}" tests/nqueen.c tests/struct.c
+} | sed "s/^{/{\"commit\":\"$commit\",/"
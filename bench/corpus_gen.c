@@ -0,0 +1,143 @@
+/*
+ * @corpus_gen.c
+ *
+ * @brief C for Stack VM
+ * @details
+ * Synthetic input for compile_bench, in the subset of C the parser accepts.
+ * Each shape stresses one part of the front end: many small functions, deeply
+ * nested blocks, large struct definitions, long expression chains and big array
+ * initializers. The output is a valid program, so it also runs on the VM.
+ *
+ *   gcc -O2 bench/corpus_gen.c -o corpus_gen
+ *   ./corpus_gen [-f functions] [-d depth] [-s fields] [-e terms] [-a elements] [-x scale] > corpus.c
+ *
+ * @author Emiliano Augusto Gonzalez (egonzalez . hiperion @ gmail . com)
+ * @date 2024
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/stackvm_c_compiler
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int functions = 2000;
+static int depth = 64;
+static int fields = 256;
+static int terms = 512;
+static int elements = 4096;
+
+// small functions calling the previous one, with a loop and a branch
+static void gen_functions(void) {
+    for (int n = 0; n < functions; n++) {
+        printf("int f%d(int a, int b)\n{\n", n);
+        printf("    int s = 0;\n");
+        printf("    int i;\n");
+        printf("    for (i = 0; i < a; i++) {\n");
+        printf("        if ((i & 3) == %d)\n", n % 4);
+        printf("            s = s + i * b;\n");
+        printf("        else\n");
+        printf("            s = s - %d;\n", n % 17);
+        printf("    }\n");
+        if (n)
+            printf("    return s + (f%d(a - 1, b) & 7);\n", n - 1);
+        else
+            printf("    return s;\n");
+        printf("}\n\n");
+    }
+}
+
+// depth nested blocks, each with a local and a branch
+static void gen_nested(void) {
+    printf("int nested(int x)\n{\n    int r = 0;\n");
+    for (int n = 0; n < depth; n++) {
+        printf("%*s{\n", 4 + n * 4, "");
+        printf("%*sint v%d = x + %d;\n", 8 + n * 4, "", n, n);
+        printf("%*sif (v%d > %d)\n", 8 + n * 4, "", n, n * 2);
+        printf("%*sr = r + v%d;\n", 12 + n * 4, "", n);
+    }
+    for (int n = depth - 1; n >= 0; n--)
+        printf("%*s}\n", 4 + n * 4, "");
+    printf("    return r;\n}\n\n");
+}
+
+static void gen_struct(void) {
+    static const char *types[] = { "int", "char", "float", "int*" };
+
+    printf("int big_struct()\n{\n    struct big {\n");
+    for (int n = 0; n < fields; n++)
+        printf("        %s m%d;\n", types[n % 4], n);
+    printf("    } s;\n");
+    for (int n = 0; n < fields; n += 4)
+        printf("    s.m%d = %d;\n", n, n);
+    printf("    return s.m0 + s.m%d;\n}\n\n", (fields - 1) / 4 * 4);
+}
+
+static void gen_expr(void) {
+    static const char *ops[] = { "+", "-", "*", "+", "-" };
+
+    printf("int expr_chain(int a, int b, int c)\n{\n    return a");
+    for (int n = 0; n < terms; n++)
+        printf("%s %s %s(%d %s b)", n % 8 ? "" : "\n          ", ops[n % 5], n % 3 ? "" : "c * ", n % 100, n % 2 ? "+" : "-");
+    printf(";\n}\n\n");
+}
+
+static void gen_array(void) {
+    printf("int big_array[%d] = {", elements);
+    for (int n = 0; n < elements; n++)
+        printf("%s%d", n % 16 ? ", " : (n ? ",\n    " : "\n    "), (n * 7919) % 1000);
+    printf("\n};\n\n");
+    printf("int array_sum()\n{\n    int local[%d] = {", elements / 4);
+    for (int n = 0; n < elements / 4; n++)
+        printf("%s%d", n % 16 ? ", " : (n ? ",\n        " : "\n        "), n % 100);
+    printf("\n    };\n    int s = 0;\n    int i;\n");
+    printf("    for (i = 0; i < %d; i++)\n        s = s + local[i] + big_array[i];\n", elements / 4);
+    printf("    return s;\n}\n\n");
+}
+
+static int arg_int(char *s) {
+    char *end;
+    long n = strtol(s ? s : "", &end, 10);
+
+    if (*end || n < 1) {
+        fprintf(stderr, "usage: corpus_gen [-f functions] [-d depth] [-s fields] [-e terms] [-a elements] [-x scale]\n");
+        exit(1);
+    }
+    return n;
+}
+
+int main(int argc, char **argv) {
+    for (int n = 1; n < argc; n++) {
+        char *v = n + 1 < argc ? argv[n + 1] : NULL;
+        if (!strcmp(argv[n], "-f"))
+            functions = arg_int(v);
+        else if (!strcmp(argv[n], "-d"))
+            depth = arg_int(v);
+        else if (!strcmp(argv[n], "-s"))
+            fields = arg_int(v);
+        else if (!strcmp(argv[n], "-e"))
+            terms = arg_int(v);
+        else if (!strcmp(argv[n], "-a"))
+            elements = arg_int(v);
+        else if (!strcmp(argv[n], "-x")) {
+            int x = arg_int(v);
+            functions *= x;
+            fields *= x;
+            terms *= x;
+            elements *= x;
+        } else
+            arg_int(NULL);
+        n++;
+    }
+
+    printf("/* generated by corpus_gen: %d functions, depth %d, %d fields, %d terms, %d elements */\n\n", functions, depth, fields, terms, elements);
+    gen_array();
+    gen_functions();
+    gen_nested();
+    gen_struct();
+    gen_expr();
+    printf("int main()\n{\n");
+    printf("    int r = f%d(3, 2) + nested(1) + big_struct() + expr_chain(1, 2, 3) + array_sum();\n", functions - 1);
+    printf("    printf(\"%%d\\n\", r);\n    return 0;\n}\n");
+    return 0;
+}
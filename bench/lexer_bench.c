@@ -0,0 +1,111 @@
+/*
+ * @lexer_bench.c
+ *
+ * @brief C for Stack VM
+ * @details
+ * Lexer throughput of the stdio path (getc on stdin) against the memory mapped path.
+ * The input files are repeated until the corpus reaches the requested size.
+ *
+ *   gcc -O2 -Icompiler/include bench/lexer_bench.c compiler/lexer.c compiler/intern.c \
+ *       compiler/arena.c compiler/util.c compiler/list.c compiler/context.c -o lexer_bench
+ *   ./lexer_bench [-m MB] tests/nqueen.c tests/struct.c
+ *
+ * @author Emiliano Augusto Gonzalez (egonzalez . hiperion @ gmail . com)
+ * @date 2024
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/stackvm_c_compiler
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "c_stackvm.h"
+#include "context.h"
+#include "arena.h"
+#include "util.h"
+#include "lexer.h"
+
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static long bench_lex(compiler_ctx_t *ctx) {
+    long tokens = 0;
+    while (get_ttype(lexer_read_token(ctx)) != TTYPE_NULL)
+        tokens++;
+    return tokens;
+}
+
+static void bench_report(char *name, long tokens, double secs, size_t bytes) {
+    arena_stats_t stats;
+    arena_get_stats(util_arena_root(), &stats);
+    printf("%-8s %10ld tokens %8.3f s %9.1f MB/s %10.0f tokens/s %10lu allocs\n", name, tokens, secs, bytes / secs / (1024 * 1024), tokens / secs,
+            stats.allocs);
+    util_free_all();
+}
+
+int main(int argc, char **argv) {
+    size_t target = 32 * 1024 * 1024;
+    char tmpfname[] = "/tmp/lexer_benchXXXXXX";
+    int first = 1;
+    compiler_ctx_t *ctx = compiler_ctx_make();
+
+    compiler_ctx_enter(ctx);
+    if (argc > 2 && !strcmp(argv[1], "-m")) {
+        target = (size_t) atol(argv[2]) * 1024 * 1024;
+        first = 3;
+    }
+    if (first >= argc) {
+        fprintf(stderr, "usage: lexer_bench [-m MB] file...\n");
+        return 1;
+    }
+
+    int fd = mkstemp(tmpfname);
+    FILE *out = fdopen(fd, "w");
+    size_t bytes = 0;
+    while (bytes < target) {
+        for (int n = first; n < argc; n++) {
+            FILE *in = fopen(argv[n], "r");
+            if (!in) {
+                fprintf(stderr, "can't open %s\n", argv[n]);
+                return 1;
+            }
+            char buf[65536];
+            size_t len;
+            while ((len = fread(buf, 1, sizeof(buf), in)) > 0) {
+                fwrite(buf, 1, len, out);
+                bytes += len;
+            }
+            fclose(in);
+        }
+    }
+    fclose(out);
+
+    if (!freopen(tmpfname, "r", stdin)) {
+        fprintf(stderr, "can't reopen %s\n", tmpfname);
+        return 1;
+    }
+    double t0 = bench_now();
+    long tokens = bench_lex(ctx);
+    bench_report("stdio", tokens, bench_now() - t0, bytes);
+
+    if (!lexer_map_file(ctx, tmpfname)) {
+        fprintf(stderr, "can't map %s\n", tmpfname);
+        return 1;
+    }
+    t0 = bench_now();
+    long mapped = bench_lex(ctx);
+    bench_report("mmap", mapped, bench_now() - t0, bytes);
+    lexer_close(ctx);
+
+    remove(tmpfname);
+    if (tokens != mapped) {
+        fprintf(stderr, "token count differs: %ld %ld\n", tokens, mapped);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,112 @@
+/*
+ * @symtab_bench.c
+ *
+ * @brief C for Stack VM
+ * @details
+ * Scope handling and lookup cost of symtab_t against the dict_t parent chain
+ * on deeply nested scopes.
+ *
+ *   gcc -O2 -Icompiler/include bench/symtab_bench.c compiler/symtab.c compiler/dict.c \
+ *       compiler/list.c compiler/intern.c compiler/arena.c compiler/util.c compiler/context.c -o symtab_bench
+ *
+ * @author Emiliano Augusto Gonzalez (egonzalez . hiperion @ gmail . com)
+ * @date 2024
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/stackvm_c_compiler
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "util.h"
+#include "dict.h"
+#include "context.h"
+#include "intern.h"
+#include "symtab.h"
+
+#define VARS_PER_SCOPE 4
+#define ROUNDS         20
+
+static char **names;
+
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// every scope declares its own names and shadows "x", then every name is looked up from the innermost scope
+static long bench_dict(int depth) {
+    long found = 0;
+    for (int r = 0; r < ROUNDS; r++) {
+        dict_t *env = dict_make(NULL);
+        for (int d = 0; d < depth; d++) {
+            env = dict_make(env);
+            dict_put(env, "x", (void*) (long) (d + 1));
+            for (int k = 0; k < VARS_PER_SCOPE; k++)
+                dict_put(env, names[d * VARS_PER_SCOPE + k], (void*) (long) (d + 1));
+        }
+        for (int n = 0; n < depth * VARS_PER_SCOPE; n++)
+            found += (long) dict_get(env, names[n]);
+        found += (long) dict_get(env, "x");
+        for (int d = 0; d < depth; d++)
+            env = dict_parent(env);
+    }
+    return found;
+}
+
+static long bench_symtab(compiler_ctx_t *ctx, int depth) {
+    long found = 0;
+    char *x = intern_cstring(ctx, "x");
+    for (int r = 0; r < ROUNDS; r++) {
+        symtab_t *env = symtab_make();
+        for (int d = 0; d < depth; d++) {
+            symtab_push(env);
+            symtab_put(env, x, (void*) (long) (d + 1));
+            for (int k = 0; k < VARS_PER_SCOPE; k++)
+                symtab_put(env, names[d * VARS_PER_SCOPE + k], (void*) (long) (d + 1));
+        }
+        for (int n = 0; n < depth * VARS_PER_SCOPE; n++)
+            found += (long) symtab_get(env, names[n]);
+        found += (long) symtab_get(env, x);
+        for (int d = 0; d < depth; d++)
+            symtab_pop(env);
+        if (symtab_get(env, x))
+            util_error("binding survived its scope");
+    }
+    return found;
+}
+
+int main(void) {
+    int depths[] = { 8, 64, 256, 1024 };
+    compiler_ctx_t *ctx = compiler_ctx_make();
+
+    compiler_ctx_enter(ctx);
+
+    printf("%8s %14s %14s %10s\n", "depth", "dict (ms)", "symtab (ms)", "speedup");
+    for (int i = 0; i < sizeof(depths) / sizeof(depths[0]); i++) {
+        int depth = depths[i];
+        names = malloc(depth * VARS_PER_SCOPE * sizeof(char*));
+        for (int n = 0; n < depth * VARS_PER_SCOPE; n++) {
+            char buf[32];
+            snprintf(buf, sizeof(buf), "v%d", n);
+            names[n] = intern_cstring(ctx, buf);
+        }
+
+        double t0 = bench_now();
+        long a = bench_dict(depth);
+        double t1 = bench_now();
+        long b = bench_symtab(ctx, depth);
+        double t2 = bench_now();
+
+        if (a != b)
+            util_error("lookup results differ: %ld %ld", a, b);
+        printf("%8d %14.3f %14.3f %9.1fx\n", depth, (t1 - t0) * 1e3, (t2 - t1) * 1e3, (t1 - t0) / (t2 - t1));
+
+        free(names);
+        util_free_all();
+    }
+
+    return 0;
+}
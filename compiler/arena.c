@@ -0,0 +1,182 @@
+/*
+ * @arena.c
+ *
+ * @brief C for Stack VM
+ * @details
+ * This is based on other projects:
+ *   A minimalist C compiler with x86_64 code generation: https://github.com/jserv/MazuCC
+ *   Others (see individual files)
+ *
+ *   please contact their authors for more information.
+ *
+ * @author Emiliano Augusto Gonzalez (egonzalez . hiperion @ gmail . com)
+ * @date 2024
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/stackvm_c_compiler
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+#define arena_align_up(n) (((n) + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1))
+
+static void* arena_xmalloc(size_t size) {
+    void *r = malloc(size);
+    if (!r) {
+        fprintf(stderr, "arena: out of memory (%zu bytes)\n", size);
+        exit(1);
+    }
+    return r;
+}
+
+// reserved bytes are accounted on the arena and on every ancestor
+static void arena_account(arena_t *arena, long delta) {
+    for (; arena; arena = arena->parent) {
+        arena->stats.reserved += delta;
+        if (arena->stats.reserved > arena->stats.peak)
+            arena->stats.peak = arena->stats.reserved;
+    }
+}
+
+static arena_chunk_t* arena_new_chunk(arena_t *arena, size_t size) {
+    arena_chunk_t *c = arena_xmalloc(sizeof(arena_chunk_t) + size);
+    c->next = NULL;
+    c->size = size;
+    c->used = 0;
+    c->last = 0;
+    arena->stats.chunks++;
+    arena_account(arena, sizeof(arena_chunk_t) + size);
+    return c;
+}
+
+static void arena_free_chunks(arena_t *arena, arena_chunk_t *c) {
+    while (c) {
+        arena_chunk_t *next = c->next;
+        arena_account(arena, -(long) (sizeof(arena_chunk_t) + c->size));
+        free(c);
+        c = next;
+    }
+}
+
+static void arena_unlink(arena_t *arena) {
+    if (!arena->parent)
+        return;
+    if (arena->prev)
+        arena->prev->next = arena->next;
+    else
+        arena->parent->child = arena->next;
+    if (arena->next)
+        arena->next->prev = arena->prev;
+}
+
+arena_t* arena_make(arena_t *parent, size_t chunk_size) {
+    arena_t *r = arena_xmalloc(sizeof(arena_t));
+    memset(r, 0, sizeof(arena_t));
+    r->chunk_size = chunk_size ? arena_align_up(chunk_size) : ARENA_CHUNK_SIZE;
+    r->parent = parent;
+    if (parent) {
+        r->next = parent->child;
+        if (parent->child)
+            parent->child->prev = r;
+        parent->child = r;
+    }
+    return r;
+}
+
+void* arena_alloc(arena_t *arena, size_t size) {
+    arena_chunk_t *c = arena->chunk;
+    size_t asize = arena_align_up(size ? size : 1);
+
+    arena->stats.allocs++;
+    arena->stats.bytes += size;
+
+    if (c && c->size - c->used >= asize) {
+        c->last = c->used;
+        c->used += asize;
+        return c->data + c->last;
+    }
+
+    // big blocks get their own chunk behind the current one, so the bump pointer is kept
+    if (c && asize > arena->chunk_size / 4) {
+        arena_chunk_t *big = arena_new_chunk(arena, asize);
+        big->used = asize;
+        big->next = c->next;
+        c->next = big;
+        return big->data;
+    }
+
+    c = arena_new_chunk(arena, asize > arena->chunk_size ? asize : arena->chunk_size);
+    c->next = arena->chunk;
+    arena->chunk = c;
+    c->used = asize;
+    return c->data;
+}
+
+void* arena_calloc(arena_t *arena, size_t size) {
+    void *r = arena_alloc(arena, size);
+    memset(r, 0, size);
+    return r;
+}
+
+void* arena_realloc(arena_t *arena, void *ptr, size_t old_size, size_t new_size) {
+    arena_chunk_t *c = arena->chunk;
+
+    if (!ptr)
+        return arena_alloc(arena, new_size);
+
+    if (c && (char*) ptr == c->data + c->last) {
+        size_t asize = arena_align_up(new_size);
+        if (c->last + asize <= c->size) {
+            arena->stats.bytes += new_size > old_size ? new_size - old_size : 0;
+            c->used = c->last + asize;
+            return ptr;
+        }
+    }
+
+    void *r = arena_alloc(arena, new_size);
+    memcpy(r, ptr, old_size < new_size ? old_size : new_size);
+    arena_free(arena, ptr);
+    return r;
+}
+
+bool arena_free(arena_t *arena, void *ptr) {
+    arena_chunk_t *c = arena->chunk;
+
+    if (!c || (char*) ptr != c->data + c->last || c->last == c->used)
+        return false;
+    c->used = c->last;
+    return true;
+}
+
+void arena_release(arena_t *arena) {
+    if (!arena)
+        return;
+    while (arena->child)
+        arena_release(arena->child);
+
+    arena_free_chunks(arena, arena->chunk);
+    arena->chunk = NULL;
+
+    // keep the work done by a released sub-arena visible in the counters of its parent
+    if (arena->parent) {
+        arena->parent->stats.allocs += arena->stats.allocs;
+        arena->parent->stats.bytes += arena->stats.bytes;
+        arena->parent->stats.chunks += arena->stats.chunks;
+    }
+    arena_unlink(arena);
+    free(arena);
+}
+
+void arena_get_stats(arena_t *arena, arena_stats_t *stats) {
+    *stats = arena->stats;
+    for (arena_t *a = arena->child; a; a = a->next) {
+        arena_stats_t sub;
+        arena_get_stats(a, &sub);
+        stats->allocs += sub.allocs;
+        stats->bytes += sub.bytes;
+        stats->chunks += sub.chunks;
+    }
+}
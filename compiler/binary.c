@@ -0,0 +1,255 @@
+/*
+ * @binary.c
+ *
+ * @brief C for Stack VM
+ * @details
+ * This is based on other projects:
+ *   A minimalist C compiler with x86_64 code generation: https://github.com/jserv/MazuCC
+ *   Others (see individual files)
+ *
+ *   please contact their authors for more information.
+ *
+ * @author Emiliano Augusto Gonzalez (egonzalez . hiperion @ gmail . com)
+ * @date 2024
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/stackvm_c_compiler
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "c_stackvm.h"
+#include "context.h"
+#include "intern.h"
+#include "symtab.h"
+#include "util.h"
+#include "output.h"
+#include "binary.h"
+
+enum {
+    FIX_DATA, // gaddr operand
+    FIX_CALL, // call operand
+};
+
+static void binary_reserve(binary_buf_t *buf, size_t len) {
+    size_t cap = buf->cap;
+
+    if (buf->len + len <= cap)
+        return;
+    while (buf->len + len > cap)
+        cap = cap ? cap * 2 : 4096;
+    buf->body = util_heap(buf->body, buf->cap, cap);
+    buf->cap = cap;
+}
+
+static void binary_put(binary_buf_t *buf, uint64_t val, int size) {
+    binary_reserve(buf, size);
+    for (int n = 0; n < size; n++)
+        buf->body[buf->len++] = (val >> (8 * n)) & 0xff;
+}
+
+static void binary_append(binary_buf_t *buf, const void *ptr, size_t len) {
+    if (!len)
+        return;
+    binary_reserve(buf, len);
+    memcpy(buf->body + buf->len, ptr, len);
+    buf->len += len;
+}
+
+static void binary_patch32(binary_buf_t *buf, size_t pos, uint32_t val) {
+    for (int n = 0; n < 4; n++)
+        buf->body[pos + n] = (val >> (8 * n)) & 0xff;
+}
+
+static void binary_define(compiler_ctx_t *ctx, symtab_t **syms, char *name, size_t off) {
+    if (!*syms)
+        *syms = symtab_make();
+    name = intern_cstring(ctx, name);
+    if (symtab_get(*syms, name))
+        util_error("Symbol %s is already defined", name);
+    symtab_put(*syms, name, (void*) (uintptr_t) (off + 1));
+}
+
+static bool binary_lookup(compiler_ctx_t *ctx, symtab_t *syms, char *name, uint32_t *off) {
+    uintptr_t v = syms ? (uintptr_t) symtab_get(syms, intern_cstring(ctx, name)) : 0;
+    *off = v ? v - 1 : 0;
+    return v != 0;
+}
+
+static void binary_add_fixup(compiler_ctx_t *ctx, int kind, char *name) {
+    if (ctx->binary.nfixups == ctx->binary.fixups_cap) {
+        int cap = ctx->binary.fixups_cap ? ctx->binary.fixups_cap * 2 : 64;
+        ctx->binary.fixups = util_heap(ctx->binary.fixups, ctx->binary.fixups_cap * sizeof(binary_fixup_t), cap * sizeof(binary_fixup_t));
+        ctx->binary.fixups_cap = cap;
+    }
+    ctx->binary.fixups[ctx->binary.nfixups].pos = ctx->binary.code.len;
+    ctx->binary.fixups[ctx->binary.nfixups].name = name;
+    ctx->binary.fixups[ctx->binary.nfixups].kind = kind;
+    ctx->binary.nfixups++;
+}
+
+int binary_insn_len(int op) {
+    switch (opcodes_info(op)->operand) {
+        case OPND_NONE:
+            return 1;
+        case OPND_CALL:
+            return 6;
+        case OPND_INT2:
+            return 9;
+        default:
+            return 5;
+    }
+}
+
+void binary_data_label(compiler_ctx_t *ctx, char *name) {
+    binary_define(ctx, &ctx->binary.data_syms, name, ctx->binary.data.len);
+}
+
+void binary_data_align(compiler_ctx_t *ctx, int align) {
+    while (ctx->binary.data.len % align)
+        binary_put(&ctx->binary.data, 0, 1);
+}
+
+void binary_data_int(compiler_ctx_t *ctx, int size, int64_t val) {
+    binary_put(&ctx->binary.data, val, size);
+}
+
+void binary_data_bytes(compiler_ctx_t *ctx, const void *ptr, int len) {
+    binary_append(&ctx->binary.data, ptr, len);
+}
+
+void binary_data_zero(compiler_ctx_t *ctx, int len) {
+    binary_reserve(&ctx->binary.data, len);
+    memset(ctx->binary.data.body + ctx->binary.data.len, 0, len);
+    ctx->binary.data.len += len;
+}
+
+void binary_func(compiler_ctx_t *ctx, ir_func_t *func) {
+    int *labelpos = util_heap(NULL, 0, (func->nlabels + 1) * sizeof(int));
+    binary_fixup_t *pending = util_heap(NULL, 0, (func->len + 1) * sizeof(binary_fixup_t));
+    int npending = 0;
+
+    for (int n = 0; n < func->nlabels; n++)
+        labelpos[n] = -1;
+
+    binary_define(ctx, &ctx->binary.func_syms, func->name, ctx->binary.code.len);
+    for (int n = 0; n < func->len; n++) {
+        ir_insn_t *insn = &func->insns[n];
+        if (insn->op == IR_LABEL) {
+            labelpos[insn->label] = ctx->binary.code.len;
+            continue;
+        }
+        binary_put(&ctx->binary.code, insn->op, 1);
+        switch (opcodes_info(insn->op)->operand) {
+            case OPND_INT:
+                if (insn->ival < INT32_MIN || insn->ival > INT32_MAX)
+                    util_error("Immediate %ld out of range in %s", (long) insn->ival, func->name);
+                binary_put(&ctx->binary.code, (uint32_t) insn->ival, 4);
+                break;
+            case OPND_SYM:
+                binary_add_fixup(ctx, FIX_DATA, insn->sym);
+                binary_put(&ctx->binary.code, 0, 4);
+                break;
+            case OPND_LABEL:
+                // backward jumps are resolved now, forward ones when the function ends
+                if (labelpos[insn->label] < 0) {
+                    pending[npending].pos = ctx->binary.code.len;
+                    pending[npending].kind = insn->label;
+                    npending++;
+                }
+                binary_put(&ctx->binary.code, labelpos[insn->label] < 0 ? 0 : labelpos[insn->label], 4);
+                break;
+            case OPND_CALL:
+                binary_add_fixup(ctx, FIX_CALL, insn->sym);
+                binary_put(&ctx->binary.code, 0, 4);
+                binary_put(&ctx->binary.code, insn->nargs, 1);
+                break;
+            case OPND_INT2:
+                if (insn->ival < INT32_MIN || insn->ival > INT32_MAX)
+                    util_error("Immediate %ld out of range in %s", (long) insn->ival, func->name);
+                binary_put(&ctx->binary.code, (uint32_t) insn->ival, 4);
+                binary_put(&ctx->binary.code, (uint32_t) insn->imm, 4);
+                break;
+        }
+    }
+    for (int n = 0; n < npending; n++) {
+        int label = pending[n].kind;
+        if (labelpos[label] < 0)
+            util_error("internal error: label %s is not placed", func->labels[label]);
+        binary_patch32(&ctx->binary.code, pending[n].pos, labelpos[label]);
+    }
+    if (func->maxstack > ctx->binary.maxstack)
+        ctx->binary.maxstack = func->maxstack;
+
+    free(pending);
+    free(labelpos);
+}
+
+static uint32_t binary_extern(compiler_ctx_t *ctx, char *name) {
+    uint32_t idx;
+    if (binary_lookup(ctx, ctx->binary.extern_syms, name, &idx))
+        return idx;
+    if (!ctx->binary.externs)
+        ctx->binary.externs = list_make();
+    idx = list_len(ctx->binary.externs);
+    list_push(ctx->binary.externs, name);
+    binary_define(ctx, &ctx->binary.extern_syms, name, idx);
+    return idx;
+}
+
+static void binary_reset(compiler_ctx_t *ctx) {
+    free(ctx->binary.data.body);
+    free(ctx->binary.code.body);
+    free(ctx->binary.fixups);
+    memset(&ctx->binary.data, 0, sizeof(ctx->binary.data));
+    memset(&ctx->binary.code, 0, sizeof(ctx->binary.code));
+    ctx->binary.fixups = NULL;
+    ctx->binary.nfixups = ctx->binary.fixups_cap = 0;
+    ctx->binary.data_syms = ctx->binary.func_syms = ctx->binary.extern_syms = NULL;
+    ctx->binary.externs = NULL;
+    ctx->binary.maxstack = 0;
+}
+
+void binary_write(compiler_ctx_t *ctx) {
+    for (int n = 0; n < ctx->binary.nfixups; n++) {
+        binary_fixup_t *fix = &ctx->binary.fixups[n];
+        uint32_t off;
+        if (fix->kind == FIX_DATA) {
+            if (!binary_lookup(ctx, ctx->binary.data_syms, fix->name, &off))
+                util_error("Undefined symbol %s", fix->name);
+        } else if (!binary_lookup(ctx, ctx->binary.func_syms, fix->name, &off)) {
+            off = BINARY_EXTERN | binary_extern(ctx, fix->name);
+        }
+        binary_patch32(&ctx->binary.code, fix->pos, off);
+    }
+
+    uint32_t entry;
+    if (!binary_lookup(ctx, ctx->binary.func_syms, "main", &entry))
+        entry = BINARY_NONE;
+
+    // the sections are written as they are, not copied into an image
+    uint8_t body[BINARY_HEADER_LEN];
+    binary_buf_t header = { body, 0, sizeof(body) };
+    memcpy(header.body, BINARY_MAGIC, 4);
+    header.len = 4;
+    binary_put(&header, BINARY_VERSION, 2);
+    binary_put(&header, 0, 2);
+    binary_put(&header, ctx->binary.data.len, 4);
+    binary_put(&header, ctx->binary.code.len, 4);
+    binary_put(&header, entry, 4);
+    binary_put(&header, ctx->binary.externs ? list_len(ctx->binary.externs) : 0, 4);
+    binary_put(&header, ctx->binary.maxstack, 4);
+    binary_put(&header, 0, 4);
+    output_write(ctx, header.body, header.len);
+    output_write(ctx, ctx->binary.data.body, ctx->binary.data.len);
+    output_write(ctx, ctx->binary.code.body, ctx->binary.code.len);
+    for (iter_t i = list_iter(ctx->binary.externs ? ctx->binary.externs : &list_empty); !list_iter_end(i);) {
+        char *name = list_iter_next(&i);
+        int len = strlen(name);
+        if (len > 255)
+            util_error("Extern name too long: %s", name);
+        output_char(ctx, len);
+        output_write(ctx, name, len);
+    }
+    binary_reset(ctx);
+}
@@ -15,19 +15,29 @@
  * @see https://github.com/hiperiondev/stackvm_c_compiler
  */
 
-#include <stdarg.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "c_stackvm.h"
+#include "context.h"
 #include "parser.h"
 #include "util.h"
 #include "list.h"
+#include "symtab.h"
+#include "opcodes.h"
+#include "ir.h"
+#include "binary.h"
+#include "constpool.h"
+#include "frame.h"
+#include "output.h"
+#include "peephole.h"
+#include "strpool.h"
+#include "super.h"
+#include "trace.h"
+#include "verbose.h"
 #include "codegenir.h"
 
-extern FILE *outfp;
 static list_t *functions = &list_empty;
-extern list_t *strings;
-extern list_t *flonums;
 
 char* codegenir_get_caller_list(void) {
     string_t s = util_make_string();
@@ -39,41 +49,843 @@ char* codegenir_get_caller_list(void) {
     return util_get_cstring(s);
 }
 
-void codegenir_emitf(int line, char *fmt, ...) {
-    va_list args;
-    va_start(args, fmt);
-    int col = vfprintf(outfp, fmt, args);
-    va_end(args);
+// "\t<directive> <val>\n"
+static void codegenir_emit_int(compiler_ctx_t *ctx, char *directive, long val) {
+    output_char(ctx, '\t');
+    output_str(ctx, directive);
+    output_char(ctx, ' ');
+    output_int(ctx, val);
+    output_char(ctx, '\n');
+}
+
+void codegenir_set_binary(compiler_ctx_t *ctx, bool enable) {
+    ctx->codegen.binary = enable;
+}
+
+static void codegenir_section(compiler_ctx_t *ctx, char *name) {
+    if (ctx->codegen.section == name)
+        return;
+    if (!ctx->codegen.binary) {
+        output_char(ctx, '\t');
+        output_str(ctx, name);
+        output_char(ctx, '\n');
+    }
+    ctx->codegen.section = name;
+}
+
+static void codegenir_data_label(compiler_ctx_t *ctx, char *label) {
+    codegenir_section(ctx, ".data");
+    if (ctx->codegen.binary)
+        binary_data_label(ctx, label);
+    else {
+        output_str(ctx, label);
+        output_str(ctx, ":\n");
+    }
+}
+
+static void codegenir_data_align(compiler_ctx_t *ctx, int align) {
+    if (ctx->codegen.binary)
+        binary_data_align(ctx, align);
+    else
+        codegenir_emit_int(ctx, ".align", align);
+}
+
+static void codegenir_data_int(compiler_ctx_t *ctx, int size, long val) {
+    if (ctx->codegen.binary) {
+        binary_data_int(ctx, size, val);
+        return;
+    }
+    switch (size) {
+        case 1:
+            codegenir_emit_int(ctx, ".byte", val);
+            break;
+        case 4:
+            codegenir_emit_int(ctx, ".long", val);
+            break;
+        default:
+            codegenir_emit_int(ctx, ".quad", val);
+    }
+}
 
-    for (char *p = fmt; *p; p++)
-        if (*p == '\t')
-            col += TAB_LEN - 1;
+static void codegenir_data_float(compiler_ctx_t *ctx, float val) {
+    if (ctx->codegen.binary)
+        binary_data_bytes(ctx, &val, sizeof(val));
+    else
+        output_printf(ctx, "\t.float %.9g\n", val);
+}
 
-    fprintf(outfp, "\n");
+static void codegenir_data_string(compiler_ctx_t *ctx, char *str) {
+    if (ctx->codegen.binary) {
+        binary_data_bytes(ctx, str, strlen(str) + 1);
+        return;
+    }
+    char *cstr = util_quote_cstring(str);
+    output_str(ctx, "\t.string \"");
+    output_str(ctx, cstr);
+    output_str(ctx, "\"\n");
+    util_lfree(cstr);
 }
 
-void codegenir_emit_data_section(void) {
+static void codegenir_data_zero(compiler_ctx_t *ctx, int len) {
+    if (ctx->codegen.binary)
+        binary_data_zero(ctx, len);
+    else
+        codegenir_emit_int(ctx, ".zero", len);
+}
+
+void codegenir_emit_data_section(compiler_ctx_t *ctx) {
     //SAVE();
-    codegenir_emit(".data");
-    for (iter_t i = list_iter(strings); !list_iter_end(i);) {
-        ast_t *v = list_iter_next(&i);
-        codegenir_emit_label("%s:", v->slabel);
-        char *cstr = util_quote_cstring(v->sval);
-        codegenir_emit(".string \"%s\"", cstr);
-        util_lfree(cstr);
+    ctx->codegen.section = NULL;
+    ctx->codegen.strings_done = true;
+    codegenir_section(ctx, ".data");
+    for (iter_t i = list_iter(strpool_build(ctx, ctx->parser.strings)); !list_iter_end(i);) {
+        strpool_entry_t *entry = list_iter_next(&i);
+        int pos = 0;
+        // the text before the last label is emitted byte by byte, labels fall inside it
+        for (iter_t l = list_iter(entry->labels); !list_iter_end(l);) {
+            strpool_label_t *label = list_iter_next(&l);
+            while (pos < label->offset)
+                codegenir_data_int(ctx, 1, entry->str[pos++]);
+            codegenir_data_label(ctx, label->label);
+        }
+        codegenir_data_string(ctx, entry->str + pos);
     }
-    for (iter_t i = list_iter(flonums); !list_iter_end(i);) {
-        ast_t *v = list_iter_next(&i);
-        char *label = parser_make_label();
-        v->flabel = label;
-        codegenir_emit_label("%s:", label);
-        codegenir_emit(".long %d", v->lval[0]);
-        codegenir_emit(".long %d", v->lval[1]);
+}
+
+// float constants are emitted last, so the ones folded away never reach the image
+static void codegenir_emit_constpool(compiler_ctx_t *ctx) {
+    list_t *entries = constpool_entries(ctx);
+
+    if (!list_len(entries))
+        return;
+    codegenir_section(ctx, ".data");
+    for (iter_t i = list_iter(entries); !list_iter_end(i);) {
+        constpool_entry_t *e = list_iter_next(&i);
+        if (e->mt == MT_F32) {
+            codegenir_data_align(ctx, 4);
+            codegenir_data_label(ctx, e->label);
+            uint32_t bits = e->bits;
+            float val;
+            memcpy(&val, &bits, sizeof(val));
+            codegenir_data_float(ctx, val);
+        } else {
+            codegenir_data_align(ctx, 8);
+            codegenir_data_label(ctx, e->label);
+            codegenir_data_int(ctx, 4, (int32_t) e->bits);
+            codegenir_data_int(ctx, 4, (int32_t) (e->bits >> 32));
+        }
     }
 }
 
 ////////////////////////////////////////////////////////////////////////
 
-void codegenir_emit_toplevel(ast_t *v) {
+static void codegenir_gen_expr(compiler_ctx_t *ctx, ast_t *ast);
+static void codegenir_gen_stmt(compiler_ctx_t *ctx, ast_t *ast);
+
+static void codegenir_depth(compiler_ctx_t *ctx, int op, int nargs) {
+    const opcode_info_t *info = opcodes_info(op);
+    int pop = (info->pop < 0) ? nargs : info->pop;
+
+    if (ctx->codegen.depth < pop)
+        util_error("internal error: operand stack underflow at %s", info->name);
+    ctx->codegen.depth += info->push - pop;
+    if (ctx->codegen.depth > ctx->codegen.maxdepth)
+        ctx->codegen.maxdepth = ctx->codegen.depth;
+}
+
+static void codegenir_op(compiler_ctx_t *ctx, int op) {
+    codegenir_depth(ctx, op, 0);
+    ir_emit(ctx->codegen.func, op);
+}
+
+static void codegenir_op_int(compiler_ctx_t *ctx, int op, long imm) {
+    codegenir_depth(ctx, op, 0);
+    ir_emit_int(ctx->codegen.func, op, imm);
+}
+
+static void codegenir_op_sym(compiler_ctx_t *ctx, int op, char *sym) {
+    codegenir_depth(ctx, op, 0);
+    ir_emit_sym(ctx->codegen.func, op, sym);
+}
+
+static void codegenir_op_jump(compiler_ctx_t *ctx, int op, int label) {
+    codegenir_depth(ctx, op, 0);
+    ir_emit_jump(ctx->codegen.func, op, label);
+}
+
+static void codegenir_op_call(compiler_ctx_t *ctx, char *fname, int nargs) {
+    codegenir_depth(ctx, OP_CALL, nargs);
+    ir_emit_call(ctx->codegen.func, fname, nargs);
+
+    if (!ctx->codegen.called)
+        ctx->codegen.called = symtab_make();
+    if (!symtab_get(ctx->codegen.called, fname)) {
+        // kept for the .extern list, after the function is freed
+        arena_t *arena = util_set_arena(util_arena_root());
+        symtab_put(ctx->codegen.called, fname, fname);
+        list_push(ctx->codegen.callees, fname);
+        util_set_arena(arena);
+    }
+}
+
+static void codegenir_label(compiler_ctx_t *ctx, int label) {
+    ir_place_label(ctx->codegen.func, label);
+}
+
+static bool codegenir_is_aggregate(ctype_t *ctype) {
+    return ctype->type == CTYPE_ARRAY || ctype->type == CTYPE_STRUCT;
+}
+
+static int codegenir_mtype(ctype_t *ctype) {
+    switch (ctype->type) {
+        case CTYPE_CHAR:
+            return MT_I8;
+        case CTYPE_INT:
+            return MT_I32;
+        case CTYPE_UINT:
+            return MT_U32;
+#ifdef ALLOW_LONG
+        case CTYPE_LONG:
+#endif
+        case CTYPE_PTR:
+            return MT_I64;
+        case CTYPE_FLOAT:
+            return MT_F32;
+#ifdef ALLOW_DOUBLE
+        case CTYPE_DOUBLE:
+            return MT_F64;
+#endif
+        default:
+            util_error("internal error: no memory access for %s", verbose_ctype_to_string(ctype));
+    }
+    return 0; /* non-reachable */
+}
+
+// a char or an int is kept sign extended in its cell and a uint zero extended
+static void codegenir_conv(compiler_ctx_t *ctx, ctype_t *from, ctype_t *to) {
+    if (parser_is_inttype(from) && parser_is_flotype(to)) {
+        codegenir_op(ctx, OP_ITOF);
+        return;
+    }
+    if (parser_is_flotype(from)) {
+        // a float out of the range of the integer type is undefined
+        if (parser_is_inttype(to))
+            codegenir_op(ctx, OP_FTOI);
+        return;
+    }
+    if (!parser_is_inttype(from) && from->type != CTYPE_PTR)
+        return;
+    switch (to->type) {
+        case CTYPE_CHAR:
+            if (from->type != CTYPE_CHAR)
+                codegenir_op(ctx, OP_SX_I8);
+            break;
+        case CTYPE_INT:
+            if (from->type != CTYPE_CHAR && from->type != CTYPE_INT)
+                codegenir_op(ctx, OP_SX_I32);
+            break;
+        case CTYPE_UINT:
+            if (from->type != CTYPE_UINT)
+                codegenir_op(ctx, OP_U32);
+            break;
+        default:
+            break;
+    }
+}
+
+static void codegenir_gen_load(compiler_ctx_t *ctx, ctype_t *ctype) {
+    if (!codegenir_is_aggregate(ctype))
+        codegenir_op(ctx, opcodes_load(codegenir_mtype(ctype)));
+}
+
+static void codegenir_gen_addr(compiler_ctx_t *ctx, ast_t *ast) {
+    switch (ast->type) {
+        case AST_LVAR:
+            codegenir_op_int(ctx, OP_LEA, ast->loff);
+            break;
+        case AST_GVAR:
+            codegenir_op_sym(ctx, OP_GADDR, ast->glabel);
+            break;
+        case AST_STRING:
+            codegenir_op_sym(ctx, OP_GADDR, ast->slabel);
+            break;
+        case AST_DEREF:
+            codegenir_gen_expr(ctx, ast->operand);
+            break;
+        case AST_STRUCT_REF:
+            codegenir_gen_addr(ctx, ast->struc);
+            if (ast->ctype->offset) {
+                codegenir_op_int(ctx, OP_PUSH, ast->ctype->offset);
+                codegenir_op(ctx, OP_ADD);
+            }
+            break;
+        default:
+            util_error("lvalue expected, but got %s", verbose_ast_to_string(ctx, ast, true));
+    }
+}
+
+// (v -- )
+static void codegenir_gen_store(compiler_ctx_t *ctx, ast_t *var) {
+    if (codegenir_is_aggregate(var->ctype))
+        util_error("Assignment to %s is not supported", verbose_ctype_to_string(var->ctype));
+    if (var->type == AST_LVAR) {
+        codegenir_op_int(ctx, opcodes_store_local(codegenir_mtype(var->ctype)), var->loff);
+        return;
+    }
+    codegenir_gen_addr(ctx, var);
+    codegenir_op(ctx, opcodes_store(codegenir_mtype(var->ctype)));
+}
+
+static void codegenir_gen_truth(compiler_ctx_t *ctx, ast_t *ast) {
+    codegenir_gen_expr(ctx, ast);
+    if (parser_is_flotype(ast->ctype)) {
+        codegenir_op_int(ctx, OP_PUSH, 0);
+        codegenir_op(ctx, OP_ITOF);
+        codegenir_op(ctx, OP_FEQ);
+        codegenir_op(ctx, OP_NOT);
+    }
+}
+
+static void codegenir_gen_assign(compiler_ctx_t *ctx, ast_t *ast) {
+    codegenir_gen_expr(ctx, ast->right);
+    codegenir_conv(ctx, ast->right->ctype, ast->left->ctype);
+    codegenir_op(ctx, OP_DUP);
+    codegenir_gen_store(ctx, ast->left);
+}
+
+static void codegenir_gen_step(compiler_ctx_t *ctx, ctype_t *ctype, int op) {
+    if (parser_is_flotype(ctype)) {
+        codegenir_op_int(ctx, OP_PUSH, 1);
+        codegenir_op(ctx, OP_ITOF);
+        codegenir_op(ctx, op == '+' ? OP_FADD : OP_FSUB);
+        return;
+    }
+    codegenir_op_int(ctx, OP_PUSH, (ctype->type == CTYPE_PTR) ? ctype->ptr->size : 1);
+    codegenir_op(ctx, op == '+' ? OP_ADD : OP_SUB);
+    if (ctype->type == CTYPE_UINT)
+        codegenir_op(ctx, OP_U32);
+    else if (ctype->type == CTYPE_CHAR)
+        codegenir_op(ctx, OP_SX_I8);
+}
+
+static void codegenir_gen_incdec(compiler_ctx_t *ctx, ast_t *ast, int op, bool post) {
+    ast_t *var = ast->operand;
+    int mt = codegenir_mtype(var->ctype);
+
+    if (var->type == AST_LVAR) {
+        codegenir_op_int(ctx, opcodes_load_local(mt), var->loff);
+        if (post)
+            codegenir_op(ctx, OP_DUP);
+        codegenir_gen_step(ctx, var->ctype, op);
+        if (!post)
+            codegenir_op(ctx, OP_DUP);
+        codegenir_op_int(ctx, opcodes_store_local(mt), var->loff);
+        return;
+    }
+
+    // the address is computed once: addr dup ld step swap over swap st
+    codegenir_gen_addr(ctx, var);
+    codegenir_op(ctx, OP_DUP);
+    codegenir_op(ctx, opcodes_load(mt));
+    if (post) {
+        codegenir_op(ctx, OP_SWAP);
+        codegenir_op(ctx, OP_OVER);
+        codegenir_gen_step(ctx, var->ctype, op);
+    } else {
+        codegenir_gen_step(ctx, var->ctype, op);
+        codegenir_op(ctx, OP_SWAP);
+        codegenir_op(ctx, OP_OVER);
+    }
+    codegenir_op(ctx, OP_SWAP);
+    codegenir_op(ctx, opcodes_store(mt));
+}
+
+static void codegenir_gen_logical(compiler_ctx_t *ctx, ast_t *ast) {
+    int ljump = ir_label_make(ctx, ctx->codegen.func);
+    int lend = ir_label_make(ctx, ctx->codegen.func);
+    int jz = (ast->type == PUNCT_LOGAND);
+    int d = ctx->codegen.depth;
+
+    codegenir_gen_truth(ctx, ast->left);
+    codegenir_op_jump(ctx, jz ? OP_JZ : OP_JNZ, ljump);
+    codegenir_gen_truth(ctx, ast->right);
+    codegenir_op_jump(ctx, jz ? OP_JZ : OP_JNZ, ljump);
+    codegenir_op_int(ctx, OP_PUSH, jz);
+    codegenir_op_jump(ctx, OP_JMP, lend);
+    ctx->codegen.depth = d;
+    codegenir_label(ctx, ljump);
+    codegenir_op_int(ctx, OP_PUSH, !jz);
+    codegenir_label(ctx, lend);
+}
+
+static void codegenir_gen_ternary(compiler_ctx_t *ctx, ast_t *ast) {
+    int lelse = ir_label_make(ctx, ctx->codegen.func);
+    int lend = ir_label_make(ctx, ctx->codegen.func);
+
+    codegenir_gen_truth(ctx, ast->cond);
+    codegenir_op_jump(ctx, OP_JZ, lelse);
+    int d = ctx->codegen.depth;
+    codegenir_gen_expr(ctx, ast->then);
+    codegenir_conv(ctx, ast->then->ctype, ast->ctype);
+    codegenir_op_jump(ctx, OP_JMP, lend);
+    int then_depth = ctx->codegen.depth;
+    ctx->codegen.depth = d;
+    codegenir_label(ctx, lelse);
+    codegenir_gen_expr(ctx, ast->els);
+    codegenir_conv(ctx, ast->els->ctype, ast->ctype);
+    if (ctx->codegen.depth != then_depth)
+        util_error("internal error: unbalanced ternary operator");
+    codegenir_label(ctx, lend);
+}
+
+static void codegenir_gen_ptr_arith(compiler_ctx_t *ctx, ast_t *ast) {
+    int size = ast->ctype->ptr->size;
+
+    codegenir_gen_expr(ctx, ast->left);
+    codegenir_gen_expr(ctx, ast->right);
+    if (size != 1) {
+        codegenir_op_int(ctx, OP_PUSH, size);
+        codegenir_op(ctx, OP_MUL);
+    }
+    codegenir_op(ctx, ast->type == '+' ? OP_ADD : OP_SUB);
+}
+
+static void codegenir_gen_binop(compiler_ctx_t *ctx, ast_t *ast) {
+    if (ast->ctype->type == CTYPE_PTR) {
+        codegenir_gen_ptr_arith(ctx, ast);
+        return;
+    }
+
+    // comparisons yield an int, their operands are compared in the common type
+    ctype_t *ctype = ast->ctype;
+    if (ast->type == '<' || ast->type == '>' || ast->type == PUNCT_EQ)
+        ctype = parser_result_type(ast->type, ast->left->ctype, ast->right->ctype);
+    bool flo = parser_is_flotype(ctype);
+    bool uns = (ctype->type == CTYPE_UINT);
+    // the low 32 bits of these results only depend on those of the operands
+    bool wraps = uns && (ast->type == '+' || ast->type == '-' || ast->type == '*' || ast->type == PUNCT_LSHIFT);
+
+    codegenir_gen_expr(ctx, ast->left);
+    if (!wraps)
+        codegenir_conv(ctx, ast->left->ctype, ctype);
+    codegenir_gen_expr(ctx, ast->right);
+    if (!wraps)
+        codegenir_conv(ctx, ast->right->ctype, ctype);
+
+    int op;
+    switch (ast->type) {
+        case '+':
+            op = flo ? OP_FADD : OP_ADD;
+            break;
+        case '-':
+            op = flo ? OP_FSUB : OP_SUB;
+            break;
+        case '*':
+            op = flo ? OP_FMUL : OP_MUL;
+            break;
+        case '/':
+            op = flo ? OP_FDIV : uns ? OP_UDIV : OP_DIV;
+            break;
+        case '<':
+            op = flo ? OP_FLT : uns ? OP_ULT : OP_LT;
+            break;
+        case '>':
+            op = flo ? OP_FGT : uns ? OP_UGT : OP_GT;
+            break;
+        case PUNCT_EQ:
+            op = flo ? OP_FEQ : OP_EQ;
+            break;
+        case '&':
+            op = OP_AND;
+            break;
+        case '|':
+            op = OP_OR;
+            break;
+        case PUNCT_LSHIFT:
+            op = OP_SHL;
+            break;
+        case PUNCT_RSHIFT:
+            op = uns ? OP_USHR : OP_SHR;
+            break;
+        default:
+            util_error("internal error: unknown operator %d", ast->type);
+            return; /* non-reachable */
+    }
+    if (flo && (op == OP_AND || op == OP_OR || op == OP_SHL || op == OP_SHR))
+        util_error("Invalid operands to %s", verbose_ast_to_string(ctx, ast, true));
+    codegenir_op(ctx, op);
+    // the cell is 64 bits wide, an unsigned result wraps at 32
+    if (uns && (op == OP_ADD || op == OP_SUB || op == OP_MUL || op == OP_SHL))
+        codegenir_op(ctx, OP_U32);
+}
+
+static void codegenir_gen_funcall(compiler_ctx_t *ctx, ast_t *ast) {
+    // the arguments of a function defined earlier are converted to its parameter types
+    list_t *params = ctx->codegen.defined ? symtab_get(ctx->codegen.defined, ast->fname) : NULL;
+    iter_t p = list_iter(params && list_len(params) == list_len(ast->args) ? params : &list_empty);
+
+    for (iter_t i = list_iter(ast->args); !list_iter_end(i);) {
+        ast_t *arg = list_iter_next(&i);
+        codegenir_gen_expr(ctx, arg);
+        if (!list_iter_end(p))
+            codegenir_conv(ctx, arg->ctype, list_iter_next(&p));
+    }
+    codegenir_op_call(ctx, ast->fname, list_len(ast->args));
+}
+
+// the value of the call is on the stack at inline_end
+static void codegenir_gen_inline(compiler_ctx_t *ctx, ast_t *ast) {
+    ctype_t *saved_rettype = ctx->codegen.rettype;
+    int saved_end = ctx->codegen.inline_end;
+
+    ctx->codegen.rettype = ast->callee->ctype;
+    ctx->codegen.inline_end = ir_label_make(ctx, ctx->codegen.func);
+    codegenir_gen_stmt(ctx, ast->inlbody);
+    codegenir_op_int(ctx, OP_PUSH, 0);
+    codegenir_label(ctx, ctx->codegen.inline_end);
+    ctx->codegen.rettype = saved_rettype;
+    ctx->codegen.inline_end = saved_end;
+}
+
+static void codegenir_gen_expr(compiler_ctx_t *ctx, ast_t *ast) {
+    switch (ast->type) {
+        case AST_LITERAL:
+            if (parser_is_flotype(ast->ctype)) {
+                if (constpool_is_imm(ast->fval)) {
+                    constpool_note_imm(ctx);
+                    codegenir_op_int(ctx, OP_PUSH, (long) ast->fval);
+                    codegenir_op(ctx, OP_ITOF);
+                    break;
+                }
+                int mt = codegenir_mtype(ast->ctype);
+                if (!ast->flabel)
+                    ast->flabel = constpool_label(ctx, mt, ast->fval);
+                codegenir_op_sym(ctx, OP_GADDR, ast->flabel);
+                codegenir_op(ctx, opcodes_load(mt));
+            } else {
+                codegenir_op_int(ctx, OP_PUSH, ast->ival);
+            }
+            break;
+        case AST_STRING:
+            codegenir_op_sym(ctx, OP_GADDR, ast->slabel);
+            break;
+        case AST_LVAR:
+            if (codegenir_is_aggregate(ast->ctype))
+                codegenir_op_int(ctx, OP_LEA, ast->loff);
+            else
+                codegenir_op_int(ctx, opcodes_load_local(codegenir_mtype(ast->ctype)), ast->loff);
+            break;
+        case AST_GVAR:
+        case AST_STRUCT_REF:
+            codegenir_gen_addr(ctx, ast);
+            codegenir_gen_load(ctx, ast->ctype);
+            break;
+        case AST_DEREF:
+            codegenir_gen_expr(ctx, ast->operand);
+            codegenir_gen_load(ctx, ast->ctype);
+            break;
+        case AST_ADDR:
+            codegenir_gen_addr(ctx, ast->operand);
+            break;
+        case AST_FUNCALL:
+            codegenir_gen_funcall(ctx, ast);
+            break;
+        case AST_INLINE:
+            codegenir_gen_inline(ctx, ast);
+            break;
+        case AST_TERNARY:
+            codegenir_gen_ternary(ctx, ast);
+            break;
+        case PUNCT_PREINC:
+            codegenir_gen_incdec(ctx, ast, '+', false);
+            break;
+        case PUNCT_PREDEC:
+            codegenir_gen_incdec(ctx, ast, '-', false);
+            break;
+        case PUNCT_POSTINC:
+            codegenir_gen_incdec(ctx, ast, '+', true);
+            break;
+        case PUNCT_POSTDEC:
+            codegenir_gen_incdec(ctx, ast, '-', true);
+            break;
+        case '!':
+            codegenir_gen_truth(ctx, ast->operand);
+            codegenir_op(ctx, OP_NOT);
+            break;
+        case PUNCT_LOGAND:
+        case PUNCT_LOGOR:
+            codegenir_gen_logical(ctx, ast);
+            break;
+        case '=':
+            codegenir_gen_assign(ctx, ast);
+            break;
+        default:
+            codegenir_gen_binop(ctx, ast);
+    }
+}
+
+static void codegenir_gen_local_init(compiler_ctx_t *ctx, ast_t *var, ast_t *init) {
+    if (var->ctype->type == CTYPE_ARRAY && init->type == AST_STRING) {
+        int len = strlen(init->sval) + 1;
+        for (int n = 0; n < len; n++) {
+            codegenir_op_int(ctx, OP_PUSH, init->sval[n]);
+            codegenir_op_int(ctx, OP_STL_I8, var->loff + n);
+        }
+        return;
+    }
+    if (init->type == AST_ARRAY_INIT) {
+        ctype_t *elem = var->ctype->ptr;
+        int off = var->loff;
+        for (iter_t i = list_iter(init->arrayinit); !list_iter_end(i); off += elem->size) {
+            ast_t *v = list_iter_next(&i);
+            codegenir_gen_expr(ctx, v);
+            codegenir_conv(ctx, v->ctype, elem);
+            codegenir_op_int(ctx, opcodes_store_local(codegenir_mtype(elem)), off);
+        }
+        return;
+    }
+    codegenir_gen_expr(ctx, init);
+    codegenir_conv(ctx, init->ctype, var->ctype);
+    codegenir_gen_store(ctx, var);
+}
+
+static void codegenir_gen_if(compiler_ctx_t *ctx, ast_t *ast) {
+    int lelse = ir_label_make(ctx, ctx->codegen.func);
+
+    codegenir_gen_truth(ctx, ast->cond);
+    codegenir_op_jump(ctx, OP_JZ, lelse);
+    codegenir_gen_stmt(ctx, ast->then);
+    if (!ast->els) {
+        codegenir_label(ctx, lelse);
+        return;
+    }
+    int lend = ir_label_make(ctx, ctx->codegen.func);
+    codegenir_op_jump(ctx, OP_JMP, lend);
+    codegenir_label(ctx, lelse);
+    codegenir_gen_stmt(ctx, ast->els);
+    codegenir_label(ctx, lend);
+}
+
+static void codegenir_gen_for(compiler_ctx_t *ctx, ast_t *ast) {
+    int lbegin = ir_label_make(ctx, ctx->codegen.func);
+    int lend = ir_label_make(ctx, ctx->codegen.func);
+
+    codegenir_gen_stmt(ctx, ast->forinit);
+    codegenir_label(ctx, lbegin);
+    if (ast->forcond) {
+        codegenir_gen_truth(ctx, ast->forcond);
+        codegenir_op_jump(ctx, OP_JZ, lend);
+    }
+    codegenir_gen_stmt(ctx, ast->forbody);
+    if (ast->forstep) {
+        codegenir_gen_expr(ctx, ast->forstep);
+        codegenir_op(ctx, OP_DROP);
+    }
+    codegenir_op_jump(ctx, OP_JMP, lbegin);
+    codegenir_label(ctx, lend);
+}
+
+// arguments were pushed left to right
+static void codegenir_gen_store_params(compiler_ctx_t *ctx, ast_t *fn) {
+    for (iter_t i = list_iter(list_reverse(fn->params)); !list_iter_end(i);) {
+        ast_t *v = list_iter_next(&i);
+        codegenir_op_int(ctx, opcodes_store_local(codegenir_mtype(v->ctype)), v->loff);
+    }
+}
 
+// return f(...) in f: store the arguments into the parameters and start over
+static bool codegenir_gen_tail_call(compiler_ctx_t *ctx, ast_t *ast) {
+    ast_t *call = ast->retval;
+
+    if (!call || call->type != AST_FUNCALL || ctx->codegen.inline_end >= 0 || ctx->codegen.depth)
+        return false;
+    if (strcmp(call->fname, ctx->codegen.curfunc->fname) || list_len(call->args) != list_len(ctx->codegen.curfunc->params))
+        return false;
+    // the int typed call result would be converted to a float return type
+    if (parser_is_flotype(ctx->codegen.rettype))
+        return false;
+
+    iter_t p = list_iter(ctx->codegen.curfunc->params);
+    for (iter_t i = list_iter(call->args); !list_iter_end(i);) {
+        ast_t *arg = list_iter_next(&i);
+        codegenir_gen_expr(ctx, arg);
+        codegenir_conv(ctx, arg->ctype, ((ast_t*) list_iter_next(&p))->ctype);
+    }
+    codegenir_gen_store_params(ctx, ctx->codegen.curfunc);
+    codegenir_op_jump(ctx, OP_JMP, ctx->codegen.entry_label);
+    ctx->codegen.tailcalls++;
+    return true;
+}
+
+static void codegenir_gen_return(compiler_ctx_t *ctx, ast_t *ast) {
+    if (codegenir_gen_tail_call(ctx, ast))
+        return;
+    if (ast->retval) {
+        codegenir_gen_expr(ctx, ast->retval);
+        codegenir_conv(ctx, ast->retval->ctype, ctx->codegen.rettype);
+    } else {
+        codegenir_op_int(ctx, OP_PUSH, 0);
+    }
+    if (ctx->codegen.inline_end < 0) {
+        codegenir_op(ctx, OP_RET);
+        return;
+    }
+    codegenir_op_jump(ctx, OP_JMP, ctx->codegen.inline_end);
+    // what follows the jump is not reached, the value is accounted at inline_end
+    ctx->codegen.depth--;
+}
+
+static void codegenir_gen_stmt(compiler_ctx_t *ctx, ast_t *ast) {
+    if (!ast)
+        return;
+
+    int base = ctx->codegen.depth;
+    switch (ast->type) {
+        case AST_DECL:
+            if (ast->declinit)
+                codegenir_gen_local_init(ctx, ast->declvar, ast->declinit);
+            break;
+        case AST_IF:
+            codegenir_gen_if(ctx, ast);
+            break;
+        case AST_FOR:
+            codegenir_gen_for(ctx, ast);
+            break;
+        case AST_RETURN:
+            codegenir_gen_return(ctx, ast);
+            break;
+        case AST_COMPOUND_STMT:
+            for (iter_t i = list_iter(ast->stmts); !list_iter_end(i);)
+                codegenir_gen_stmt(ctx, list_iter_next(&i));
+            break;
+        default:
+            codegenir_gen_expr(ctx, ast);
+            codegenir_op(ctx, OP_DROP);
+    }
+    if (ctx->codegen.depth != base)
+        util_error("internal error: operand stack depth %d after statement, expected %d", ctx->codegen.depth, base);
+}
+
+// parameter types for the calls generated later, when the function may be freed
+static list_t* codegenir_signature(ast_t *func) {
+    arena_t *arena = util_set_arena(util_arena_root());
+    list_t *r = list_make();
+
+    for (iter_t i = list_iter(func->params); !list_iter_end(i);) {
+        ctype_t *ctype = util_alloc(sizeof(ctype_t));
+        memcpy(ctype, ((ast_t*) list_iter_next(&i))->ctype, sizeof(ctype_t));
+        // only the kind is looked at
+        ctype->ptr = NULL;
+        ctype->fields = NULL;
+        list_push(r, ctype);
+    }
+    util_set_arena(arena);
+    return r;
+}
+
+static void codegenir_emit_func(compiler_ctx_t *ctx, ast_t *ast) {
+    int span = trace_begin(ctx, "codegen", ast->fname);
+
+    if (!ctx->codegen.defined)
+        ctx->codegen.defined = symtab_make();
+    symtab_put(ctx->codegen.defined, ast->fname, codegenir_signature(ast));
+    // labels and other temporaries go with the function
+    arena_t *arena = util_set_arena(ast->arena);
+
+    ctx->codegen.rettype = ast->ctype;
+    ctx->codegen.depth = ctx->codegen.maxdepth = list_len(ast->params);
+    ctx->codegen.func = ir_func_make(ast->fname);
+    ctx->codegen.func->nargs = ctx->codegen.depth;
+
+    codegenir_op_int(ctx, OP_ENTER, frame_layout(ctx, ast));
+    codegenir_gen_store_params(ctx, ast);
+    ctx->codegen.curfunc = ast;
+    ctx->codegen.entry_label = ir_label_make(ctx, ctx->codegen.func);
+    codegenir_label(ctx, ctx->codegen.entry_label);
+
+    codegenir_gen_stmt(ctx, ast->body);
+    codegenir_op_int(ctx, OP_PUSH, 0);
+    codegenir_op(ctx, OP_RET);
+
+    bool changed = peephole_run(ctx, ctx->codegen.func) > 0;
+    changed |= super_run(ctx, ctx->codegen.func) > 0;
+    if (changed)
+        ctx->codegen.func->maxstack = ir_max_depth(ctx->codegen.func);
+    else
+        ctx->codegen.func->maxstack = ctx->codegen.maxdepth;
+
+    codegenir_section(ctx, ".text");
+    if (ctx->codegen.binary)
+        binary_func(ctx, ctx->codegen.func);
+    else
+        ir_print_func(ctx, ctx->codegen.func);
+    trace_end(ctx, span, NULL, "insns", ctx->codegen.func->len);
+    ir_func_free(ctx->codegen.func);
+    ctx->codegen.func = NULL;
+    ctx->codegen.curfunc = NULL;
+    util_set_arena(arena);
+}
+
+static void codegenir_emit_data_item(compiler_ctx_t *ctx, ctype_t *ctype, ast_t *v) {
+    int val = parser_eval_intexpr(ctx, v);
+
+    if (parser_is_flotype(ctype))
+        codegenir_data_float(ctx, val);
+    else
+        codegenir_data_int(ctx, ctype->size, val);
+}
+
+static void codegenir_emit_global(compiler_ctx_t *ctx, ast_t *ast) {
+    ast_t *var = ast->declvar;
+    ast_t *init = ast->declinit;
+
+    codegenir_section(ctx, ".data");
+    codegenir_data_align(ctx, frame_align(var->ctype));
+    codegenir_data_label(ctx, var->glabel);
+    if (!init) {
+        codegenir_data_zero(ctx, var->ctype->size);
+    } else if (init->type == AST_STRING) {
+        codegenir_data_string(ctx, init->sval);
+    } else if (init->type == AST_ARRAY_INIT) {
+        for (iter_t i = list_iter(init->arrayinit); !list_iter_end(i);)
+            codegenir_emit_data_item(ctx, var->ctype->ptr, list_iter_next(&i));
+    } else {
+        codegenir_emit_data_item(ctx, var->ctype, init);
+    }
+}
+
+void codegenir_emit_toplevel(compiler_ctx_t *ctx, ast_t *v) {
+    switch (v->type) {
+        case AST_FUNC:
+            codegenir_emit_func(ctx, v);
+            break;
+        case AST_DECL:
+            codegenir_emit_global(ctx, v);
+            break;
+        default:
+            util_error("internal error: unexpected toplevel %s", verbose_ast_to_string(ctx, v, true));
+    }
+}
+
+void codegenir_report(compiler_ctx_t *ctx, FILE *fp) {
+    fprintf(fp, "self tail calls turned into loops: %d\n", ctx->codegen.tailcalls);
+}
+
+void codegenir_emit_end(compiler_ctx_t *ctx) {
+    // streaming: the literals are only known once the input is read
+    if (!ctx->codegen.strings_done)
+        codegenir_emit_data_section(ctx);
+    codegenir_emit_constpool(ctx);
+    if (ctx->codegen.binary) {
+        binary_write(ctx);
+        return;
+    }
+    for (iter_t i = list_iter(ctx->codegen.callees); !list_iter_end(i);) {
+        char *fname = list_iter_next(&i);
+        if (ctx->codegen.defined && symtab_get(ctx->codegen.defined, fname))
+            continue;
+        output_str(ctx, "\t.extern ");
+        output_str(ctx, fname);
+        output_char(ctx, '\n');
+    }
 }
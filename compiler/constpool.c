@@ -0,0 +1,112 @@
+/*
+ * @constpool.c
+ *
+ * @brief C for Stack VM
+ * @details
+ * This is based on other projects:
+ *   A minimalist C compiler with x86_64 code generation: https://github.com/jserv/MazuCC
+ *   Others (see individual files)
+ *
+ *   please contact their authors for more information.
+ *
+ * @author Emiliano Augusto Gonzalez (egonzalez . hiperion @ gmail . com)
+ * @date 2024
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/stackvm_c_compiler
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "c_stackvm.h"
+#include "context.h"
+#include "opcodes.h"
+#include "parser.h"
+#include "util.h"
+#include "constpool.h"
+
+#define CONSTPOOL_INIT_SIZE 64
+
+static uint32_t constpool_hash(int mt, uint64_t bits) {
+    bits ^= bits >> 29;
+    bits *= 0x9e3779b97f4a7c15ull;
+    return (uint32_t) (bits >> 32) ^ mt;
+}
+
+static void constpool_grow(compiler_ctx_t *ctx) {
+    constpool_entry_t **old = ctx->constpool.table;
+    int oldsize = ctx->constpool.size;
+
+    ctx->constpool.size = ctx->constpool.size ? ctx->constpool.size * 2 : CONSTPOOL_INIT_SIZE;
+    ctx->constpool.table = util_heap(NULL, 0, ctx->constpool.size * sizeof(constpool_entry_t*));
+    memset(ctx->constpool.table, 0, ctx->constpool.size * sizeof(constpool_entry_t*));
+    for (int n = 0; n < oldsize; n++) {
+        constpool_entry_t *e = old[n];
+        if (!e)
+            continue;
+        uint32_t h = constpool_hash(e->mt, e->bits) & (ctx->constpool.size - 1);
+        while (ctx->constpool.table[h])
+            h = (h + 1) & (ctx->constpool.size - 1);
+        ctx->constpool.table[h] = e;
+    }
+    free(old);
+}
+
+bool constpool_is_imm(double val) {
+    // range first: converting NaN or a large value to int is undefined
+    if (!(val >= -CONSTPOOL_IMM_MAX && val <= CONSTPOOL_IMM_MAX))
+        return false;
+    return val == (int32_t) val && !(val == 0 && signbit(val));
+}
+
+char* constpool_label(compiler_ctx_t *ctx, int mt, double val) {
+    uint64_t bits = 0;
+
+    if (mt == MT_F32) {
+        float f = val;
+        uint32_t b;
+        memcpy(&b, &f, sizeof(b));
+        bits = b;
+    } else {
+        memcpy(&bits, &val, sizeof(bits));
+    }
+
+    ctx->constpool.uses++;
+    if (2 * (ctx->constpool.count + 1) > ctx->constpool.size)
+        constpool_grow(ctx);
+    uint32_t h = constpool_hash(mt, bits) & (ctx->constpool.size - 1);
+    for (; ctx->constpool.table[h]; h = (h + 1) & (ctx->constpool.size - 1))
+        if (ctx->constpool.table[h]->mt == mt && ctx->constpool.table[h]->bits == bits)
+            return ctx->constpool.table[h]->label;
+
+    // the pool is written at the end, after the function using it is freed
+    arena_t *arena = util_set_arena(util_arena_root());
+    constpool_entry_t *e = util_alloc(sizeof(constpool_entry_t));
+    e->mt = mt;
+    e->bits = bits;
+    e->label = parser_make_label(ctx);
+    ctx->constpool.table[h] = e;
+    ctx->constpool.count++;
+    if (!ctx->constpool.entries)
+        ctx->constpool.entries = list_make();
+    list_push(ctx->constpool.entries, e);
+    util_set_arena(arena);
+    return e->label;
+}
+
+list_t* constpool_entries(compiler_ctx_t *ctx) {
+    return ctx->constpool.entries ? ctx->constpool.entries : list_make();
+}
+
+void constpool_note_imm(compiler_ctx_t *ctx) {
+    ctx->constpool.imms++;
+}
+
+void constpool_stats(compiler_ctx_t *ctx, FILE *fp) {
+    int after = 0;
+
+    for (iter_t i = list_iter(constpool_entries(ctx)); !list_iter_end(i);)
+        after += (((constpool_entry_t*) list_iter_next(&i))->mt == MT_F32) ? 4 : 8;
+    fprintf(fp, "float constants: %d loads of %d entries, %d immediates, %d -> %d bytes\n", ctx->constpool.uses, ctx->constpool.count, ctx->constpool.imms, 8 * (ctx->constpool.uses + ctx->constpool.imms), after);
+}
@@ -0,0 +1,84 @@
+/*
+ * @context.c
+ *
+ * @brief C for Stack VM
+ * @details
+ * This is based on other projects:
+ *   A minimalist C compiler with x86_64 code generation: https://github.com/jserv/MazuCC
+ *   Others (see individual files)
+ *
+ *   please contact their authors for more information.
+ *
+ * @author Emiliano Augusto Gonzalez (egonzalez . hiperion @ gmail . com)
+ * @date 2024
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/stackvm_c_compiler
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "c_stackvm.h"
+#include "context.h"
+#include "list.h"
+#include "util.h"
+
+_Thread_local compiler_ctx_t *compiler_ctx_current = NULL;
+
+compiler_ctx_t* compiler_ctx_make(void) {
+    compiler_ctx_t *c = calloc(1, sizeof(compiler_ctx_t));
+
+    if (!c) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    c->outfp = stdout;
+    c->errfp = stderr;
+    c->inliner.limit = INLINER_DEFAULT_LIMIT;
+    c->codegen.entry_label = -1;
+    c->codegen.inline_end = -1;
+
+    // the lists live in the arena of the new context
+    compiler_ctx_t *prev = compiler_ctx_enter(c);
+    c->parser.strings = list_make();
+    c->codegen.callees = list_make();
+    // a fixed size buffer, made before any phase so that none is charged for it
+    c->output.buf = util_heap(NULL, 0, OUTPUT_BUFFER_SIZE);
+    compiler_ctx_enter(prev);
+
+    return c;
+}
+
+compiler_ctx_t* compiler_ctx_enter(compiler_ctx_t *c) {
+    compiler_ctx_t *prev = compiler_ctx_current;
+    compiler_ctx_current = c;
+    return prev;
+}
+
+void compiler_ctx_copy_options(compiler_ctx_t *to, const compiler_ctx_t *from) {
+    to->inliner.limit = from->inliner.limit;
+    memcpy(to->peephole.disabled, from->peephole.disabled, sizeof(to->peephole.disabled));
+    memcpy(to->super.disabled, from->super.disabled, sizeof(to->super.disabled));
+}
+
+void compiler_ctx_free(compiler_ctx_t *c) {
+    if (!c)
+        return;
+
+    compiler_ctx_t *prev = compiler_ctx_enter(c);
+    util_free_all();
+    free(c->frame.stats);
+    free(c->inliner.sites);
+    free(c->constpool.table);
+    free(c->peephole.label_refs);
+    free(c->binary.data.body);
+    free(c->binary.code.body);
+    free(c->binary.fixups);
+    for (int n = 0; n < c->trace.nevents; n++)
+        free(c->trace.events[n].name);
+    free(c->trace.events);
+    free(c->output.buf);
+    compiler_ctx_enter(prev == c ? NULL : prev);
+    free(c);
+}
@@ -15,19 +15,14 @@
  * @see https://github.com/hiperiondev/stackvm_c_compiler
  */
 
-#include <stdlib.h>
 #include <string.h>
 
 #include "util.h"
 #include "list.h"
 #include "dict.h"
 
-extern void **mkstr;
-extern long mkstr_qty;
-
 void* dict_make(void *parent) {
-    dict_t *r = malloc(sizeof(dict_t));
-    add_str_ptr(mkstr, mkstr_qty, r);
+    dict_t *r = util_alloc(sizeof(dict_t));
     r->list = list_make();
     r->parent = parent;
     return r;
@@ -37,7 +32,7 @@ void* dict_get(dict_t *dict, char *key) {
     for (; dict; dict = dict->parent) {
         for (iter_t i = list_iter(dict->list); !list_iter_end(i);) {
             dict_entry_t *e = list_iter_next(&i);
-            if (!strcmp(key, e->key))
+            if (key == e->key || !strcmp(key, e->key))
                 return e->val;
         }
     }
@@ -45,8 +40,7 @@ void* dict_get(dict_t *dict, char *key) {
 }
 
 void dict_put(dict_t *dict, char *key, void *val) {
-    dict_entry_t *e = malloc(sizeof(dict_entry_t));
-    add_str_ptr(mkstr, mkstr_qty, e);
+    dict_entry_t *e = util_alloc(sizeof(dict_entry_t));
     e->key = key;
     e->val = val;
     list_push(dict->list, e);
@@ -71,15 +65,6 @@ list_t* dict_values(dict_t *dict) {
 void* dict_parent(dict_t *dict) {
     void *r = dict->parent;
 
-    for (long n = 0; n < mkstr_qty; n++) {
-        if (mkstr[n] == dict->list)
-            mkstr[n] = NULL;
-        if (mkstr[n] == dict)
-            mkstr[n] = NULL;
-    }
-
     list_free(dict->list);
-    free(dict->list);
-    free(dict);
     return r;
 }
@@ -0,0 +1,394 @@
+/*
+ * @fold.c
+ *
+ * @brief C for Stack VM
+ * @details
+ * This is based on other projects:
+ *   A minimalist C compiler with x86_64 code generation: https://github.com/jserv/MazuCC
+ *   Others (see individual files)
+ *
+ *   please contact their authors for more information.
+ *
+ * @author Emiliano Augusto Gonzalez (egonzalez . hiperion @ gmail . com)
+ * @date 2024
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/stackvm_c_compiler
+ */
+
+#include <stdint.h>
+
+#include "c_stackvm.h"
+#include "context.h"
+#include "parser.h"
+#include "fold.h"
+
+/*
+ * Folding computes what the VM would: integers are 64 bit cells and floats are
+ * doubles. An integer result is only folded when it fits the i32 immediate of
+ * push, anything else is left to run time.
+ */
+
+static bool fold_is_int(ast_t *ast) {
+    return ast->type == AST_LITERAL && parser_is_inttype(ast->ctype);
+}
+
+static bool fold_is_float(ast_t *ast) {
+    return ast->type == AST_LITERAL && parser_is_flotype(ast->ctype);
+}
+
+static bool fold_is_const(ast_t *ast) {
+    return fold_is_int(ast) || fold_is_float(ast);
+}
+
+static bool fold_is_value(ast_t *ast, long val) {
+    return fold_is_int(ast) && ast->ival == val;
+}
+
+static bool fold_truth(ast_t *ast) {
+    return fold_is_float(ast) ? ast->fval != 0 : ast->ival != 0;
+}
+
+static double fold_fval(ast_t *ast) {
+    return fold_is_float(ast) ? ast->fval : (double) ast->ival;
+}
+
+static ast_t* fold_int(compiler_ctx_t *ctx, ast_t *ast, int64_t val) {
+    if (val < INT32_MIN || val > INT32_MAX)
+        return ast;
+    return parser_ast_inttype(ctx, ast->ctype, val);
+}
+
+static void fold_list(compiler_ctx_t *ctx, list_t *list) {
+    list_node_t *node, *tmp;
+
+    if (!list)
+        return;
+    list_for_each_safe(node, tmp, list)
+        node->elem = fold_ast(ctx, node->elem);
+}
+
+// can be removed without losing a side effect
+static bool fold_is_pure(ast_t *ast) {
+    switch (ast->type) {
+        case AST_LITERAL:
+        case AST_STRING:
+        case AST_LVAR:
+        case AST_GVAR:
+            return true;
+        case AST_ADDR:
+        case AST_DEREF:
+        case '!':
+            return fold_is_pure(ast->operand);
+        case AST_STRUCT_REF:
+            return fold_is_pure(ast->struc);
+        case AST_TERNARY:
+            return fold_is_pure(ast->cond) && fold_is_pure(ast->then) && fold_is_pure(ast->els);
+        case '+':
+        case '-':
+        case '*':
+        case '/':
+        case '<':
+        case '>':
+        case '&':
+        case '|':
+        case PUNCT_EQ:
+        case PUNCT_LSHIFT:
+        case PUNCT_RSHIFT:
+        case PUNCT_LOGAND:
+        case PUNCT_LOGOR:
+            return fold_is_pure(ast->left) && fold_is_pure(ast->right);
+        default:
+            return false;
+    }
+}
+
+ast_t* fold_convert(compiler_ctx_t *ctx, ast_t *ast, ctype_t *ctype) {
+    long val;
+
+    if (ast->type != AST_LITERAL || !parser_is_inttype(ctype) || ast->ctype->type == ctype->type)
+        return ast;
+    if (fold_is_float(ast)) {
+        if (!(ast->fval > INT32_MIN - 1.0 && ast->fval < INT32_MAX + 1.0))
+            return ast;
+        val = (long) ast->fval;
+    } else if (fold_is_int(ast)) {
+        val = ast->ival;
+    } else {
+        return ast;
+    }
+
+    switch (ctype->type) {
+        case CTYPE_CHAR:
+            val = (int8_t) val;
+            break;
+        case CTYPE_INT:
+            val = (int32_t) val;
+            break;
+        case CTYPE_UINT:
+            val = (uint32_t) val;
+            break;
+        default:
+            return ast;
+    }
+    if (val < INT32_MIN || val > INT32_MAX)
+        return ast;
+    return parser_ast_inttype(ctx, ctype, val);
+}
+
+static ast_t* fold_float_binop(compiler_ctx_t *ctx, ast_t *ast) {
+    double a = fold_fval(ast->left), b = fold_fval(ast->right);
+
+    switch (ast->type) {
+        case '+':
+            return parser_ast_double(ctx, a + b);
+        case '-':
+            return parser_ast_double(ctx, a - b);
+        case '*':
+            return parser_ast_double(ctx, a * b);
+        case '/':
+            return (b != 0) ? parser_ast_double(ctx, a / b) : ast;
+        case '<':
+            return fold_int(ctx, ast, a < b);
+        case '>':
+            return fold_int(ctx, ast, a > b);
+        case PUNCT_EQ:
+            return fold_int(ctx, ast, a == b);
+        default:
+            return ast;
+    }
+}
+
+static ast_t* fold_int_binop(compiler_ctx_t *ctx, ast_t *ast) {
+    int64_t a = ast->left->ival, b = ast->right->ival;
+    bool uns = parser_result_type(ast->type, ast->left->ctype, ast->right->ctype)->type == CTYPE_UINT;
+
+    switch (ast->type) {
+        case '+':
+            return fold_int(ctx, ast, (uint64_t) a + (uint64_t) b);
+        case '-':
+            return fold_int(ctx, ast, (uint64_t) a - (uint64_t) b);
+        case '*':
+            return fold_int(ctx, ast, (uint64_t) a * (uint64_t) b);
+        case '/':
+            if (!b)
+                return ast;
+            return fold_int(ctx, ast, uns ? (int64_t) ((uint64_t) a / (uint64_t) b) : a / b);
+        case '&':
+            return fold_int(ctx, ast, a & b);
+        case '|':
+            return fold_int(ctx, ast, a | b);
+        case '<':
+            return fold_int(ctx, ast, uns ? (uint64_t) a < (uint64_t) b : a < b);
+        case '>':
+            return fold_int(ctx, ast, uns ? (uint64_t) a > (uint64_t) b : a > b);
+        case PUNCT_EQ:
+            return fold_int(ctx, ast, a == b);
+        case PUNCT_LSHIFT:
+            return (b >= 0 && b < 64) ? fold_int(ctx, ast, (uint64_t) a << b) : ast;
+        case PUNCT_RSHIFT:
+            if (b < 0 || b >= 64)
+                return ast;
+            return fold_int(ctx, ast, uns ? (int64_t) ((uint64_t) a >> b) : a >> b);
+        default:
+            return ast;
+    }
+}
+
+// x + 0, x * 1, x * 0, ... on integers
+static ast_t* fold_identity(compiler_ctx_t *ctx, ast_t *ast) {
+    ast_t *l = ast->left, *r = ast->right;
+
+    if (!parser_is_inttype(ast->ctype) || !parser_is_inttype(l->ctype) || !parser_is_inttype(r->ctype))
+        return ast;
+    switch (ast->type) {
+        case '+':
+        case '|':
+            if (fold_is_value(r, 0))
+                return l;
+            if (fold_is_value(l, 0))
+                return r;
+            break;
+        case '-':
+        case PUNCT_LSHIFT:
+        case PUNCT_RSHIFT:
+            if (fold_is_value(r, 0))
+                return l;
+            break;
+        case '/':
+            if (fold_is_value(r, 1))
+                return l;
+            break;
+        case '*':
+            if (fold_is_value(r, 1))
+                return l;
+            if (fold_is_value(l, 1))
+                return r;
+            // fall through
+        case '&':
+            if (fold_is_value(r, 0) && fold_is_pure(l))
+                return fold_int(ctx, ast, 0);
+            if (fold_is_value(l, 0) && fold_is_pure(r))
+                return fold_int(ctx, ast, 0);
+            break;
+    }
+    return ast;
+}
+
+static ast_t* fold_logical(compiler_ctx_t *ctx, ast_t *ast) {
+    ast_t *l = ast->left, *r = ast->right;
+    bool and = (ast->type == PUNCT_LOGAND);
+
+    // 0 && x, 1 || x: x is never evaluated
+    if (fold_is_const(l)) {
+        if (fold_truth(l) != and)
+            return fold_int(ctx, ast, !and);
+        if (fold_is_const(r))
+            return fold_int(ctx, ast, fold_truth(r));
+        return ast;
+    }
+    if (fold_is_const(r) && fold_truth(r) != and && fold_is_pure(l))
+        return fold_int(ctx, ast, !and);
+    return ast;
+}
+
+static ast_t* fold_binop(compiler_ctx_t *ctx, ast_t *ast) {
+    ast->left = fold_ast(ctx, ast->left);
+    ast->right = fold_ast(ctx, ast->right);
+
+    if (ast->type == PUNCT_LOGAND || ast->type == PUNCT_LOGOR)
+        return fold_logical(ctx, ast);
+    // pointer arithmetic is scaled by the code generator
+    if (ast->ctype->type == CTYPE_PTR)
+        return ast;
+    if (fold_is_const(ast->left) && fold_is_const(ast->right)) {
+        if (fold_is_float(ast->left) || fold_is_float(ast->right))
+            return fold_float_binop(ctx, ast);
+        return fold_int_binop(ctx, ast);
+    }
+    return fold_identity(ctx, ast);
+}
+
+static ast_t* fold_ternary(compiler_ctx_t *ctx, ast_t *ast) {
+    ast->cond = fold_ast(ctx, ast->cond);
+    ast->then = fold_ast(ctx, ast->then);
+    ast->els = fold_ast(ctx, ast->els);
+
+    if (!fold_is_const(ast->cond))
+        return ast;
+    ast_t *r = fold_truth(ast->cond) ? ast->then : ast->els;
+    if (r->ctype->type != ast->ctype->type)
+        r = fold_convert(ctx, r, ast->ctype);
+    return (r->ctype->type == ast->ctype->type) ? r : ast;
+}
+
+static ast_t* fold_stmt_if(compiler_ctx_t *ctx, ast_t *ast) {
+    ast->cond = fold_ast(ctx, ast->cond);
+    ast->then = fold_ast(ctx, ast->then);
+    if (ast->els)
+        ast->els = fold_ast(ctx, ast->els);
+
+    if (!fold_is_const(ast->cond))
+        return ast;
+    ast_t *r = fold_truth(ast->cond) ? ast->then : ast->els;
+    return r ? r : parser_ast_compound_stmt(ctx, list_make());
+}
+
+static ast_t* fold_stmt_for(compiler_ctx_t *ctx, ast_t *ast) {
+    if (ast->forinit)
+        ast->forinit = fold_ast(ctx, ast->forinit);
+    if (ast->forcond)
+        ast->forcond = fold_ast(ctx, ast->forcond);
+    if (ast->forstep)
+        ast->forstep = fold_ast(ctx, ast->forstep);
+    ast->forbody = fold_ast(ctx, ast->forbody);
+
+    if (!ast->forcond || !fold_is_const(ast->forcond))
+        return ast;
+    if (fold_truth(ast->forcond)) {
+        ast->forcond = NULL;
+        return ast;
+    }
+    return ast->forinit ? ast->forinit : parser_ast_compound_stmt(ctx, list_make());
+}
+
+static ast_t* fold_decl(compiler_ctx_t *ctx, ast_t *ast) {
+    ast_t *init = ast->declinit;
+    ctype_t *ctype = ast->declvar->ctype;
+
+    if (!init)
+        return ast;
+    if (init->type == AST_ARRAY_INIT) {
+        list_node_t *node, *tmp;
+        list_for_each_safe(node, tmp, init->arrayinit)
+            node->elem = fold_convert(ctx, fold_ast(ctx, node->elem), ctype->ptr);
+    } else {
+        ast->declinit = fold_convert(ctx, fold_ast(ctx, init), ctype);
+    }
+    return ast;
+}
+
+ast_t* fold_ast(compiler_ctx_t *ctx, ast_t *ast) {
+    if (!ast)
+        return NULL;
+
+    switch (ast->type) {
+        case AST_LITERAL:
+        case AST_STRING:
+        case AST_LVAR:
+        case AST_GVAR:
+            return ast;
+        case AST_FUNC:
+            ctx->fold.rettype = ast->ctype;
+            ast->body = fold_ast(ctx, ast->body);
+            ctx->fold.rettype = NULL;
+            return ast;
+        case AST_FUNCALL:
+            fold_list(ctx, ast->args);
+            return ast;
+        case AST_DECL:
+            return fold_decl(ctx, ast);
+        case AST_IF:
+            return fold_stmt_if(ctx, ast);
+        case AST_FOR:
+            return fold_stmt_for(ctx, ast);
+        case AST_RETURN:
+            if (ast->retval) {
+                ast->retval = fold_ast(ctx, ast->retval);
+                if (ctx->fold.rettype)
+                    ast->retval = fold_convert(ctx, ast->retval, ctx->fold.rettype);
+            }
+            return ast;
+        case AST_COMPOUND_STMT:
+            fold_list(ctx, ast->stmts);
+            return ast;
+        case AST_STRUCT_REF:
+            ast->struc = fold_ast(ctx, ast->struc);
+            return ast;
+        case AST_INLINE: {
+            ctype_t *saved = ctx->fold.rettype;
+            ctx->fold.rettype = ast->callee->ctype;
+            ast->inlbody = fold_ast(ctx, ast->inlbody);
+            ctx->fold.rettype = saved;
+            return ast;
+        }
+        case AST_TERNARY:
+            return fold_ternary(ctx, ast);
+        case AST_ADDR:
+        case AST_DEREF:
+        case PUNCT_PREINC:
+        case PUNCT_PREDEC:
+        case PUNCT_POSTINC:
+        case PUNCT_POSTDEC:
+            ast->operand = fold_ast(ctx, ast->operand);
+            return ast;
+        case '!':
+            ast->operand = fold_ast(ctx, ast->operand);
+            return fold_is_const(ast->operand) ? fold_int(ctx, ast, !fold_truth(ast->operand)) : ast;
+        case '=':
+            ast->left = fold_ast(ctx, ast->left);
+            ast->right = fold_convert(ctx, fold_ast(ctx, ast->right), ast->left->ctype);
+            return ast;
+        default:
+            return fold_binop(ctx, ast);
+    }
+}
@@ -0,0 +1,228 @@
+/*
+ * @frame.c
+ *
+ * @brief C for Stack VM
+ * @details
+ * This is based on other projects:
+ *   A minimalist C compiler with x86_64 code generation: https://github.com/jserv/MazuCC
+ *   Others (see individual files)
+ *
+ *   please contact their authors for more information.
+ *
+ * @author Emiliano Augusto Gonzalez (egonzalez . hiperion @ gmail . com)
+ * @date 2024
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/stackvm_c_compiler
+ */
+
+#include <stdlib.h>
+
+#include "c_stackvm.h"
+#include "context.h"
+#include "parser.h"
+#include "util.h"
+#include "frame.h"
+
+/*
+ * A variable lives from the start of its block to the end of it, so the
+ * variables of a block are placed right after those of the enclosing blocks
+ * and sibling blocks start again at the same offset. The frame is the deepest
+ * nesting reached. Within a block the variables are sorted by alignment then
+ * size, which leaves padding only at the block boundaries.
+ */
+
+#define FRAME_UNPLACED -1
+
+int frame_align(ctype_t *ctype) {
+    switch (ctype->type) {
+        case CTYPE_ARRAY:
+            return frame_align(ctype->ptr);
+        case CTYPE_STRUCT:
+            return MAX_ALIGN;
+        default:
+            return (ctype->size > 0) ? ctype->size : 1;
+    }
+}
+
+static int frame_place(ast_t *v, int off) {
+    int align = frame_align(v->ctype);
+    if (off % align)
+        off += align - off % align;
+    v->loff = off;
+    return off + v->ctype->size;
+}
+
+static bool frame_before(ast_t *a, ast_t *b) {
+    int aa = frame_align(a->ctype), ab = frame_align(b->ctype);
+    return aa > ab || (aa == ab && a->ctype->size > b->ctype->size);
+}
+
+// place the variables declared directly in a block, returns the end offset
+static int frame_block(list_t *stmts, int off) {
+    int n = 0;
+
+    for (iter_t i = list_iter(stmts); !list_iter_end(i);)
+        if (((ast_t*) list_iter_next(&i))->type == AST_DECL)
+            n++;
+    if (!n)
+        return off;
+
+    ast_t **vars = util_heap(NULL, 0, n * sizeof(ast_t*));
+    n = 0;
+    for (iter_t i = list_iter(stmts); !list_iter_end(i);) {
+        ast_t *stmt = list_iter_next(&i);
+        if (stmt->type != AST_DECL)
+            continue;
+        // insertion sort keeps the declaration order between equal variables
+        int k = n++;
+        for (; k > 0 && frame_before(stmt->declvar, vars[k - 1]); k--)
+            vars[k] = vars[k - 1];
+        vars[k] = stmt->declvar;
+    }
+    for (int k = 0; k < n; k++)
+        off = frame_place(vars[k], off);
+
+    free(vars);
+    return off;
+}
+
+static int frame_walk(ast_t *ast, int off);
+
+static int frame_max(int top, ast_t *ast, int off) {
+    int end = frame_walk(ast, off);
+    return (end > top) ? end : top;
+}
+
+static int frame_list(int top, list_t *list, int off) {
+    if (list)
+        for (iter_t i = list_iter(list); !list_iter_end(i);)
+            top = frame_max(top, list_iter_next(&i), off);
+    return top;
+}
+
+// highest offset used by a statement or expression whose variables start at off
+static int frame_walk(ast_t *ast, int off) {
+    int top = off;
+
+    if (!ast)
+        return off;
+    switch (ast->type) {
+        case AST_LITERAL:
+        case AST_STRING:
+        case AST_LVAR:
+        case AST_GVAR:
+        case AST_FUNC:
+            break;
+        case AST_COMPOUND_STMT:
+            off = top = frame_block(ast->stmts, off);
+            top = frame_list(top, ast->stmts, off);
+            break;
+        case AST_FOR:
+            if (ast->forinit && ast->forinit->type == AST_DECL)
+                off = top = frame_place(ast->forinit->declvar, off);
+            top = frame_max(top, ast->forinit, off);
+            top = frame_max(top, ast->forcond, off);
+            top = frame_max(top, ast->forstep, off);
+            top = frame_max(top, ast->forbody, off);
+            break;
+        case AST_INLINE:
+            // a block of its own, the inlined calls of an expression share slots
+            top = frame_walk(ast->inlbody, off);
+            break;
+        case AST_FUNCALL:
+            top = frame_list(top, ast->args, off);
+            break;
+        case AST_DECL:
+            top = frame_walk(ast->declinit, off);
+            break;
+        case AST_ARRAY_INIT:
+            top = frame_list(top, ast->arrayinit, off);
+            break;
+        case AST_IF:
+        case AST_TERNARY:
+            top = frame_max(top, ast->cond, off);
+            top = frame_max(top, ast->then, off);
+            top = frame_max(top, ast->els, off);
+            break;
+        case AST_RETURN:
+            top = frame_walk(ast->retval, off);
+            break;
+        case AST_STRUCT_REF:
+            top = frame_walk(ast->struc, off);
+            break;
+        case AST_ADDR:
+        case AST_DEREF:
+        case PUNCT_PREINC:
+        case PUNCT_PREDEC:
+        case PUNCT_POSTINC:
+        case PUNCT_POSTDEC:
+        case '!':
+            top = frame_walk(ast->operand, off);
+            break;
+        default:
+            top = frame_max(top, ast->left, off);
+            top = frame_max(top, ast->right, off);
+    }
+    return top;
+}
+
+// every variable in its own slot, as the function's localvars list is laid out flat
+static int frame_flat_size(ast_t *func) {
+    int off = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        for (iter_t i = list_iter(pass ? func->localvars : func->params); !list_iter_end(i);) {
+            ast_t *v = list_iter_next(&i);
+            int align = frame_align(v->ctype);
+            if (off % align)
+                off += align - off % align;
+            off += v->ctype->size;
+        }
+    }
+    return (off + 7) & ~7;
+}
+
+static void frame_record(compiler_ctx_t *ctx, char *name, int before, int after) {
+    if (ctx->frame.nstats == ctx->frame.stats_cap) {
+        int cap = ctx->frame.stats_cap ? ctx->frame.stats_cap * 2 : 16;
+        ctx->frame.stats = util_heap(ctx->frame.stats, ctx->frame.stats_cap * sizeof(frame_stat_t), cap * sizeof(frame_stat_t));
+        ctx->frame.stats_cap = cap;
+    }
+    ctx->frame.stats[ctx->frame.nstats].name = name;
+    ctx->frame.stats[ctx->frame.nstats].before = before;
+    ctx->frame.stats[ctx->frame.nstats].after = after;
+    ctx->frame.nstats++;
+}
+
+int frame_layout(compiler_ctx_t *ctx, ast_t *func) {
+    int off = 0;
+
+    for (iter_t i = list_iter(func->localvars); !list_iter_end(i);)
+        ((ast_t*) list_iter_next(&i))->loff = FRAME_UNPLACED;
+
+    // parameters are stored by the prologue in argument order
+    for (iter_t i = list_iter(func->params); !list_iter_end(i);)
+        off = frame_place(list_iter_next(&i), off);
+    off = frame_walk(func->body, off);
+
+    // declarations the walk did not reach (removed by folding) still get a slot
+    for (iter_t i = list_iter(func->localvars); !list_iter_end(i);) {
+        ast_t *v = list_iter_next(&i);
+        if (v->loff == FRAME_UNPLACED)
+            off = frame_place(v, off);
+    }
+
+    int size = (off + 7) & ~7;
+    frame_record(ctx, func->fname, frame_flat_size(func), size);
+    return size;
+}
+
+void frame_stats(compiler_ctx_t *ctx, FILE *fp) {
+    int before = 0, after = 0;
+
+    for (int n = 0; n < ctx->frame.nstats; n++) {
+        fprintf(fp, "  %-16s %6d -> %6d bytes\n", ctx->frame.stats[n].name, ctx->frame.stats[n].before, ctx->frame.stats[n].after);
+        before += ctx->frame.stats[n].before;
+        after += ctx->frame.stats[n].after;
+    }
+    fprintf(fp, "frames: %d -> %d bytes\n", before, after);
+}
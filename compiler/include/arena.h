@@ -0,0 +1,147 @@
+/*
+ * @arena.h
+ *
+ * @brief C for Stack VM
+ * @details
+ * This is based on other projects:
+ *   A minimalist C compiler with x86_64 code generation: https://github.com/jserv/MazuCC
+ *   Others (see individual files)
+ *
+ *   please contact their authors for more information.
+ *
+ * @author Emiliano Augusto Gonzalez (egonzalez . hiperion @ gmail . com)
+ * @date 2024
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/stackvm_c_compiler
+ */
+
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @def ARENA_CHUNK_SIZE
+ * @brief Default size of a chunk obtained from malloc
+ *
+ */
+#define ARENA_CHUNK_SIZE (64 * 1024)
+
+/**
+ * @def ARENA_ALIGN
+ * @brief Alignment of every allocation
+ *
+ */
+#define ARENA_ALIGN      16
+
+/**
+ * @struct arena_chunk_s
+ * @brief
+ *
+ */
+typedef struct arena_chunk_s {
+    struct arena_chunk_s *next;
+                  size_t size; // usable bytes in data
+                  size_t used; // bump pointer
+                  size_t last; // offset of the last allocation (for arena_free)
+    _Alignas(ARENA_ALIGN) char data[];
+} arena_chunk_t;
+
+/**
+ * @struct
+ * @brief Allocation counters
+ *
+ */
+typedef struct {
+    unsigned long allocs;   // number of allocations
+    unsigned long bytes;    // bytes requested
+    unsigned long chunks;   // chunks obtained from malloc
+    unsigned long reserved; // bytes currently held in chunks
+    unsigned long peak;     // maximum of reserved
+} arena_stats_t;
+
+/**
+ * @struct arena_s
+ * @brief Bump pointer arena. Sub-arenas are released with their parent.
+ *
+ */
+typedef struct arena_s {
+     arena_chunk_t *chunk;         // current chunk, head of the chunk list
+    struct arena_s *parent;
+    struct arena_s *child;         // first sub-arena
+    struct arena_s *next, *prev;   // siblings
+            size_t chunk_size;
+     arena_stats_t stats;
+} arena_t;
+
+/**
+ * @fn arena_t arena_make*(arena_t*, size_t)
+ * @brief Create an arena. If parent is not NULL the new arena is a sub-arena of it.
+ *
+ * @param parent
+ * @param chunk_size 0 for ARENA_CHUNK_SIZE
+ * @return
+ */
+arena_t* arena_make(arena_t *parent, size_t chunk_size);
+
+/**
+ * @fn void arena_alloc*(arena_t*, size_t)
+ * @brief
+ *
+ * @param arena
+ * @param size
+ * @return
+ */
+void* arena_alloc(arena_t *arena, size_t size);
+
+/**
+ * @fn void arena_calloc*(arena_t*, size_t)
+ * @brief
+ *
+ * @param arena
+ * @param size
+ * @return
+ */
+void* arena_calloc(arena_t *arena, size_t size);
+
+/**
+ * @fn void arena_realloc*(arena_t*, void*, size_t, size_t)
+ * @brief Grow an allocation. Done in place when ptr is the last allocation of the arena.
+ *
+ * @param arena
+ * @param ptr
+ * @param old_size
+ * @param new_size
+ * @return
+ */
+void* arena_realloc(arena_t *arena, void *ptr, size_t old_size, size_t new_size);
+
+/**
+ * @fn bool arena_free(arena_t*, void*)
+ * @brief Give back ptr if it is the last allocation of the arena, otherwise do nothing.
+ *
+ * @param arena
+ * @param ptr
+ * @return true if memory was reclaimed
+ */
+bool arena_free(arena_t *arena, void *ptr);
+
+/**
+ * @fn void arena_release(arena_t*)
+ * @brief Release the arena, its sub-arenas and all their memory
+ *
+ * @param arena
+ */
+void arena_release(arena_t *arena);
+
+/**
+ * @fn void arena_get_stats(arena_t*, arena_stats_t*)
+ * @brief Counters of the arena added to those of all its sub-arenas
+ *
+ * @param arena
+ * @param stats
+ */
+void arena_get_stats(arena_t *arena, arena_stats_t *stats);
+
+#endif /* ARENA_H_ */
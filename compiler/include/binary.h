@@ -0,0 +1,202 @@
+/*
+ * @binary.h
+ *
+ * @brief C for Stack VM
+ * @details
+ * This is based on other projects:
+ *   A minimalist C compiler with x86_64 code generation: https://github.com/jserv/MazuCC
+ *   Others (see individual files)
+ *
+ *   please contact their authors for more information.
+ *
+ * @author Emiliano Augusto Gonzalez (egonzalez . hiperion @ gmail . com)
+ * @date 2024
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/stackvm_c_compiler
+ */
+
+#ifndef BINARY_H_
+#define BINARY_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "c_stackvm.h"
+#include "ir.h"
+#include "list.h"
+#include "symtab.h"
+
+/*
+ * Bytecode image (all fields little endian)
+ *
+ *    0  magic "SVMB"
+ *    4  u16 version
+ *    6  u16 reserved
+ *    8  u32 data size
+ *   12  u32 code size
+ *   16  u32 entry (code offset of main, BINARY_NONE if undefined)
+ *   20  u32 number of externs
+ *   24  u32 max operand stack depth of all functions
+ *   28  u32 reserved
+ *   32  data: loaded at address 0, frames are allocated after it
+ *       code
+ *       externs: u8 length + name, in index order
+ *
+ * Instructions are one opcode byte followed by the operand:
+ *   OPND_INT   i32 immediate
+ *   OPND_SYM   u32 data address
+ *   OPND_LABEL u32 code offset
+ *   OPND_CALL  u32 code offset, or BINARY_EXTERN | extern index, then u8 argument count
+ *   OPND_INT2  two i32 immediates
+ */
+
+/**
+ * @def BINARY_MAGIC
+ * @brief
+ *
+ */
+#define BINARY_MAGIC "SVMB"
+
+/**
+ * @def BINARY_VERSION
+ * @brief
+ *
+ */
+#define BINARY_VERSION 3
+
+/**
+ * @def BINARY_HEADER_LEN
+ * @brief
+ *
+ */
+#define BINARY_HEADER_LEN 32
+
+/**
+ * @def BINARY_EXTERN
+ * @brief Call target flag for functions provided by the VM
+ *
+ */
+#define BINARY_EXTERN 0x80000000u
+
+/**
+ * @def BINARY_NONE
+ * @brief
+ *
+ */
+#define BINARY_NONE 0xffffffffu
+
+/**
+ * @struct
+ * @brief Growable byte buffer
+ *
+ */
+typedef struct {
+    uint8_t *body;
+     size_t len;
+     size_t cap;
+} binary_buf_t;
+
+/**
+ * @struct
+ * @brief Operand resolved when the image is written
+ *
+ */
+typedef struct {
+    uint32_t pos;
+        char *name;
+         int kind;  // FIX_* or label index for code labels
+} binary_fixup_t;
+
+/**
+ * @struct
+ * @brief Image being built
+ *
+ */
+typedef struct {
+      binary_buf_t data;
+      binary_buf_t code;
+    binary_fixup_t *fixups;
+               int nfixups;
+               int fixups_cap;
+          symtab_t *data_syms;   // interned name -> offset + 1
+          symtab_t *func_syms;
+          symtab_t *extern_syms;
+            list_t *externs;
+          uint32_t maxstack;
+} binary_state_t;
+
+/**
+ * @fn int binary_insn_len(int)
+ * @brief Encoded length of an instruction
+ *
+ * @param op
+ * @return
+ */
+int binary_insn_len(int op);
+
+/**
+ * @fn void binary_data_label(compiler_ctx_t*, char*)
+ * @brief Define a data symbol at the current data offset
+ *
+ * @param ctx
+ * @param name
+ */
+void binary_data_label(compiler_ctx_t *ctx, char *name);
+
+/**
+ * @fn void binary_data_align(compiler_ctx_t*, int)
+ * @brief
+ *
+ * @param ctx
+ * @param align
+ */
+void binary_data_align(compiler_ctx_t *ctx, int align);
+
+/**
+ * @fn void binary_data_int(compiler_ctx_t*, int, int64_t)
+ * @brief Little endian integer of 1, 4 or 8 bytes
+ *
+ * @param ctx
+ * @param size
+ * @param val
+ */
+void binary_data_int(compiler_ctx_t *ctx, int size, int64_t val);
+
+/**
+ * @fn void binary_data_bytes(compiler_ctx_t*, const void*, int)
+ * @brief
+ *
+ * @param ctx
+ * @param ptr
+ * @param len
+ */
+void binary_data_bytes(compiler_ctx_t *ctx, const void *ptr, int len);
+
+/**
+ * @fn void binary_data_zero(compiler_ctx_t*, int)
+ * @brief
+ *
+ * @param ctx
+ * @param len
+ */
+void binary_data_zero(compiler_ctx_t *ctx, int len);
+
+/**
+ * @fn void binary_func(compiler_ctx_t*, ir_func_t*)
+ * @brief Encode a function. Code labels are resolved when the function ends,
+ *        data symbols and call targets when the image is written.
+ *
+ * @param ctx
+ * @param func
+ */
+void binary_func(compiler_ctx_t *ctx, ir_func_t *func);
+
+/**
+ * @fn void binary_write(compiler_ctx_t*)
+ * @brief Resolve the fixups and write the image to the output (see output.h)
+ *
+ * @param ctx
+ */
+void binary_write(compiler_ctx_t *ctx);
+
+#endif /* BINARY_H_ */
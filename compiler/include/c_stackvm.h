@@ -28,6 +28,13 @@
 #include "list.h"
 #include "util.h"
 
+/**
+ * @struct compiler_ctx_s
+ * @brief State of one compilation, see context.h
+ *
+ */
+typedef struct compiler_ctx_s compiler_ctx_t;
+
 /**
  * @def TAB_LEN
  * @brief
@@ -47,6 +54,34 @@ enum token_type {
     TTYPE_NUMBER,/**< TTYPE_NUMBER */
     TTYPE_CHAR,  /**< TTYPE_CHAR */
     TTYPE_STRING,/**< TTYPE_STRING */
+    TTYPE_KEYWORD,/**< TTYPE_KEYWORD */
+};
+
+/**
+ * @enum keyword
+ * @brief Keywords are pre-interned and carried by TTYPE_KEYWORD tokens
+ *
+ */
+enum keyword {
+    KW_NONE,   /**< KW_NONE (plain identifier) */
+    KW_VOID,   /**< KW_VOID */
+    KW_CHAR,   /**< KW_CHAR */
+    KW_INT,    /**< KW_INT */
+    KW_UINT,   /**< KW_UINT */
+#ifdef ALLOW_LONG
+    KW_LONG,   /**< KW_LONG */
+#endif
+    KW_FLOAT,  /**< KW_FLOAT */
+#ifdef ALLOW_DOUBLE
+    KW_DOUBLE, /**< KW_DOUBLE */
+#endif
+    KW_STRUCT, /**< KW_STRUCT */
+    KW_UNION,  /**< KW_UNION */
+    KW_IF,     /**< KW_IF */
+    KW_ELSE,   /**< KW_ELSE */
+    KW_FOR,    /**< KW_FOR */
+    KW_RETURN, /**< KW_RETURN */
+    KW_MAX,    /**< KW_MAX */
 };
 
 /**
@@ -57,6 +92,8 @@ enum token_type {
 typedef struct {
           int type;
     uintptr_t priv;
+     uint32_t pos; // span in the source buffer when priv is 0
+     uint32_t len;
 } token_t;
 
 /**
@@ -81,6 +118,7 @@ enum {
     AST_RETURN,        /**< AST_RETURN */
     AST_COMPOUND_STMT, /**< AST_COMPOUND_STMT */
     AST_STRUCT_REF,    /**< AST_STRUCT_REF */
+    AST_INLINE,        /**< AST_INLINE */
     PUNCT_EQ,          /**< PUNCT_EQ */
     PUNCT_INC,         /**< PUNCT_INC */
     PUNCT_DEC,         /**< PUNCT_DEC */
@@ -189,6 +227,7 @@ typedef struct ast_s {
                           list_t *params;
                           list_t *localvars;
                     struct ast_s *body;
+                  struct arena_s *arena; // holds the definition, see parser_func_free
                 };
             };
         };
@@ -228,6 +267,12 @@ typedef struct ast_s {
             struct ast_s *struc;
                     char *field; // specific to ast_to_string only
         };
+
+        // Inlined function call
+        struct {
+            struct ast_s *callee;  // AST_FUNC the body was copied from
+            struct ast_s *inlbody; // parameter declarations and the copied body
+        };
     };
 } ast_t;
 
@@ -277,7 +322,11 @@ typedef struct ast_s {
  * @brief
  *
  */
-#define get_strtok(tok)  get_token(tok, TTYPE_STRING, char*)
+#define get_strtok(ctx, tok)             \
+    ({                                   \
+        assert(get_ttype(tok) == TTYPE_STRING); \
+        lexer_token_text(ctx, tok);      \
+    })
 
 /**
  * @def get_ident
@@ -286,12 +335,23 @@ typedef struct ast_s {
  */
 #define get_ident(tok)   get_token(tok, TTYPE_IDENT, char*)
 
+/**
+ * @def get_keyword
+ * @brief
+ *
+ */
+#define get_keyword(tok) get_token(tok, TTYPE_KEYWORD, int)
+
 /**
  * @def get_number
  * @brief
  *
  */
-#define get_number(tok)  get_token(tok, TTYPE_NUMBER, char*)
+#define get_number(ctx, tok)             \
+    ({                                   \
+        assert(get_ttype(tok) == TTYPE_NUMBER); \
+        lexer_token_text(ctx, tok);      \
+    })
 
 /**
  * @def get_punct
@@ -18,19 +18,34 @@
 #ifndef CODEGEN_IR_H_
 #define CODEGEN_IR_H_
 
-/**
- * @def codegenir_emit
- * @brief
- *
- */
-#define codegenir_emit(...) codegenir_emitf(__LINE__, "\t" __VA_ARGS__)
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "c_stackvm.h"
+#include "ir.h"
+#include "symtab.h"
 
 /**
- * @def codegenir_emit_label
+ * @struct
  * @brief
  *
  */
-#define codegenir_emit_label(...) codegenir_emitf(__LINE__, __VA_ARGS__)
+typedef struct {
+         bool binary;
+         bool strings_done; // string literals written, by codegenir_emit_data_section
+         char *section;
+      ctype_t *rettype;
+    ir_func_t *func;
+        ast_t *curfunc;
+          int entry_label; // after the prologue, target of the self tail calls
+          int tailcalls;
+          int inline_end;  // end of the inlined body being generated, -1 outside of one
+          int depth;       // operand stack depth in cells at the current point of the function
+          int maxdepth;
+     symtab_t *defined;    // defined function -> list of its parameter types, the called names not in it are .extern
+     symtab_t *called;
+       list_t *callees;
+} codegenir_state_t;
 
 /**
  * @fn char codegenir_get_caller_list*(void)
@@ -41,27 +56,47 @@
 char* codegenir_get_caller_list(void);
 
 /**
- * @fn void codegenir_emitf(int, char*, ...)
+ * @fn void codegenir_emit_data_section(compiler_ctx_t*)
  * @brief
  *
- * @param line
- * @param fmt
+ * @param ctx
  */
-void codegenir_emitf(int line, char *fmt, ...);
+void codegenir_emit_data_section(compiler_ctx_t *ctx);
 
 /**
- * @fn void codegenir_emit_data_section(void)
+ * @fn void codegenir_emit_toplevel(compiler_ctx_t*, ast_t*)
  * @brief
  *
+ * @param ctx
+ * @param v
  */
-void codegenir_emit_data_section(void);
+void codegenir_emit_toplevel(compiler_ctx_t *ctx, ast_t *v);
 
 /**
- * @fn void codegenir_emit_toplevel(ast_t*)
- * @brief
+ * @fn void codegenir_set_binary(compiler_ctx_t*, bool)
+ * @brief Encode bytecode (see binary.h) instead of text assembly
  *
- * @param v
+ * @param ctx
+ * @param enable
+ */
+void codegenir_set_binary(compiler_ctx_t *ctx, bool enable);
+
+/**
+ * @fn void codegenir_emit_end(compiler_ctx_t*)
+ * @brief Declare the called functions that were not defined (handled by the VM),
+ *        or write the bytecode image
+ *
+ * @param ctx
+ */
+void codegenir_emit_end(compiler_ctx_t *ctx);
+
+/**
+ * @fn void codegenir_report(compiler_ctx_t*, FILE*)
+ * @brief Transformations made while generating code
+ *
+ * @param ctx
+ * @param fp
  */
-void codegenir_emit_toplevel(ast_t *v);
+void codegenir_report(compiler_ctx_t *ctx, FILE *fp);
 
 #endif /* CODEGEN_IR_H_ */
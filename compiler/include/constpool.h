@@ -0,0 +1,107 @@
+/*
+ * @constpool.h
+ *
+ * @brief C for Stack VM
+ * @details
+ * This is based on other projects:
+ *   A minimalist C compiler with x86_64 code generation: https://github.com/jserv/MazuCC
+ *   Others (see individual files)
+ *
+ *   please contact their authors for more information.
+ *
+ * @author Emiliano Augusto Gonzalez (egonzalez . hiperion @ gmail . com)
+ * @date 2024
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/stackvm_c_compiler
+ */
+
+#ifndef CONSTPOOL_H_
+#define CONSTPOOL_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "c_stackvm.h"
+#include "list.h"
+
+/**
+ * @def CONSTPOOL_IMM_MAX
+ * @brief Integral float constants up to this magnitude are pushed as immediates
+ *        (exact in a float)
+ *
+ */
+#define CONSTPOOL_IMM_MAX (1 << 24)
+
+/**
+ * @struct
+ * @brief Pooled constant
+ *
+ */
+typedef struct {
+         int mt;    // MT_F32 or MT_F64
+    uint64_t bits;  // bit pattern of the value in that type
+        char *label;
+} constpool_entry_t;
+
+/**
+ * @struct
+ * @brief Open addressing table of the pooled constants
+ *
+ */
+typedef struct {
+    constpool_entry_t **table;
+                  int size;
+                  int count;
+               list_t *entries; // in creation order
+                  int uses;
+                  int imms;
+} constpool_state_t;
+
+/**
+ * @fn bool constpool_is_imm(double)
+ * @brief Can the value be made with push + itof instead of a load
+ *
+ * @param val
+ * @return
+ */
+bool constpool_is_imm(double val);
+
+/**
+ * @fn char constpool_label*(compiler_ctx_t*, int, double)
+ * @brief Label of the pooled constant, added if needed
+ *
+ * @param ctx
+ * @param mt MT_F32 or MT_F64
+ * @param val
+ * @return
+ */
+char* constpool_label(compiler_ctx_t *ctx, int mt, double val);
+
+/**
+ * @fn list_t constpool_entries*(compiler_ctx_t*)
+ * @brief Pooled constants in creation order, to emit in the data section
+ *
+ * @param ctx
+ * @return list of constpool_entry_t
+ */
+list_t* constpool_entries(compiler_ctx_t *ctx);
+
+/**
+ * @fn void constpool_note_imm(compiler_ctx_t*)
+ * @brief Count a constant emitted as an immediate
+ *
+ * @param ctx
+ */
+void constpool_note_imm(compiler_ctx_t *ctx);
+
+/**
+ * @fn void constpool_stats(compiler_ctx_t*, FILE*)
+ * @brief Float constant data with and without the pool
+ *
+ * @param ctx
+ * @param fp
+ */
+void constpool_stats(compiler_ctx_t *ctx, FILE *fp);
+
+#endif /* CONSTPOOL_H_ */
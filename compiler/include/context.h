@@ -0,0 +1,123 @@
+/*
+ * @context.h
+ *
+ * @brief C for Stack VM
+ * @details
+ * This is based on other projects:
+ *   A minimalist C compiler with x86_64 code generation: https://github.com/jserv/MazuCC
+ *   Others (see individual files)
+ *
+ *   please contact their authors for more information.
+ *
+ * @author Emiliano Augusto Gonzalez (egonzalez . hiperion @ gmail . com)
+ * @date 2024
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/stackvm_c_compiler
+ */
+
+#ifndef CONTEXT_H_
+#define CONTEXT_H_
+
+#include <setjmp.h>
+#include <stdio.h>
+
+#include "binary.h"
+#include "codegenir.h"
+#include "constpool.h"
+#include "fold.h"
+#include "frame.h"
+#include "inliner.h"
+#include "intern.h"
+#include "lexer.h"
+#include "output.h"
+#include "parser.h"
+#include "peephole.h"
+#include "strpool.h"
+#include "super.h"
+#include "timing.h"
+#include "trace.h"
+#include "util.h"
+#include "verbose.h"
+
+/*
+ * Everything a compilation changes lives in its context. Each module keeps its
+ * part in a <module>_state_t and gets the context as the first parameter of
+ * its functions, so N threads can compile N inputs at the same time. Tables
+ * that never change (opcodes, keywords, rules) stay global.
+ *
+ * The allocator and util_error, which the containers (list, dict, symtab) use
+ * without a context parameter, work on the context the thread entered with
+ * compiler_ctx_enter, so a compilation also enters its context.
+ */
+
+/**
+ * @struct compiler_ctx_s
+ * @brief State of one compilation
+ *
+ */
+struct compiler_ctx_s {
+                 FILE *outfp;
+                 FILE *errfp;    // diagnostics and reports
+              jmp_buf *on_error; // util_error returns here instead of exiting when set
+
+         util_state_t util;
+       intern_state_t intern;
+        lexer_state_t lexer;
+       parser_state_t parser;
+         fold_state_t fold;
+      inliner_state_t inliner;
+        frame_state_t frame;
+      strpool_state_t strpool;
+    constpool_state_t constpool;
+     peephole_state_t peephole;
+        super_state_t super;
+       binary_state_t binary;
+    codegenir_state_t codegen;
+      verbose_state_t verbose;
+       timing_state_t timing;
+        trace_state_t trace;
+       output_state_t output;
+};
+
+/**
+ * @var compiler_ctx_current
+ * @brief Context of the calling thread, for util only
+ *
+ */
+extern _Thread_local compiler_ctx_t *compiler_ctx_current;
+
+/**
+ * @fn compiler_ctx_t compiler_ctx_make*(void)
+ * @brief New context with the default options
+ *
+ * @return
+ */
+compiler_ctx_t* compiler_ctx_make(void);
+
+/**
+ * @fn compiler_ctx_t compiler_ctx_enter*(compiler_ctx_t*)
+ * @brief Make c the context of the calling thread
+ *
+ * @param c
+ * @return previous context of the thread
+ */
+compiler_ctx_t* compiler_ctx_enter(compiler_ctx_t *c);
+
+/**
+ * @fn void compiler_ctx_copy_options(compiler_ctx_t*, const compiler_ctx_t*)
+ * @brief Copy the options of from: inline limit, disabled peephole rules and superinstructions
+ *
+ * @param to
+ * @param from
+ */
+void compiler_ctx_copy_options(compiler_ctx_t *to, const compiler_ctx_t *from);
+
+/**
+ * @fn void compiler_ctx_free(compiler_ctx_t*)
+ * @brief Release the context and everything allocated by its compilation
+ *
+ * @param c
+ */
+void compiler_ctx_free(compiler_ctx_t *c);
+
+#endif /* CONTEXT_H_ */
@@ -0,0 +1,53 @@
+/*
+ * @fold.h
+ *
+ * @brief C for Stack VM
+ * @details
+ * This is based on other projects:
+ *   A minimalist C compiler with x86_64 code generation: https://github.com/jserv/MazuCC
+ *   Others (see individual files)
+ *
+ *   please contact their authors for more information.
+ *
+ * @author Emiliano Augusto Gonzalez (egonzalez . hiperion @ gmail . com)
+ * @date 2024
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/stackvm_c_compiler
+ */
+
+#ifndef FOLD_H_
+#define FOLD_H_
+
+#include "c_stackvm.h"
+
+/**
+ * @struct
+ * @brief
+ *
+ */
+typedef struct {
+    ctype_t *rettype; // of the function being folded
+} fold_state_t;
+
+/**
+ * @fn ast_t fold_ast*(compiler_ctx_t*, ast_t*)
+ * @brief Fold constant expressions and simplify the tree (expressions or statements)
+ *
+ * @param ctx
+ * @param ast
+ * @return folded node, which may be ast itself
+ */
+ast_t* fold_ast(compiler_ctx_t *ctx, ast_t *ast);
+
+/**
+ * @fn ast_t fold_convert*(compiler_ctx_t*, ast_t*, ctype_t*)
+ * @brief Convert a literal to another scalar type at compile time
+ *
+ * @param ctx
+ * @param ast
+ * @param ctype
+ * @return the converted literal, or ast when it can not be converted
+ */
+ast_t* fold_convert(compiler_ctx_t *ctx, ast_t *ast, ctype_t *ctype);
+
+#endif /* FOLD_H_ */
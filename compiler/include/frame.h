@@ -0,0 +1,76 @@
+/*
+ * @frame.h
+ *
+ * @brief C for Stack VM
+ * @details
+ * This is based on other projects:
+ *   A minimalist C compiler with x86_64 code generation: https://github.com/jserv/MazuCC
+ *   Others (see individual files)
+ *
+ *   please contact their authors for more information.
+ *
+ * @author Emiliano Augusto Gonzalez (egonzalez . hiperion @ gmail . com)
+ * @date 2024
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/stackvm_c_compiler
+ */
+
+#ifndef FRAME_H_
+#define FRAME_H_
+
+#include <stdio.h>
+
+#include "c_stackvm.h"
+
+/**
+ * @struct
+ * @brief Frame size of a function without and with slot sharing
+ *
+ */
+typedef struct {
+    char *name;
+     int before;
+     int after;
+} frame_stat_t;
+
+/**
+ * @struct
+ * @brief
+ *
+ */
+typedef struct {
+    frame_stat_t *stats;
+             int nstats;
+             int stats_cap;
+} frame_state_t;
+
+/**
+ * @fn int frame_align(ctype_t*)
+ * @brief Alignment of a variable of this type
+ *
+ * @param ctype
+ * @return
+ */
+int frame_align(ctype_t *ctype);
+
+/**
+ * @fn int frame_layout(compiler_ctx_t*, ast_t*)
+ * @brief Set the frame offset (loff) of the parameters and locals of a function.
+ *        Variables of sibling scopes share slots.
+ *
+ * @param ctx
+ * @param func
+ * @return frame size, a multiple of 8
+ */
+int frame_layout(compiler_ctx_t *ctx, ast_t *func);
+
+/**
+ * @fn void frame_stats(compiler_ctx_t*, FILE*)
+ * @brief Frame size of each function, with and without slot sharing
+ *
+ * @param ctx
+ * @param fp
+ */
+void frame_stats(compiler_ctx_t *ctx, FILE *fp);
+
+#endif /* FRAME_H_ */
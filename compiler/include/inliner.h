@@ -0,0 +1,133 @@
+/*
+ * @inliner.h
+ *
+ * @brief C for Stack VM
+ * @details
+ * This is based on other projects:
+ *   A minimalist C compiler with x86_64 code generation: https://github.com/jserv/MazuCC
+ *   Others (see individual files)
+ *
+ *   please contact their authors for more information.
+ *
+ * @author Emiliano Augusto Gonzalez (egonzalez . hiperion @ gmail . com)
+ * @date 2024
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/stackvm_c_compiler
+ */
+
+#ifndef INLINER_H_
+#define INLINER_H_
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "c_stackvm.h"
+#include "list.h"
+#include "symtab.h"
+
+/**
+ * @def INLINER_DEFAULT_LIMIT
+ * @brief Largest leaf function body, in AST nodes, inlined by default
+ *
+ */
+#define INLINER_DEFAULT_LIMIT 40
+
+/**
+ * @def INLINER_WINDOW
+ * @brief Inlining candidates whose AST the streaming inliner keeps, the older
+ *        ones can no longer be inlined
+ *
+ */
+#define INLINER_WINDOW 256
+
+/**
+ * @struct
+ * @brief Call site seen by the inliner
+ *
+ */
+typedef struct {
+    char *caller;
+    char *callee;
+     int cost;
+    char *why;     // NULL when inlined
+} inliner_site_t;
+
+/**
+ * @struct
+ * @brief
+ *
+ */
+typedef struct {
+               int limit;
+          symtab_t *funcs;    // name -> function info
+             ast_t *caller;
+    inliner_site_t *sites;
+               int nsites;
+               int sites_cap;
+              bool streaming; // functions added by inliner_add
+            list_t *all;      // of the registered functions, in source order
+            list_t *stack;    // of the recursion walk
+               int index;     // last visit order given by the walk
+          symtab_t *called;   // streaming: names called so far
+               int forward;   // streaming: functions defined after a call to them
+               int walked;    // streaming: forward at the last walk of all functions
+            list_t *window;   // streaming: last candidates, the newest first
+               // state of the visitors
+               int cost;
+               int ncalls;
+            list_t *calls;
+            list_t *inlined;
+             ast_t **map_from;
+             ast_t **map_to;
+               int map_len;
+} inliner_state_t;
+
+/**
+ * @fn void inliner_set_limit(compiler_ctx_t*, int)
+ * @brief Set the cost limit, 0 disables inlining
+ *
+ * @param ctx
+ * @param limit
+ */
+void inliner_set_limit(compiler_ctx_t *ctx, int limit);
+
+/**
+ * @fn int inliner_run(compiler_ctx_t*, list_t*)
+ * @brief Replace calls to small non recursive functions by a copy of their body
+ *
+ * @param ctx
+ * @param toplevels
+ * @return number of inlined call sites
+ */
+int inliner_run(compiler_ctx_t *ctx, list_t *toplevels);
+
+/**
+ * @fn void inliner_add(compiler_ctx_t*, ast_t*)
+ * @brief Inline the calls of a function to the ones added before it, the
+ *        streaming counterpart of inliner_run
+ *
+ * @param ctx
+ * @param func AST_FUNC
+ */
+void inliner_add(compiler_ctx_t *ctx, ast_t *func);
+
+/**
+ * @fn void inliner_release(compiler_ctx_t*, ast_t*)
+ * @brief Free a generated function, or leave it to the inliner while it can
+ *        still be inlined
+ *
+ * @param ctx
+ * @param func AST_FUNC
+ */
+void inliner_release(compiler_ctx_t *ctx, ast_t *func);
+
+/**
+ * @fn void inliner_report(compiler_ctx_t*, FILE*)
+ * @brief Call sites inlined or left as calls, and why
+ *
+ * @param ctx
+ * @param fp
+ */
+void inliner_report(compiler_ctx_t *ctx, FILE *fp);
+
+#endif /* INLINER_H_ */
@@ -0,0 +1,114 @@
+/*
+ * @intern.h
+ *
+ * @brief C for Stack VM
+ * @details
+ * This is based on other projects:
+ *   A minimalist C compiler with x86_64 code generation: https://github.com/jserv/MazuCC
+ *   Others (see individual files)
+ *
+ *   please contact their authors for more information.
+ *
+ * @author Emiliano Augusto Gonzalez (egonzalez . hiperion @ gmail . com)
+ * @date 2024
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/stackvm_c_compiler
+ */
+
+#ifndef INTERN_H_
+#define INTERN_H_
+
+#include <stdint.h>
+
+#include "c_stackvm.h"
+
+/**
+ * @def INTERN_INIT_SIZE
+ * @brief Initial number of slots of the interning table (power of 2)
+ *
+ */
+#define INTERN_INIT_SIZE 1024
+
+/**
+ * @struct
+ * @brief
+ *
+ */
+typedef struct {
+        char *str;
+    uint32_t hash;
+         int len;
+         int kind; // enum keyword, KW_NONE for identifiers
+} intern_entry_t;
+
+/**
+ * @struct
+ * @brief Interning table of a compilation
+ *
+ */
+typedef struct {
+    intern_entry_t *table;
+               int table_cap;
+               int table_qty;
+} intern_state_t;
+
+/**
+ * @fn uint32_t intern_hash(const char*, int)
+ * @brief FNV-1a
+ *
+ * @param str
+ * @param len
+ * @return
+ */
+uint32_t intern_hash(const char *str, int len);
+
+/**
+ * @fn intern_entry_t intern_entry*(compiler_ctx_t*, const char*, int)
+ * @brief Intern str[0..len). The entry is valid until the next call that interns a new string.
+ *
+ * @param ctx
+ * @param str
+ * @param len
+ * @return
+ */
+intern_entry_t* intern_entry(compiler_ctx_t *ctx, const char *str, int len);
+
+/**
+ * @fn char intern_keyword_name*(int)
+ * @brief Spelling of a keyword
+ *
+ * @param kind
+ * @return
+ */
+char* intern_keyword_name(int kind);
+
+/**
+ * @fn char intern_string*(compiler_ctx_t*, const char*, int)
+ * @brief Return the unique copy of str[0..len). Equal strings give equal pointers.
+ *
+ * @param ctx
+ * @param str
+ * @param len
+ * @return
+ */
+char* intern_string(compiler_ctx_t *ctx, const char *str, int len);
+
+/**
+ * @fn char intern_cstring*(compiler_ctx_t*, const char*)
+ * @brief
+ *
+ * @param ctx
+ * @param str
+ * @return
+ */
+char* intern_cstring(compiler_ctx_t *ctx, const char *str);
+
+/**
+ * @fn void intern_reset(compiler_ctx_t*)
+ * @brief Forget every interned string. Called when the arena holding them is released.
+ *
+ * @param ctx
+ */
+void intern_reset(compiler_ctx_t *ctx);
+
+#endif /* INTERN_H_ */
@@ -0,0 +1,183 @@
+/*
+ * @ir.h
+ *
+ * @brief C for Stack VM
+ * @details
+ * This is based on other projects:
+ *   A minimalist C compiler with x86_64 code generation: https://github.com/jserv/MazuCC
+ *   Others (see individual files)
+ *
+ *   please contact their authors for more information.
+ *
+ * @author Emiliano Augusto Gonzalez (egonzalez . hiperion @ gmail . com)
+ * @date 2024
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/stackvm_c_compiler
+ */
+
+#ifndef IR_H_
+#define IR_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "c_stackvm.h"
+#include "opcodes.h"
+
+/**
+ * @def IR_LABEL
+ * @brief Pseudo instruction placing a label (label field)
+ *
+ */
+#define IR_LABEL OP_MAX
+
+/**
+ * @struct
+ * @brief Instruction record. The immediate is read according to the operand kind of the opcode.
+ *
+ */
+typedef struct {
+    uint16_t op;
+    uint16_t nargs; // OPND_CALL
+    union {
+        int32_t label; // OPND_LABEL and IR_LABEL
+        int32_t imm;   // second immediate of OPND_INT2
+    };
+    union {
+        int64_t ival; // OPND_INT
+           char *sym; // OPND_SYM and OPND_CALL
+    };
+} ir_insn_t;
+
+/**
+ * @struct
+ * @brief
+ *
+ */
+typedef struct {
+          char *name;
+     ir_insn_t *insns;
+           int len;
+           int cap;
+          char **labels;    // label index -> name
+           int nlabels;
+           int labels_cap;
+           int nargs;       // operand stack depth at entry
+           int maxstack;
+} ir_func_t;
+
+/**
+ * @fn ir_func_t ir_func_make*(char*)
+ * @brief
+ *
+ * @param name
+ * @return
+ */
+ir_func_t* ir_func_make(char *name);
+
+/**
+ * @fn void ir_func_free(ir_func_t*)
+ * @brief
+ *
+ * @param func
+ */
+void ir_func_free(ir_func_t *func);
+
+/**
+ * @fn int ir_label_make(compiler_ctx_t*, ir_func_t*)
+ * @brief New label, named with parser_make_label
+ *
+ * @param ctx
+ * @param func
+ * @return label index
+ */
+int ir_label_make(compiler_ctx_t *ctx, ir_func_t *func);
+
+/**
+ * @fn ir_insn_t ir_emit*(ir_func_t*, int)
+ * @brief Append a zeroed instruction
+ *
+ * @param func
+ * @param op
+ * @return
+ */
+ir_insn_t* ir_emit(ir_func_t *func, int op);
+
+/**
+ * @fn void ir_emit_int(ir_func_t*, int, int64_t)
+ * @brief
+ *
+ * @param func
+ * @param op
+ * @param val
+ */
+void ir_emit_int(ir_func_t *func, int op, int64_t val);
+
+/**
+ * @fn void ir_emit_sym(ir_func_t*, int, char*)
+ * @brief
+ *
+ * @param func
+ * @param op
+ * @param sym
+ */
+void ir_emit_sym(ir_func_t *func, int op, char *sym);
+
+/**
+ * @fn void ir_emit_jump(ir_func_t*, int, int)
+ * @brief
+ *
+ * @param func
+ * @param op
+ * @param label
+ */
+void ir_emit_jump(ir_func_t *func, int op, int label);
+
+/**
+ * @fn void ir_emit_call(ir_func_t*, char*, int)
+ * @brief
+ *
+ * @param func
+ * @param fname
+ * @param nargs
+ */
+void ir_emit_call(ir_func_t *func, char *fname, int nargs);
+
+/**
+ * @fn void ir_place_label(ir_func_t*, int)
+ * @brief
+ *
+ * @param func
+ * @param label
+ */
+void ir_place_label(ir_func_t *func, int label);
+
+/**
+ * @fn bool ir_is_branch(int)
+ * @brief Instruction ends a basic block
+ *
+ * @param op
+ * @return
+ */
+bool ir_is_branch(int op);
+
+/**
+ * @fn int ir_max_depth(ir_func_t*)
+ * @brief Maximum operand stack depth, following the depth at each label
+ *
+ * @param func
+ * @return
+ */
+int ir_max_depth(ir_func_t *func);
+
+/**
+ * @fn void ir_print_func(compiler_ctx_t*, ir_func_t*)
+ * @brief Text assembly of the function, to the output buffer (see output.h)
+ *
+ * @param ctx
+ * @param func
+ */
+void ir_print_func(compiler_ctx_t *ctx, ir_func_t *func);
+
+#endif /* IR_H_ */
@@ -19,6 +19,88 @@
 #define LEXER_H_
 
 #include <stdbool.h>
+#include <stddef.h>
+
+#include "c_stackvm.h"
+
+/**
+ * @def LEXER_IDENT_LEN
+ * @brief Identifiers up to this length are interned without any allocation
+ *
+ */
+#define LEXER_IDENT_LEN 128
+
+/**
+ * @def LEXER_NUMBER_LEN
+ * @brief Size of the local buffer used to read number tokens
+ *
+ */
+#define LEXER_NUMBER_LEN 64
+
+/**
+ * @struct
+ * @brief Input position of a compilation
+ *
+ */
+typedef struct {
+          bool ungotten;
+       token_t ungotten_buf;
+    const char *src;     // source buffer, NULL when reading from stdin
+        size_t src_len;
+        size_t src_pos;
+        size_t map_len;  // length of the mapping when src is a mapped file
+} lexer_state_t;
+
+/**
+ * @fn void lexer_set_buffer(compiler_ctx_t*, const char*, size_t)
+ * @brief Lex from buf instead of stdin. Tokens refer to buf, which must outlive them.
+ *
+ * @param ctx
+ * @param buf
+ * @param len
+ */
+void lexer_set_buffer(compiler_ctx_t *ctx, const char *buf, size_t len);
+
+/**
+ * @fn bool lexer_map_file(compiler_ctx_t*, const char*)
+ * @brief Map path in memory and lex from the mapping
+ *
+ * @param ctx
+ * @param path
+ * @return false if the file can't be mapped
+ */
+bool lexer_map_file(compiler_ctx_t *ctx, const char *path);
+
+/**
+ * @fn void lexer_close(compiler_ctx_t*)
+ * @brief Drop the source buffer (unmapping it if needed) and go back to stdin
+ *
+ * @param ctx
+ */
+void lexer_close(compiler_ctx_t *ctx);
+
+/**
+ * @fn char lexer_token_cstring*(compiler_ctx_t*, const token_t, char*, int)
+ * @brief Text of a number or string token. Span tokens are copied to buf when they fit,
+ *        otherwise to the arena.
+ *
+ * @param ctx
+ * @param tok
+ * @param buf may be NULL
+ * @param size
+ * @return
+ */
+char* lexer_token_cstring(compiler_ctx_t *ctx, const token_t tok, char *buf, int size);
+
+/**
+ * @fn char lexer_token_text*(compiler_ctx_t*, const token_t)
+ * @brief Owned text of a number or string token
+ *
+ * @param ctx
+ * @param tok
+ * @return
+ */
+char* lexer_token_text(compiler_ctx_t *ctx, const token_t tok);
 
 /**
  * @fn token_t lexer_make_token(enum token_type, uintptr_t)
@@ -31,79 +113,88 @@
 token_t lexer_make_token(enum token_type type, uintptr_t data);
 
 /**
- * @fn int lexer_getc_nonspace(void)
+ * @fn int lexer_getc_nonspace(compiler_ctx_t*)
  * @brief
  *
+ * @param ctx
  * @return
  */
-int lexer_getc_nonspace(void);
+int lexer_getc_nonspace(compiler_ctx_t *ctx);
 
 /**
- * @fn token_t lexer_read_number(char)
+ * @fn token_t lexer_read_number(compiler_ctx_t*, char)
  * @brief
  *
+ * @param ctx
  * @param c
  * @return
  */
-token_t lexer_read_number(char c);
+token_t lexer_read_number(compiler_ctx_t *ctx, char c);
 
 /**
- * @fn token_t lexer_read_char(void)
+ * @fn token_t lexer_read_char(compiler_ctx_t*)
  * @brief
  *
+ * @param ctx
  * @return
  */
-token_t lexer_read_char(void);
+token_t lexer_read_char(compiler_ctx_t *ctx);
 
 /**
- * @fn token_t lexer_read_string(void)
+ * @fn token_t lexer_read_string(compiler_ctx_t*)
  * @brief
  *
+ * @param ctx
  * @return
  */
-token_t lexer_read_string(void);
+token_t lexer_read_string(compiler_ctx_t *ctx);
 
 /**
- * @fn token_t lexer_read_ident(char)
+ * @fn token_t lexer_read_ident(compiler_ctx_t*, char)
  * @brief
  *
+ * @param ctx
  * @param c
  * @return
  */
-token_t lexer_read_ident(char c);
+token_t lexer_read_ident(compiler_ctx_t *ctx, char c);
 
 /**
- * @fn void lexer_skip_line_comment(void)
+ * @fn void lexer_skip_line_comment(compiler_ctx_t*)
  * @brief
  *
+ * @param ctx
  */
-void lexer_skip_line_comment(void);
+void lexer_skip_line_comment(compiler_ctx_t *ctx);
 
 /**
- * @fn void lexer_skip_block_comment(void)
+ * @fn void lexer_skip_block_comment(compiler_ctx_t*)
  * @brief
  *
+ * @param ctx
  */
-void lexer_skip_block_comment(void);
+void lexer_skip_block_comment(compiler_ctx_t *ctx);
 
 /**
- * @fn token_t lexer_read_rep(int, int, int)
+ * @fn token_t lexer_read_rep(compiler_ctx_t*, int, int, int)
  * @brief
  *
+ * @param ctx
  * @param expect
  * @param t1
  * @param t2
  * @return
  */
-token_t lexer_read_rep(int expect, int t1, int t2);
+token_t lexer_read_rep(compiler_ctx_t *ctx, int expect, int t1, int t2);
 
 /**
- * @fn token_t lexer_read_token_int(void)
+ * @fn token_t lexer_read_token_int(compiler_ctx_t*)
  * @brief
  *
+ * @param ctx
  * @return
  */
-token_t lexer_read_token_int(void);
+token_t lexer_read_token_int(compiler_ctx_t *ctx);
 
 /**
  * @fn bool lexer_is_punct(const token_t, int)
@@ -116,27 +207,30 @@ token_t lexer_read_token_int(void);
 bool lexer_is_punct(const token_t tok, int c);
 
 /**
- * @fn void lexer_unget_token(const token_t)
+ * @fn void lexer_unget_token(compiler_ctx_t*, const token_t)
  * @brief
  *
+ * @param ctx
  * @param tok
  */
-void lexer_unget_token(const token_t tok);
+void lexer_unget_token(compiler_ctx_t *ctx, const token_t tok);
 
 /**
- * @fn token_t lexer_peek_token(void)
+ * @fn token_t lexer_peek_token(compiler_ctx_t*)
  * @brief
  *
+ * @param ctx
  * @return
  */
-token_t lexer_peek_token(void);
+token_t lexer_peek_token(compiler_ctx_t *ctx);
 
 /**
- * @fn token_t lexer_read_token(void)
+ * @fn token_t lexer_read_token(compiler_ctx_t*)
  * @brief
  *
+ * @param ctx
  * @return
  */
-token_t lexer_read_token(void);
+token_t lexer_read_token(compiler_ctx_t *ctx);
 
 #endif /* LEXER_H_ */
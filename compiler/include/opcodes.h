@@ -0,0 +1,216 @@
+/*
+ * @opcodes.h
+ *
+ * @brief C for Stack VM
+ * @details
+ * This is based on other projects:
+ *   A minimalist C compiler with x86_64 code generation: https://github.com/jserv/MazuCC
+ *   Others (see individual files)
+ *
+ *   please contact their authors for more information.
+ *
+ * @author Emiliano Augusto Gonzalez (egonzalez . hiperion @ gmail . com)
+ * @date 2024
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/stackvm_c_compiler
+ */
+
+#ifndef OPCODES_H_
+#define OPCODES_H_
+
+/*
+ * Stack VM machine model
+ *
+ *   - operand stack of 64 bit cells. Integers are sign extended (zero extended for uint),
+ *     floats are kept as double.
+ *   - byte addressed little endian memory holding the data section and the frames.
+ *   - call f, n: the n arguments stay on the operand stack, the callee moves them
+ *     into its frame with stl after enter. The VM records the stack level below the arguments.
+ *   - ret: pops the return value, drops the frame, cuts the operand stack back to the level
+ *     recorded by call (extra arguments) and pushes the value for the caller.
+ *   - calls to functions declared with .extern are handled by the VM (printf, exit, ...).
+ */
+
+/**
+ * @enum
+ * @brief Memory access type
+ *
+ */
+enum {
+    MT_I8,  /**< MT_I8 (char) */
+    MT_I32, /**< MT_I32 (int) */
+    MT_U32, /**< MT_U32 (uint) */
+    MT_I64, /**< MT_I64 (pointer) */
+    MT_F32, /**< MT_F32 (float) */
+    MT_F64, /**< MT_F64 (double) */
+};
+
+/**
+ * @enum opcode
+ * @brief
+ *
+ */
+enum opcode {
+    OP_NOP,    /**< OP_NOP */
+    OP_PUSH,   /**< OP_PUSH imm: ( -- imm) */
+    OP_DROP,   /**< OP_DROP: (a -- ) */
+    OP_DUP,    /**< OP_DUP: (a -- a a) */
+    OP_SWAP,   /**< OP_SWAP: (a b -- b a) */
+    OP_OVER,   /**< OP_OVER: (a b -- a b a) */
+    OP_LEA,    /**< OP_LEA off: ( -- fp + off) */
+    OP_GADDR,  /**< OP_GADDR sym: ( -- address of sym) */
+    OP_LD_I8,  /**< OP_LD_I8: (addr -- v) */
+    OP_LD_I32, /**< OP_LD_I32 */
+    OP_LD_U32, /**< OP_LD_U32 */
+    OP_LD_I64, /**< OP_LD_I64 */
+    OP_LD_F32, /**< OP_LD_F32 */
+    OP_LD_F64, /**< OP_LD_F64 */
+    OP_ST_I8,  /**< OP_ST_I8: (v addr -- ) */
+    OP_ST_I32, /**< OP_ST_I32 */
+    OP_ST_I64, /**< OP_ST_I64 */
+    OP_ST_F32, /**< OP_ST_F32 */
+    OP_ST_F64, /**< OP_ST_F64 */
+    OP_LDL_I8, /**< OP_LDL_I8 off: ( -- v) */
+    OP_LDL_I32,/**< OP_LDL_I32 */
+    OP_LDL_U32,/**< OP_LDL_U32 */
+    OP_LDL_I64,/**< OP_LDL_I64 */
+    OP_LDL_F32,/**< OP_LDL_F32 */
+    OP_LDL_F64,/**< OP_LDL_F64 */
+    OP_STL_I8, /**< OP_STL_I8 off: (v -- ) */
+    OP_STL_I32,/**< OP_STL_I32 */
+    OP_STL_I64,/**< OP_STL_I64 */
+    OP_STL_F32,/**< OP_STL_F32 */
+    OP_STL_F64,/**< OP_STL_F64 */
+    OP_ADD,    /**< OP_ADD: (a b -- a+b) */
+    OP_SUB,    /**< OP_SUB */
+    OP_MUL,    /**< OP_MUL */
+    OP_DIV,    /**< OP_DIV */
+    OP_UDIV,   /**< OP_UDIV */
+    OP_AND,    /**< OP_AND */
+    OP_OR,     /**< OP_OR */
+    OP_SHL,    /**< OP_SHL */
+    OP_SHR,    /**< OP_SHR (arithmetic) */
+    OP_USHR,   /**< OP_USHR (logical) */
+    OP_LT,     /**< OP_LT: (a b -- a<b) */
+    OP_GT,     /**< OP_GT */
+    OP_ULT,    /**< OP_ULT */
+    OP_UGT,    /**< OP_UGT */
+    OP_EQ,     /**< OP_EQ */
+    OP_NOT,    /**< OP_NOT: (a -- a==0) */
+    OP_U32,    /**< OP_U32: (a -- a & 0xffffffff) */
+    OP_SX_I8,  /**< OP_SX_I8: (a -- low 8 bits of a, sign extended) */
+    OP_SX_I32, /**< OP_SX_I32: (a -- low 32 bits of a, sign extended) */
+    OP_FADD,   /**< OP_FADD */
+    OP_FSUB,   /**< OP_FSUB */
+    OP_FMUL,   /**< OP_FMUL */
+    OP_FDIV,   /**< OP_FDIV */
+    OP_FLT,    /**< OP_FLT */
+    OP_FGT,    /**< OP_FGT */
+    OP_FEQ,    /**< OP_FEQ */
+    OP_ITOF,   /**< OP_ITOF */
+    OP_FTOI,   /**< OP_FTOI */
+    OP_JMP,    /**< OP_JMP label */
+    OP_JZ,     /**< OP_JZ label: (a -- ) */
+    OP_JNZ,    /**< OP_JNZ label: (a -- ) */
+    OP_CALL,   /**< OP_CALL sym, nargs: (args -- ret) */
+    OP_RET,    /**< OP_RET: (v -- ) */
+    OP_ENTER,  /**< OP_ENTER size */
+
+    // superinstructions, selected by super_run from the primitive sequences
+    OP_ADDI,     /**< OP_ADDI imm: push imm, add */
+    OP_SUBI,     /**< OP_SUBI imm: push imm, sub */
+    OP_MULI,     /**< OP_MULI imm: push imm, mul */
+    OP_LDL2_I32, /**< OP_LDL2_I32 a, b: ldl.i32 a, ldl.i32 b */
+    OP_IXL_I32,  /**< OP_IXL_I32 off, scale: (addr -- addr + [fp + off] * scale) */
+    OP_INCL_I32, /**< OP_INCL_I32 off, imm: ldl.i32 off, push imm, add, stl.i32 off */
+    OP_JLT,      /**< OP_JLT label: lt, jnz */
+    OP_JGE,      /**< OP_JGE label: lt, jz */
+    OP_JGT,      /**< OP_JGT label: gt, jnz */
+    OP_JLE,      /**< OP_JLE label: gt, jz */
+    OP_JEQ,      /**< OP_JEQ label: eq, jnz */
+    OP_JNE,      /**< OP_JNE label: eq, jz */
+    OP_PUSHF,    /**< OP_PUSHF imm: push imm, itof */
+    OP_MAX,      /**< OP_MAX */
+};
+
+/**
+ * @enum
+ * @brief Kind of operand of an instruction
+ *
+ */
+enum {
+    OPND_NONE,  /**< OPND_NONE */
+    OPND_INT,   /**< OPND_INT */
+    OPND_SYM,   /**< OPND_SYM (data or function symbol) */
+    OPND_LABEL, /**< OPND_LABEL (code label) */
+    OPND_CALL,  /**< OPND_CALL (symbol and argument count) */
+    OPND_INT2,  /**< OPND_INT2 (two immediates) */
+};
+
+/**
+ * @struct
+ * @brief
+ *
+ */
+typedef struct {
+    char *name;
+     int pop;     // cells popped, -1 for OP_CALL (argument count)
+     int push;    // cells pushed
+     int operand;
+} opcode_info_t;
+
+/**
+ * @fn opcode_info_t opcodes_info*(int)
+ * @brief
+ *
+ * @param op
+ * @return
+ */
+const opcode_info_t* opcodes_info(int op);
+
+/**
+ * @fn int opcodes_find(const char*)
+ * @brief Opcode from its mnemonic
+ *
+ * @param name
+ * @return opcode or -1
+ */
+int opcodes_find(const char *name);
+
+/**
+ * @fn int opcodes_load(int)
+ * @brief Load through an address for a memory access type
+ *
+ * @param mt
+ * @return
+ */
+int opcodes_load(int mt);
+
+/**
+ * @fn int opcodes_store(int)
+ * @brief Store through an address for a memory access type
+ *
+ * @param mt
+ * @return
+ */
+int opcodes_store(int mt);
+
+/**
+ * @fn int opcodes_load_local(int)
+ * @brief Frame relative load for a memory access type
+ *
+ * @param mt
+ * @return
+ */
+int opcodes_load_local(int mt);
+
+/**
+ * @fn int opcodes_store_local(int)
+ * @brief Frame relative store for a memory access type
+ *
+ * @param mt
+ * @return
+ */
+int opcodes_store_local(int mt);
+
+#endif /* OPCODES_H_ */
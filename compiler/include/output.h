@@ -0,0 +1,96 @@
+/*
+ * @output.h
+ *
+ * @brief C for Stack VM
+ * @details
+ * This is based on other projects:
+ *   A minimalist C compiler with x86_64 code generation: https://github.com/jserv/MazuCC
+ *   Others (see individual files)
+ *
+ *   please contact their authors for more information.
+ *
+ * @author Emiliano Augusto Gonzalez (egonzalez . hiperion @ gmail . com)
+ * @date 2024
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/stackvm_c_compiler
+ */
+
+#ifndef OUTPUT_H_
+#define OUTPUT_H_
+
+#include <stddef.h>
+
+#include "c_stackvm.h"
+
+/**
+ * @def OUTPUT_BUFFER_SIZE
+ * @brief Bytes of output kept before they are written to ctx->outfp
+ *
+ */
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+
+/**
+ * @struct
+ * @brief
+ *
+ */
+typedef struct {
+      char *buf; // OUTPUT_BUFFER_SIZE bytes, allocated by the first write
+    size_t len;
+} output_state_t;
+
+/**
+ * @fn void output_write(compiler_ctx_t*, const void*, size_t)
+ * @brief
+ *
+ * @param ctx
+ * @param data
+ * @param len
+ */
+void output_write(compiler_ctx_t *ctx, const void *data, size_t len);
+
+/**
+ * @fn void output_str(compiler_ctx_t*, const char*)
+ * @brief
+ *
+ * @param ctx
+ * @param str
+ */
+void output_str(compiler_ctx_t *ctx, const char *str);
+
+/**
+ * @fn void output_char(compiler_ctx_t*, char)
+ * @brief
+ *
+ * @param ctx
+ * @param c
+ */
+void output_char(compiler_ctx_t *ctx, char c);
+
+/**
+ * @fn void output_int(compiler_ctx_t*, long)
+ * @brief Decimal, without printf
+ *
+ * @param ctx
+ * @param val
+ */
+void output_int(compiler_ctx_t *ctx, long val);
+
+/**
+ * @fn void output_printf(compiler_ctx_t*, const char*, ...)
+ * @brief For what the other writers can't format, as floats
+ *
+ * @param ctx
+ * @param fmt
+ */
+void output_printf(compiler_ctx_t *ctx, const char *fmt, ...);
+
+/**
+ * @fn void output_flush(compiler_ctx_t*)
+ * @brief Write the buffered output to ctx->outfp
+ *
+ * @param ctx
+ */
+void output_flush(compiler_ctx_t *ctx);
+
+#endif /* OUTPUT_H_ */
@@ -24,6 +24,7 @@
 #include "c_stackvm.h"
 #include "dict.h"
 #include "list.h"
+#include "symtab.h"
 
 /**
  * @def MAX_ARGS
@@ -47,99 +48,125 @@
 #define MAX_ALIGN   16
 
 /**
- * @fn ast_t parser_ast_uop*(int, ctype_t*, ast_t*)
+ * @struct
+ * @brief Scopes, types and literals of a compilation
+ *
+ */
+typedef struct {
+           list_t *strings;     // string literals, emitted by the data section
+         symtab_t *env;
+         symtab_t *struct_defs;
+         symtab_t *union_defs;
+           list_t *localvars;   // of the function being parsed
+              int labelseq;
+    unsigned long nodes;        // AST nodes made by the parser
+    unsigned long scopes;
+} parser_state_t;
+
+/**
+ * @fn ast_t parser_ast_uop*(compiler_ctx_t*, int, ctype_t*, ast_t*)
  * @brief
  *
+ * @param ctx
  * @param type
  * @param ctype
  * @param operand
  * @return
  */
-ast_t* parser_ast_uop(int type, ctype_t *ctype, ast_t *operand);
+ast_t* parser_ast_uop(compiler_ctx_t *ctx, int type, ctype_t *ctype, ast_t *operand);
 
 /**
- * @fn ast_t parser_ast_binop*(int, ast_t*, ast_t*)
+ * @fn ast_t parser_ast_binop*(compiler_ctx_t*, int, ast_t*, ast_t*)
  * @brief
  *
+ * @param ctx
  * @param type
  * @param left
  * @param right
  * @return
  */
-ast_t* parser_ast_binop(int type, ast_t *left, ast_t *right);
+ast_t* parser_ast_binop(compiler_ctx_t *ctx, int type, ast_t *left, ast_t *right);
 
 /**
- * @fn ast_t parser_ast_inttype*(ctype_t*, long)
+ * @fn ast_t parser_ast_inttype*(compiler_ctx_t*, ctype_t*, long)
  * @brief
  *
+ * @param ctx
  * @param ctype
  * @param val
  * @return
  */
-ast_t* parser_ast_inttype(ctype_t *ctype, long val);
+ast_t* parser_ast_inttype(compiler_ctx_t *ctx, ctype_t *ctype, long val);
 
 /**
- * @fn ast_t parser_ast_double*(double)
+ * @fn ast_t parser_ast_double*(compiler_ctx_t*, double)
  * @brief
  *
+ * @param ctx
  * @param val
  * @return
  */
-ast_t* parser_ast_double(double val);
+ast_t* parser_ast_double(compiler_ctx_t *ctx, double val);
 
 /**
- * @fn char parser_make_label*(void)
+ * @fn char parser_make_label*(compiler_ctx_t*)
  * @brief
  *
+ * @param ctx
  * @return
  */
-char* parser_make_label(void);
+char* parser_make_label(compiler_ctx_t *ctx);
 
 /**
- * @fn ast_t parser_ast_lvar*(ctype_t*, char*)
+ * @fn ast_t parser_ast_lvar*(compiler_ctx_t*, ctype_t*, char*)
  * @brief
  *
+ * @param ctx
  * @param ctype
  * @param name
  * @return
  */
-ast_t* parser_ast_lvar(ctype_t *ctype, char *name);
+ast_t* parser_ast_lvar(compiler_ctx_t *ctx, ctype_t *ctype, char *name);
 
 /**
- * @fn ast_t parser_ast_gvar*(ctype_t*, char*, bool)
+ * @fn ast_t parser_ast_gvar*(compiler_ctx_t*, ctype_t*, char*, bool)
  * @brief
  *
+ * @param ctx
  * @param ctype
  * @param name
  * @param filelocal
  * @return
  */
-ast_t* parser_ast_gvar(ctype_t *ctype, char *name, bool filelocal);
+ast_t* parser_ast_gvar(compiler_ctx_t *ctx, ctype_t *ctype, char *name, bool filelocal);
 
 /**
- * @fn ast_t parser_ast_string*(char*)
+ * @fn ast_t parser_ast_string*(compiler_ctx_t*, char*)
  * @brief
  *
+ * @param ctx
  * @param str
  * @return
  */
-ast_t* parser_ast_string(char *str);
+ast_t* parser_ast_string(compiler_ctx_t *ctx, char *str);
 
 /**
- * @fn ast_t parser_ast_funcall*(ctype_t*, char*, list_t*)
+ * @fn ast_t parser_ast_funcall*(compiler_ctx_t*, ctype_t*, char*, list_t*)
  * @brief
  *
+ * @param ctx
  * @param ctype
  * @param fname
  * @param args
  * @return
  */
-ast_t* parser_ast_funcall(ctype_t *ctype, char *fname, list_t *args);
+ast_t* parser_ast_funcall(compiler_ctx_t *ctx, ctype_t *ctype, char *fname, list_t *args);
 
 /**
- * @fn ast_t parser_ast_func*(ctype_t*, char*, list_t*, ast_t*, list_t*)
+ * @fn ast_t parser_ast_func*(compiler_ctx_t*, ctype_t*, char*, list_t*, ast_t*, list_t*)
  * @brief
  *
+ * @param ctx
  * @param rettype
  * @param fname
  * @param params
@@ -147,90 +174,98 @@ ast_t* parser_ast_funcall(ctype_t *ctype, char *fname, list_t *args);
  * @param localvars
  * @return
  */
-ast_t* parser_ast_func(ctype_t *rettype, char *fname, list_t *params, ast_t *body, list_t *localvars);
+ast_t* parser_ast_func(compiler_ctx_t *ctx, ctype_t *rettype, char *fname, list_t *params, ast_t *body, list_t *localvars);
 
 /**
- * @fn ast_t parser_ast_decl*(ast_t*, ast_t*)
+ * @fn ast_t parser_ast_decl*(compiler_ctx_t*, ast_t*, ast_t*)
  * @brief
  *
+ * @param ctx
  * @param var
  * @param init
  * @return
  */
-ast_t* parser_ast_decl(ast_t *var, ast_t *init);
+ast_t* parser_ast_decl(compiler_ctx_t *ctx, ast_t *var, ast_t *init);
 
 /**
- * @fn ast_t parser_ast_array_init*(list_t*)
+ * @fn ast_t parser_ast_array_init*(compiler_ctx_t*, list_t*)
  * @brief
  *
+ * @param ctx
  * @param arrayinit
  * @return
  */
-ast_t* parser_ast_array_init(list_t *arrayinit);
+ast_t* parser_ast_array_init(compiler_ctx_t *ctx, list_t *arrayinit);
 
 /**
- * @fn ast_t parser_ast_if*(ast_t*, ast_t*, ast_t*)
+ * @fn ast_t parser_ast_if*(compiler_ctx_t*, ast_t*, ast_t*, ast_t*)
  * @brief
  *
+ * @param ctx
  * @param cond
  * @param then
  * @param els
  * @return
  */
-ast_t* parser_ast_if(ast_t *cond, ast_t *then, ast_t *els);
+ast_t* parser_ast_if(compiler_ctx_t *ctx, ast_t *cond, ast_t *then, ast_t *els);
 
 /**
- * @fn ast_t parser_ast_ternary*(ctype_t*, ast_t*, ast_t*, ast_t*)
+ * @fn ast_t parser_ast_ternary*(compiler_ctx_t*, ctype_t*, ast_t*, ast_t*, ast_t*)
  * @brief
  *
+ * @param ctx
  * @param ctype
  * @param cond
  * @param then
  * @param els
  * @return
  */
-ast_t* parser_ast_ternary(ctype_t *ctype, ast_t *cond, ast_t *then, ast_t *els);
+ast_t* parser_ast_ternary(compiler_ctx_t *ctx, ctype_t *ctype, ast_t *cond, ast_t *then, ast_t *els);
 
 /**
- * @fn ast_t parser_ast_for*(ast_t*, ast_t*, ast_t*, ast_t*)
+ * @fn ast_t parser_ast_for*(compiler_ctx_t*, ast_t*, ast_t*, ast_t*, ast_t*)
  * @brief
  *
+ * @param ctx
  * @param init
  * @param cond
  * @param step
  * @param body
  * @return
  */
-ast_t* parser_ast_for(ast_t *init, ast_t *cond, ast_t *step, ast_t *body);
+ast_t* parser_ast_for(compiler_ctx_t *ctx, ast_t *init, ast_t *cond, ast_t *step, ast_t *body);
 
 /**
- * @fn ast_t parser_ast_return*(ast_t*)
+ * @fn ast_t parser_ast_return*(compiler_ctx_t*, ast_t*)
  * @brief
  *
+ * @param ctx
  * @param retval
  * @return
  */
-ast_t* parser_ast_return(ast_t *retval);
+ast_t* parser_ast_return(compiler_ctx_t *ctx, ast_t *retval);
 
 /**
- * @fn ast_t parser_ast_compound_stmt*(list_t*)
+ * @fn ast_t parser_ast_compound_stmt*(compiler_ctx_t*, list_t*)
  * @brief
  *
+ * @param ctx
  * @param stmts
  * @return
  */
-ast_t* parser_ast_compound_stmt(list_t *stmts);
+ast_t* parser_ast_compound_stmt(compiler_ctx_t *ctx, list_t *stmts);
 
 /**
- * @fn ast_t parser_ast_struct_ref*(ctype_t*, ast_t*, char*)
+ * @fn ast_t parser_ast_struct_ref*(compiler_ctx_t*, ctype_t*, ast_t*, char*)
  * @brief
  *
+ * @param ctx
  * @param ctype
  * @param struc
  * @param name
  * @return
  */
-ast_t* parser_ast_struct_ref(ctype_t *ctype, ast_t *struc, char *name);
+ast_t* parser_ast_struct_ref(compiler_ctx_t *ctx, ctype_t *ctype, ast_t *struc, char *name);
 
 /**
  * @fn ctype_t parser_make_ptr_type*(ctype_t*)
@@ -290,30 +325,32 @@ bool parser_is_inttype(ctype_t *ctype);
 bool parser_is_flotype(ctype_t *ctype);
 
 /**
- * @fn void parser_ensure_lvalue(ast_t*)
+ * @fn void parser_ensure_lvalue(compiler_ctx_t*, ast_t*)
  * @brief
  *
+ * @param ctx
  * @param ast
  */
-void parser_ensure_lvalue(ast_t *ast);
+void parser_ensure_lvalue(compiler_ctx_t *ctx, ast_t *ast);
 
 /**
- * @fn void parser_expect(char)
+ * @fn void parser_expect(compiler_ctx_t*, char)
  * @brief
  *
+ * @param ctx
  * @param punct
  */
-void parser_expect(char punct);
+void parser_expect(compiler_ctx_t *ctx, char punct);
 
 /**
- * @fn bool parser_is_ident(const token_t, char*)
+ * @fn bool parser_is_keyword(const token_t, int)
  * @brief
  *
  * @param tok
- * @param s
+ * @param kw
  * @return
  */
-bool parser_is_ident(const token_t tok, char *s);
+bool parser_is_keyword(const token_t tok, int kw);
 
 /**
  * @fn bool parser_is_right_assoc(const token_t)
@@ -325,13 +362,14 @@ bool parser_is_ident(const token_t tok, char *s);
 bool parser_is_right_assoc(const token_t tok);
 
 /**
- * @fn int parser_eval_intexpr(ast_t*)
+ * @fn int parser_eval_intexpr(compiler_ctx_t*, ast_t*)
  * @brief
  *
+ * @param ctx
  * @param ast
  * @return
  */
-int parser_eval_intexpr(ast_t *ast);
+int parser_eval_intexpr(compiler_ctx_t *ctx, ast_t *ast);
 
 /**
  * @fn int parser_priority(const token_t)
@@ -343,22 +381,24 @@ int parser_eval_intexpr(ast_t *ast);
 int parser_priority(const token_t tok);
 
 /**
- * @fn ast_t parser_read_func_args*(char*)
+ * @fn ast_t parser_read_func_args*(compiler_ctx_t*, char*)
  * @brief
  *
+ * @param ctx
  * @param fname
  * @return
  */
-ast_t* parser_read_func_args(char *fname);
+ast_t* parser_read_func_args(compiler_ctx_t *ctx, char *fname);
 
 /**
- * @fn ast_t parser_read_ident_or_func*(char*)
+ * @fn ast_t parser_read_ident_or_func*(compiler_ctx_t*, char*)
  * @brief
  *
+ * @param ctx
  * @param name
  * @return
  */
-ast_t* parser_read_ident_or_func(char *name);
+ast_t* parser_read_ident_or_func(compiler_ctx_t *ctx, char *name);
 
 /**
  * @fn bool parser_is_long_token(char*)
@@ -388,12 +428,13 @@ bool parser_is_int_token(char *p);
 bool parser_is_float_token(char *p);
 
 /**
- * @fn ast_t parser_read_prim*(void)
+ * @fn ast_t parser_read_prim*(compiler_ctx_t*)
  * @brief
  *
+ * @param ctx
  * @return
  */
-ast_t* parser_read_prim(void);
+ast_t* parser_read_prim(compiler_ctx_t *ctx);
 
 /**
  * @fn ctype_t parser_result_type_int*(jmp_buf*, char, ctype_t*, ctype_t*)
@@ -408,13 +449,14 @@ ast_t* parser_read_prim(void);
 ctype_t* parser_result_type_int(jmp_buf *jmpbuf, char op, ctype_t *a, ctype_t *b);
 
 /**
- * @fn ast_t parser_read_subscript_expr*(ast_t*)
+ * @fn ast_t parser_read_subscript_expr*(compiler_ctx_t*, ast_t*)
  * @brief
  *
+ * @param ctx
  * @param ast
  * @return
  */
-ast_t* parser_read_subscript_expr(ast_t *ast);
+ast_t* parser_read_subscript_expr(compiler_ctx_t *ctx, ast_t *ast);
 
 /**
  * @fn ctype_t parser_convert_array*(ctype_t*)
@@ -437,47 +479,52 @@ ctype_t* parser_convert_array(ctype_t *ctype);
 ctype_t* parser_result_type(char op, ctype_t *a, ctype_t *b);
 
 /**
- * @fn ast_t parser_read_unary_expr*(void)
+ * @fn ast_t parser_read_unary_expr*(compiler_ctx_t*)
  * @brief
  *
+ * @param ctx
  * @return
  */
-ast_t* parser_read_unary_expr(void);
+ast_t* parser_read_unary_expr(compiler_ctx_t *ctx);
 
 /**
- * @fn ast_t parser_read_cond_expr*(ast_t*)
+ * @fn ast_t parser_read_cond_expr*(compiler_ctx_t*, ast_t*)
  * @brief
  *
+ * @param ctx
  * @param cond
  * @return
  */
-ast_t* parser_read_cond_expr(ast_t *cond);
+ast_t* parser_read_cond_expr(compiler_ctx_t *ctx, ast_t *cond);
 
 /**
- * @fn ast_t parser_read_struct_field*(ast_t*)
+ * @fn ast_t parser_read_struct_field*(compiler_ctx_t*, ast_t*)
  * @brief
  *
+ * @param ctx
  * @param struc
  * @return
  */
-ast_t* parser_read_struct_field(ast_t *struc);
+ast_t* parser_read_struct_field(compiler_ctx_t *ctx, ast_t *struc);
 
 /**
- * @fn ast_t parser_read_expr_int*(int)
+ * @fn ast_t parser_read_expr_int*(compiler_ctx_t*, int)
  * @brief
  *
+ * @param ctx
  * @param prec
  * @return
  */
-ast_t* parser_read_expr_int(int prec);
+ast_t* parser_read_expr_int(compiler_ctx_t *ctx, int prec);
 
 /**
- * @fn ast_t parser_read_expr*(void)
+ * @fn ast_t parser_read_expr*(compiler_ctx_t*)
  * @brief
  *
+ * @param ctx
  * @return
  */
-ast_t* parser_read_expr(void);
+ast_t* parser_read_expr(compiler_ctx_t *ctx);
 
 /**
  * @fn ctype_t parser_get_ctype*(const token_t)
@@ -498,203 +545,253 @@ ctype_t* parser_get_ctype(const token_t tok);
 bool parser_is_type_keyword(const token_t tok);
 
 /**
- * @fn ast_t parser_read_decl_array_init_int*(ctype_t*)
+ * @fn ast_t parser_read_decl_array_init_int*(compiler_ctx_t*, ctype_t*)
  * @brief
  *
+ * @param ctx
  * @param ctype
  * @return
  */
-ast_t* parser_read_decl_array_init_int(ctype_t *ctype);
+ast_t* parser_read_decl_array_init_int(compiler_ctx_t *ctx, ctype_t *ctype);
 
 /**
- * @fn char parser_read_struct_union_tag*(void)
+ * @fn char parser_read_struct_union_tag*(compiler_ctx_t*)
  * @brief
  *
+ * @param ctx
  * @return
  */
-char* parser_read_struct_union_tag(void);
+char* parser_read_struct_union_tag(compiler_ctx_t *ctx);
 
 /**
- * @fn dict_t parser_read_struct_union_fields*(void)
+ * @fn dict_t parser_read_struct_union_fields*(compiler_ctx_t*)
  * @brief
  *
+ * @param ctx
  * @return
  */
-dict_t* parser_read_struct_union_fields(void);
+dict_t* parser_read_struct_union_fields(compiler_ctx_t *ctx);
 
 /**
- * @fn ctype_t parser_read_union_def*(void)
+ * @fn ctype_t parser_read_union_def*(compiler_ctx_t*)
  * @brief
  *
+ * @param ctx
  * @return
  */
-ctype_t* parser_read_union_def(void);
+ctype_t* parser_read_union_def(compiler_ctx_t *ctx);
 
 /**
- * @fn ctype_t parser_read_struct_def*(void)
+ * @fn ctype_t parser_read_struct_def*(compiler_ctx_t*)
  * @brief
  *
+ * @param ctx
  * @return
  */
-ctype_t* parser_read_struct_def(void);
+ctype_t* parser_read_struct_def(compiler_ctx_t *ctx);
 
 /**
- * @fn ctype_t parser_read_decl_spec*(void)
+ * @fn ctype_t parser_read_decl_spec*(compiler_ctx_t*)
  * @brief
  *
+ * @param ctx
  * @return
  */
-ctype_t* parser_read_decl_spec(void);
+ctype_t* parser_read_decl_spec(compiler_ctx_t *ctx);
 
 /**
- * @fn ast_t parser_read_decl_init_val*(ast_t*)
+ * @fn ast_t parser_read_decl_init_val*(compiler_ctx_t*, ast_t*)
  * @brief
  *
+ * @param ctx
  * @param var
  * @return
  */
-ast_t* parser_read_decl_init_val(ast_t *var);
+ast_t* parser_read_decl_init_val(compiler_ctx_t *ctx, ast_t *var);
 
 /**
- * @fn ctype_t parser_read_array_dimensions_int*(ctype_t*)
+ * @fn ctype_t parser_read_array_dimensions_int*(compiler_ctx_t*, ctype_t*)
  * @brief
  *
+ * @param ctx
  * @param basetype
  * @return
  */
-ctype_t* parser_read_array_dimensions_int(ctype_t *basetype);
+ctype_t* parser_read_array_dimensions_int(compiler_ctx_t *ctx, ctype_t *basetype);
 
 /**
- * @fn ctype_t parser_read_array_dimensions*(ctype_t*)
+ * @fn ctype_t parser_read_array_dimensions*(compiler_ctx_t*, ctype_t*)
  * @brief
  *
+ * @param ctx
  * @param basetype
  * @return
  */
-ctype_t* parser_read_array_dimensions(ctype_t *basetype);
+ctype_t* parser_read_array_dimensions(compiler_ctx_t *ctx, ctype_t *basetype);
 
 /**
- * @fn ast_t parser_read_decl_init*(ast_t*)
+ * @fn ast_t parser_read_decl_init*(compiler_ctx_t*, ast_t*)
  * @brief
  *
+ * @param ctx
  * @param var
  * @return
  */
-ast_t* parser_read_decl_init(ast_t *var);
+ast_t* parser_read_decl_init(compiler_ctx_t *ctx, ast_t *var);
 
 /**
- * @fn ctype_t parser_read_decl_int*(token_t*)
+ * @fn ctype_t parser_read_decl_int*(compiler_ctx_t*, token_t*)
  * @brief
  *
+ * @param ctx
  * @param name
  * @return
  */
-ctype_t* parser_read_decl_int(token_t *name);
+ctype_t* parser_read_decl_int(compiler_ctx_t *ctx, token_t *name);
 
 /**
- * @fn ast_t parser_read_decl*(void)
+ * @fn ast_t parser_read_decl*(compiler_ctx_t*)
  * @brief
  *
+ * @param ctx
  * @return
  */
-ast_t* parser_read_decl(void);
+ast_t* parser_read_decl(compiler_ctx_t *ctx);
 
 /**
- * @fn ast_t parser_read_if_stmt*(void)
+ * @fn ast_t parser_read_if_stmt*(compiler_ctx_t*)
  * @brief
  *
+ * @param ctx
  * @return
  */
-ast_t* parser_read_if_stmt(void);
+ast_t* parser_read_if_stmt(compiler_ctx_t *ctx);
 
 /**
- * @fn ast_t parser_read_opt_decl_or_stmt*(void)
+ * @fn ast_t parser_read_opt_decl_or_stmt*(compiler_ctx_t*)
  * @brief
  *
+ * @param ctx
  * @return
  */
-ast_t* parser_read_opt_decl_or_stmt(void);
+ast_t* parser_read_opt_decl_or_stmt(compiler_ctx_t *ctx);
 
 /**
- * @fn ast_t parser_read_opt_expr*(void)
+ * @fn ast_t parser_read_opt_expr*(compiler_ctx_t*)
  * @brief
  *
+ * @param ctx
  * @return
  */
-ast_t* parser_read_opt_expr(void);
+ast_t* parser_read_opt_expr(compiler_ctx_t *ctx);
 
 /**
- * @fn ast_t parser_read_for_stmt*(void)
+ * @fn ast_t parser_read_for_stmt*(compiler_ctx_t*)
  * @brief
  *
+ * @param ctx
  * @return
  */
-ast_t* parser_read_for_stmt(void);
+ast_t* parser_read_for_stmt(compiler_ctx_t *ctx);
 
 /**
- * @fn ast_t parser_read_return_stmt*(void)
+ * @fn ast_t parser_read_return_stmt*(compiler_ctx_t*)
  * @brief
  *
+ * @param ctx
  * @return
  */
-ast_t* parser_read_return_stmt(void);
+ast_t* parser_read_return_stmt(compiler_ctx_t *ctx);
 
 /**
- * @fn ast_t parser_read_stmt*(void)
+ * @fn ast_t parser_read_stmt*(compiler_ctx_t*)
  * @brief
  *
+ * @param ctx
  * @return
  */
-ast_t* parser_read_stmt(void);
+ast_t* parser_read_stmt(compiler_ctx_t *ctx);
 
 /**
- * @fn ast_t parser_read_decl_or_stmt*(void)
+ * @fn ast_t parser_read_decl_or_stmt*(compiler_ctx_t*)
  * @brief
  *
+ * @param ctx
  * @return
  */
-ast_t* parser_read_decl_or_stmt(void);
+ast_t* parser_read_decl_or_stmt(compiler_ctx_t *ctx);
 
 /**
- * @fn ast_t parser_read_compound_stmt*(void)
+ * @fn ast_t parser_read_compound_stmt*(compiler_ctx_t*)
  * @brief
  *
+ * @param ctx
  * @return
  */
-ast_t* parser_read_compound_stmt(void);
+ast_t* parser_read_compound_stmt(compiler_ctx_t *ctx);
 
 /**
- * @fn list_t parser_read_params*(void)
+ * @fn list_t parser_read_params*(compiler_ctx_t*)
  * @brief
  *
+ * @param ctx
  * @return
  */
-list_t* parser_read_params(void);
+list_t* parser_read_params(compiler_ctx_t *ctx);
 
 /**
- * @fn ast_t parser_read_func_def*(ctype_t*, char*)
+ * @fn ast_t parser_read_func_def*(compiler_ctx_t*, ctype_t*, char*)
  * @brief
  *
+ * @param ctx
  * @param rettype
  * @param fname
  * @return
  */
-ast_t* parser_read_func_def(ctype_t *rettype, char *fname);
+ast_t* parser_read_func_def(compiler_ctx_t *ctx, ctype_t *rettype, char *fname);
 
 /**
- * @fn ast_t parser_read_decl_or_func_def*(void)
+ * @fn ast_t parser_read_decl_or_func_def*(compiler_ctx_t*)
  * @brief
  *
+ * @param ctx
  * @return
  */
-ast_t* parser_read_decl_or_func_def(void);
+ast_t* parser_read_decl_or_func_def(compiler_ctx_t *ctx);
+
+/**
+ * @fn void parser_func_free(ast_t*)
+ * @brief Release a function definition: its AST, local variables and scopes.
+ *        Globals, string literals and struct definitions are kept.
+ *
+ * @param func AST_FUNC
+ */
+void parser_func_free(ast_t *func);
+
+/**
+ * @fn void parser_open(compiler_ctx_t*)
+ * @brief Start the translation unit
+ *
+ * @param ctx
+ */
+void parser_open(compiler_ctx_t *ctx);
+
+/**
+ * @fn ast_t parser_read_toplevel*(compiler_ctx_t*)
+ * @brief Read one declaration or function definition
+ *
+ * @param ctx
+ * @return NULL at the end of the input
+ */
+ast_t* parser_read_toplevel(compiler_ctx_t *ctx);
 
 /**
- * @fn list_t parser_read_toplevels*(void)
+ * @fn list_t parser_read_toplevels*(compiler_ctx_t*)
  * @brief
  *
+ * @param ctx
  * @return
  */
-list_t* parser_read_toplevels(void);
+list_t* parser_read_toplevels(compiler_ctx_t *ctx);
 
 #endif /* PARSER_H_ */
@@ -0,0 +1,84 @@
+/*
+ * @peephole.h
+ *
+ * @brief C for Stack VM
+ * @details
+ * This is based on other projects:
+ *   A minimalist C compiler with x86_64 code generation: https://github.com/jserv/MazuCC
+ *   Others (see individual files)
+ *
+ *   please contact their authors for more information.
+ *
+ * @author Emiliano Augusto Gonzalez (egonzalez . hiperion @ gmail . com)
+ * @date 2024
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/stackvm_c_compiler
+ */
+
+#ifndef PEEPHOLE_H_
+#define PEEPHOLE_H_
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "c_stackvm.h"
+#include "ir.h"
+
+/**
+ * @def PEEPHOLE_WINDOW
+ * @brief Longest pattern of the rule table
+ *
+ */
+#define PEEPHOLE_WINDOW 4
+
+/**
+ * @def PEEPHOLE_MAX_RULES
+ * @brief Room for the rule table in the compiler context
+ *
+ */
+#define PEEPHOLE_MAX_RULES 32
+
+/**
+ * @struct
+ * @brief Rule switches and counters of a compilation
+ *
+ */
+typedef struct {
+                  int *label_refs; // of the function being optimized
+    unsigned long int insns_before;
+    unsigned long int insns_after;
+                 bool disabled[PEEPHOLE_MAX_RULES];
+    unsigned long int fired[PEEPHOLE_MAX_RULES];
+} peephole_state_t;
+
+/**
+ * @fn bool peephole_enable(compiler_ctx_t*, const char*, bool)
+ * @brief Enable or disable a rule, all the rules when name is NULL
+ *
+ * @param ctx
+ * @param name
+ * @param enable
+ * @return false if there is no such rule
+ */
+bool peephole_enable(compiler_ctx_t *ctx, const char *name, bool enable);
+
+/**
+ * @fn int peephole_run(compiler_ctx_t*, ir_func_t*)
+ * @brief Rewrite the function until no rule matches
+ *
+ * @param ctx
+ * @param func
+ * @return number of rewrites
+ */
+int peephole_run(compiler_ctx_t *ctx, ir_func_t *func);
+
+/**
+ * @fn void peephole_stats(compiler_ctx_t*, FILE*)
+ * @brief How often each rule fired
+ *
+ * @param ctx
+ * @param fp
+ */
+void peephole_stats(compiler_ctx_t *ctx, FILE *fp);
+
+#endif /* PEEPHOLE_H_ */
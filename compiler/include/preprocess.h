@@ -18,9 +18,41 @@
 #ifndef PREPROCESS_H_
 #define PREPROCESS_H_
 
+#include <stddef.h>
 #include <stdio.h>
 
-void preprocess_file(FILE *file_in, FILE *file_out);
+/**
+ * @def PREPROCESS_CHUNK
+ * @brief Input is read and preprocessed in chunks of this size
+ *
+ */
+#define PREPROCESS_CHUNK (64 * 1024)
+
+/**
+ * @struct
+ * @brief Preprocessed source, consumed by the lexer
+ *
+ */
+typedef struct {
+      char *body;
+    size_t len, nalloc;
+} preprocess_buffer_t;
 
+/**
+ * @fn void preprocess_file(FILE*, preprocess_buffer_t*)
+ * @brief Preprocess file_in into an in-memory buffer
+ *
+ * @param file_in
+ * @param out
+ */
+void preprocess_file(FILE *file_in, preprocess_buffer_t *out);
+
+/**
+ * @fn void preprocess_free(preprocess_buffer_t*)
+ * @brief
+ *
+ * @param buf
+ */
+void preprocess_free(preprocess_buffer_t *buf);
 
 #endif /* PREPROCESS_H_ */
@@ -0,0 +1,79 @@
+/*
+ * @strpool.h
+ *
+ * @brief C for Stack VM
+ * @details
+ * This is based on other projects:
+ *   A minimalist C compiler with x86_64 code generation: https://github.com/jserv/MazuCC
+ *   Others (see individual files)
+ *
+ *   please contact their authors for more information.
+ *
+ * @author Emiliano Augusto Gonzalez (egonzalez . hiperion @ gmail . com)
+ * @date 2024
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/stackvm_c_compiler
+ */
+
+#ifndef STRPOOL_H_
+#define STRPOOL_H_
+
+#include <stdio.h>
+
+#include "c_stackvm.h"
+#include "list.h"
+
+/**
+ * @struct
+ * @brief Label of a literal inside a data entry
+ *
+ */
+typedef struct {
+    char *label;
+     int offset;
+} strpool_label_t;
+
+/**
+ * @struct
+ * @brief One string of the data section, shared by the literals it ends with
+ *
+ */
+typedef struct {
+      char *str;
+       int len;    // without the terminator
+    list_t *labels; // strpool_label_t, by increasing offset
+} strpool_entry_t;
+
+/**
+ * @struct
+ * @brief Counters for -fstring-stats
+ *
+ */
+typedef struct {
+     int literals;
+     int entries;
+    long bytes_before;
+    long bytes_after;
+} strpool_state_t;
+
+/**
+ * @fn list_t strpool_build*(compiler_ctx_t*, list_t*)
+ * @brief Pool the string literals (AST_STRING). Identical literals and literals ending
+ *        another one are labels inside it.
+ *
+ * @param ctx
+ * @param strings
+ * @return list of strpool_entry_t to emit
+ */
+list_t* strpool_build(compiler_ctx_t *ctx, list_t *strings);
+
+/**
+ * @fn void strpool_stats(compiler_ctx_t*, FILE*)
+ * @brief Bytes of string data with and without pooling
+ *
+ * @param ctx
+ * @param fp
+ */
+void strpool_stats(compiler_ctx_t *ctx, FILE *fp);
+
+#endif /* STRPOOL_H_ */
@@ -0,0 +1,93 @@
+/*
+ * @super.h
+ *
+ * @brief C for Stack VM
+ * @details
+ * This is based on other projects:
+ *   A minimalist C compiler with x86_64 code generation: https://github.com/jserv/MazuCC
+ *   Others (see individual files)
+ *
+ *   please contact their authors for more information.
+ *
+ * @author Emiliano Augusto Gonzalez (egonzalez . hiperion @ gmail . com)
+ * @date 2024
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/stackvm_c_compiler
+ */
+
+#ifndef SUPER_H_
+#define SUPER_H_
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "c_stackvm.h"
+#include "ir.h"
+
+/**
+ * @def SUPER_MAX_LEN
+ * @brief Longest primitive sequence replaced by a superinstruction
+ *
+ */
+#define SUPER_MAX_LEN 4
+
+/**
+ * @def SUPER_MAX_ENTRIES
+ * @brief Room for the superinstruction table in the compiler context
+ *
+ */
+#define SUPER_MAX_ENTRIES 32
+
+/**
+ * @struct
+ * @brief Selection switches and counters of a compilation
+ *
+ */
+typedef struct {
+    unsigned long int insns_before;
+    unsigned long int insns_after;
+                 bool disabled[SUPER_MAX_ENTRIES];
+    unsigned long int fired[SUPER_MAX_ENTRIES];
+} super_state_t;
+
+/**
+ * @fn bool super_enable(compiler_ctx_t*, const char*, bool)
+ * @brief Enable or disable a superinstruction by mnemonic, all of them when name is NULL
+ *
+ * @param ctx
+ * @param name
+ * @param enable
+ * @return false if there is no such superinstruction
+ */
+bool super_enable(compiler_ctx_t *ctx, const char *name, bool enable);
+
+/**
+ * @fn bool super_select(compiler_ctx_t*, const char*)
+ * @brief Enable only the superinstructions of a comma separated list of mnemonics
+ *
+ * @param ctx
+ * @param list
+ * @return false if a mnemonic is unknown
+ */
+bool super_select(compiler_ctx_t *ctx, const char *list);
+
+/**
+ * @fn int super_run(compiler_ctx_t*, ir_func_t*)
+ * @brief Replace primitive sequences by the enabled superinstructions
+ *
+ * @param ctx
+ * @param func
+ * @return number of superinstructions selected
+ */
+int super_run(compiler_ctx_t *ctx, ir_func_t *func);
+
+/**
+ * @fn void super_stats(compiler_ctx_t*, FILE*)
+ * @brief How often each superinstruction was selected
+ *
+ * @param ctx
+ * @param fp
+ */
+void super_stats(compiler_ctx_t *ctx, FILE *fp);
+
+#endif /* SUPER_H_ */
@@ -0,0 +1,114 @@
+/*
+ * @symtab.h
+ *
+ * @brief C for Stack VM
+ * @details
+ * This is based on other projects:
+ *   A minimalist C compiler with x86_64 code generation: https://github.com/jserv/MazuCC
+ *   Others (see individual files)
+ *
+ *   please contact their authors for more information.
+ *
+ * @author Emiliano Augusto Gonzalez (egonzalez . hiperion @ gmail . com)
+ * @date 2024
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/stackvm_c_compiler
+ */
+
+#ifndef SYMTAB_H_
+#define SYMTAB_H_
+
+#include <stdint.h>
+
+/**
+ * @def SYMTAB_INIT_SIZE
+ * @brief Initial number of slots (power of 2)
+ *
+ */
+#define SYMTAB_INIT_SIZE 64
+
+/**
+ * @struct
+ * @brief Visible binding of a name
+ *
+ */
+typedef struct {
+    char *key;   // interned name, NULL for an empty slot
+    void *val;
+     int depth;  // scope depth where the binding was made
+} symtab_entry_t;
+
+/**
+ * @struct
+ * @brief Binding replaced by a symtab_put inside a scope
+ *
+ */
+typedef struct {
+    char *key;
+    void *val;   // previous value, NULL if the name was not bound
+     int depth;
+} symtab_undo_t;
+
+/**
+ * @struct
+ * @brief Open addressing symbol table with a scope stack and an undo log.
+ *        Only the innermost binding of every name is stored in the table,
+ *        shadowed bindings are kept in the undo log and restored on symtab_pop.
+ *        Keys must be interned (see intern.h): they are compared by pointer.
+ *
+ */
+typedef struct {
+    symtab_entry_t *table;
+               int cap, qty;
+     symtab_undo_t *undo;
+               int undo_len, undo_cap;
+               int *marks;    // undo_len at every symtab_push
+               int depth, marks_cap;
+              long scopes;    // number of symtab_push since creation
+} symtab_t;
+
+/**
+ * @fn symtab_t symtab_make*(void)
+ * @brief
+ *
+ * @return
+ */
+symtab_t* symtab_make(void);
+
+/**
+ * @fn void symtab_get*(symtab_t*, char*)
+ * @brief Innermost binding of key
+ *
+ * @param symtab
+ * @param key
+ * @return
+ */
+void* symtab_get(symtab_t *symtab, char *key);
+
+/**
+ * @fn void symtab_put(symtab_t*, char*, void*)
+ * @brief Bind key in the current scope, shadowing outer bindings
+ *
+ * @param symtab
+ * @param key
+ * @param val
+ */
+void symtab_put(symtab_t *symtab, char *key, void *val);
+
+/**
+ * @fn void symtab_push(symtab_t*)
+ * @brief Open a scope
+ *
+ * @param symtab
+ */
+void symtab_push(symtab_t *symtab);
+
+/**
+ * @fn void symtab_pop(symtab_t*)
+ * @brief Close the current scope, restoring the bindings it shadowed
+ *
+ * @param symtab
+ */
+void symtab_pop(symtab_t *symtab);
+
+#endif /* SYMTAB_H_ */
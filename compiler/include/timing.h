@@ -0,0 +1,123 @@
+/*
+ * @timing.h
+ *
+ * @brief C for Stack VM
+ * @details
+ * This is based on other projects:
+ *   A minimalist C compiler with x86_64 code generation: https://github.com/jserv/MazuCC
+ *   Others (see individual files)
+ *
+ *   please contact their authors for more information.
+ *
+ * @author Emiliano Augusto Gonzalez (egonzalez . hiperion @ gmail . com)
+ * @date 2024
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/stackvm_c_compiler
+ */
+
+#ifndef TIMING_H_
+#define TIMING_H_
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "c_stackvm.h"
+
+/**
+ * @enum TIMING_PHASE
+ * @brief Phases of a compilation, in the order they run
+ *
+ */
+enum TIMING_PHASE {
+    TIMING_PREPROCESS,
+    TIMING_LEX,        // a separate pass over the input, only run for the report
+    TIMING_PARSE,      // reads the tokens again
+    TIMING_INLINE,
+    TIMING_DATA,
+    TIMING_CODEGEN,
+    TIMING_PHASES
+};
+
+/**
+ * @struct
+ * @brief Cost of one phase
+ *
+ */
+typedef struct {
+           double wall;     // seconds
+           double cpu;      // seconds of the compiling thread
+    unsigned long allocs;   // from the arenas and util_heap
+    unsigned long bytes;
+             long peak_rss; // high water mark of the process at the end of the phase, KB
+} timing_phase_t;
+
+/**
+ * @struct
+ * @brief Counters for -ftime-report
+ *
+ */
+typedef struct {
+              bool enabled;
+    timing_phase_t phases[TIMING_PHASES];
+    timing_phase_t start;  // of the running phase
+               int span;   // trace span of the running phase
+     unsigned long tokens;
+} timing_state_t;
+
+/**
+ * @fn void timing_enable(compiler_ctx_t*, bool)
+ * @brief
+ *
+ * @param ctx
+ * @param enable
+ */
+void timing_enable(compiler_ctx_t *ctx, bool enable);
+
+/**
+ * @fn bool timing_enabled(compiler_ctx_t*)
+ * @brief
+ *
+ * @param ctx
+ * @return
+ */
+bool timing_enabled(compiler_ctx_t *ctx);
+
+/**
+ * @fn void timing_begin(compiler_ctx_t*, int)
+ * @brief Start a phase, phases do not nest
+ *
+ * @param ctx
+ * @param phase
+ */
+void timing_begin(compiler_ctx_t *ctx, int phase);
+
+/**
+ * @fn void timing_end(compiler_ctx_t*, int)
+ * @brief Add the time and allocations since timing_begin to the phase
+ *
+ * @param ctx
+ * @param phase
+ */
+void timing_end(compiler_ctx_t *ctx, int phase);
+
+/**
+ * @fn void timing_lex(compiler_ctx_t*, const char*, size_t)
+ * @brief Tokenize the whole input to time the lexer alone and count the tokens,
+ *        then set the lexer back to the start of buf
+ *
+ * @param ctx
+ * @param buf
+ * @param len
+ */
+void timing_lex(compiler_ctx_t *ctx, const char *buf, size_t len);
+
+/**
+ * @fn void timing_report(compiler_ctx_t*, FILE*)
+ * @brief Cost of each phase and size of what the front end produced
+ *
+ * @param ctx
+ * @param fp
+ */
+void timing_report(compiler_ctx_t *ctx, FILE *fp);
+
+#endif /* TIMING_H_ */
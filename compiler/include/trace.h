@@ -0,0 +1,110 @@
+/*
+ * @trace.h
+ *
+ * @brief C for Stack VM
+ * @details
+ * This is based on other projects:
+ *   A minimalist C compiler with x86_64 code generation: https://github.com/jserv/MazuCC
+ *   Others (see individual files)
+ *
+ *   please contact their authors for more information.
+ *
+ * @author Emiliano Augusto Gonzalez (egonzalez . hiperion @ gmail . com)
+ * @date 2024
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/stackvm_c_compiler
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdbool.h>
+
+#include "c_stackvm.h"
+
+/**
+ * @struct
+ * @brief Span of a Chrome trace (complete event)
+ *
+ */
+typedef struct {
+          char *name;
+    const char *cat;
+        double ts;    // microseconds since trace_open
+        double dur;   // -1 while open
+    const char *arg;  // name of the argument or NULL
+          long val;
+           int tid;
+} trace_event_t;
+
+/**
+ * @struct
+ * @brief Spans of one compilation, moved to the trace by trace_collect
+ *
+ */
+typedef struct {
+             bool enabled;
+    trace_event_t *events;
+              int nevents;
+              int events_cap;
+} trace_state_t;
+
+/**
+ * @fn void trace_open(void)
+ * @brief Start the trace of the process, times are relative to this call
+ *
+ */
+void trace_open(void);
+
+/**
+ * @fn void trace_enable(compiler_ctx_t*, bool)
+ * @brief Record the spans of the current compilation
+ *
+ * @param ctx
+ * @param enable
+ */
+void trace_enable(compiler_ctx_t *ctx, bool enable);
+
+/**
+ * @fn int trace_begin(compiler_ctx_t*, const char*, const char*)
+ * @brief Open a span. Spans nest by time.
+ *
+ * @param ctx
+ * @param cat
+ * @param name may be NULL and given to trace_end
+ * @return span for trace_end, -1 when not tracing
+ */
+int trace_begin(compiler_ctx_t *ctx, const char *cat, const char *name);
+
+/**
+ * @fn void trace_end(compiler_ctx_t*, int, const char*, const char*, long)
+ * @brief Close a span
+ *
+ * @param ctx
+ * @param span
+ * @param name NULL to keep the one given to trace_begin
+ * @param arg name of an argument of the span or NULL
+ * @param val
+ */
+void trace_end(compiler_ctx_t *ctx, int span, const char *name, const char *arg, long val);
+
+/**
+ * @fn void trace_collect(compiler_ctx_t*, int)
+ * @brief Move the spans of the current compilation to the trace, the spans still
+ *        open end now
+ *
+ * @param ctx
+ * @param tid thread shown by the viewer
+ */
+void trace_collect(compiler_ctx_t *ctx, int tid);
+
+/**
+ * @fn bool trace_write(const char*)
+ * @brief Write the trace as Chrome trace-event JSON and release it
+ *
+ * @param path
+ * @return false if the file can not be written
+ */
+bool trace_write(const char *path);
+
+#endif /* TRACE_H_ */
@@ -18,6 +18,10 @@
 #ifndef UTIL_H
 #define UTIL_H
 
+#include <stddef.h>
+
+#include "arena.h"
+
 /**
  * @def INIT_SIZE
  * @brief
@@ -25,15 +29,6 @@
  */
 #define INIT_SIZE 8
 
-/**
- * @def add_str_ptr
- * @brief
- *
- */
-#define add_str_ptr(list, qty, ptr)                        \
-            list[qty++] = (void*)(ptr);                    \
-            list = realloc(list, (qty + 1) * sizeof(void*))
-
 /**
  * @def util_error
  * @brief
@@ -74,16 +69,74 @@ typedef struct {
       int nalloc, len;
 } string_t;
 
+/**
+ * @struct
+ * @brief Arenas of a compilation
+ *
+ */
+typedef struct {
+         arena_t *root_arena;
+         arena_t *cur_arena;
+    unsigned long heap_allocs; // buffers kept out of the arenas
+    unsigned long heap_bytes;
+} util_state_t;
+
+/**
+ * @fn arena_t util_arena_root*(void)
+ * @brief Per-compilation arena, created on first use
+ *
+ * @return
+ */
+arena_t* util_arena_root(void);
+
+/**
+ * @fn arena_t util_get_arena*(void)
+ * @brief Arena used by util_alloc
+ *
+ * @return
+ */
+arena_t* util_get_arena(void);
+
+/**
+ * @fn arena_t util_set_arena*(arena_t*)
+ * @brief Select the arena used by util_alloc
+ *
+ * @param arena
+ * @return previous arena
+ */
+arena_t* util_set_arena(arena_t *arena);
+
+/**
+ * @fn void util_alloc*(size_t)
+ * @brief Allocate from the current arena
+ *
+ * @param size
+ * @return
+ */
+void* util_alloc(size_t size);
+
+/**
+ * @fn void util_heap*(void*, size_t, size_t)
+ * @brief realloc for the buffers kept out of the arenas, counted with them
+ *        by -ftime-report. Fails with util_error.
+ *
+ * @param ptr NULL for a new buffer
+ * @param old_size
+ * @param size
+ * @return
+ */
+void* util_heap(void *ptr, size_t old_size, size_t size);
+
 /**
  * @fn void util_free_all(void)
- * @brief
+ * @brief Release the per-compilation arena and all its sub-arenas
  *
  */
 void util_free_all(void);
 
 /**
  * @fn void util_lfree(void*)
- * @brief
+ * @brief Reclaim ptr if it is the last allocation of the current arena
  *
  * @param ptr
  */
@@ -18,19 +18,35 @@
 #ifndef VERBOSE_H_
 #define VERBOSE_H_
 
+#include <stdbool.h>
+
+#include "c_stackvm.h"
+
+/**
+ * @struct
+ * @brief Indentation of the AST dump
+ *
+ */
+typedef struct {
+     int tab;
+    bool cont;
+    bool excpt;
+    bool no_break;
+} verbose_state_t;
+
 /**
  * @def it
  * @brief
  *
  */
-#define it tab += TAB_LEN
+#define it ctx->verbose.tab += TAB_LEN
 
 /**
  * @def dt
  * @brief
  *
  */
-#define dt tab -= TAB_LEN
+#define dt ctx->verbose.tab -= TAB_LEN
 
 /**
  * @fn char verbose_ctype_to_string*(ctype_t*)
@@ -42,52 +58,57 @@
 char* verbose_ctype_to_string(ctype_t *ctype);
 
 /**
- * @fn void verbose_uop_to_string(string_t*, char*, ast_t*)
+ * @fn void verbose_uop_to_string(compiler_ctx_t*, string_t*, char*, ast_t*)
  * @brief
  *
+ * @param ctx
  * @param buf
  * @param op
  * @param ast
  */
-void verbose_uop_to_string(string_t *buf, char *op, ast_t *ast);
+void verbose_uop_to_string(compiler_ctx_t *ctx, string_t *buf, char *op, ast_t *ast);
 
 /**
- * @fn void verbose_binop_to_string(string_t*, char*, ast_t*)
+ * @fn void verbose_binop_to_string(compiler_ctx_t*, string_t*, char*, ast_t*)
  * @brief
  *
+ * @param ctx
  * @param buf
  * @param op
  * @param ast
  */
-void verbose_binop_to_string(string_t *buf, char *op, ast_t *ast);
+void verbose_binop_to_string(compiler_ctx_t *ctx, string_t *buf, char *op, ast_t *ast);
 
 /**
- * @fn void verbose_ast_to_string_int(string_t*, ast_t*, bool)
+ * @fn void verbose_ast_to_string_int(compiler_ctx_t*, string_t*, ast_t*, bool)
  * @brief
  *
+ * @param ctx
  * @param buf
  * @param ast
  * @param first_entry
  */
-void verbose_ast_to_string_int(string_t *buf, ast_t *ast, bool first_entry);
+void verbose_ast_to_string_int(compiler_ctx_t *ctx, string_t *buf, ast_t *ast, bool first_entry);
 
 /**
- * @fn char verbose_ast_to_string*(ast_t*, bool)
+ * @fn char verbose_ast_to_string*(compiler_ctx_t*, ast_t*, bool)
  * @brief
  *
+ * @param ctx
  * @param ast
  * @param first_entry
  * @return
  */
-char* verbose_ast_to_string(ast_t *ast, bool first_entry);
+char* verbose_ast_to_string(compiler_ctx_t *ctx, ast_t *ast, bool first_entry);
 
 /**
- * @fn char verbose_token_to_string*(const token_t)
+ * @fn char verbose_token_to_string*(compiler_ctx_t*, const token_t)
  * @brief
  *
+ * @param ctx
  * @param tok
  * @return
  */
-char* verbose_token_to_string(const token_t tok);
+char* verbose_token_to_string(compiler_ctx_t *ctx, const token_t tok);
 
 #endif /* VERBOSE_H_ */
@@ -0,0 +1,488 @@
+/*
+ * @inliner.c
+ *
+ * @brief C for Stack VM
+ * @details
+ * This is based on other projects:
+ *   A minimalist C compiler with x86_64 code generation: https://github.com/jserv/MazuCC
+ *   Others (see individual files)
+ *
+ *   please contact their authors for more information.
+ *
+ * @author Emiliano Augusto Gonzalez (egonzalez . hiperion @ gmail . com)
+ * @date 2024
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/stackvm_c_compiler
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "c_stackvm.h"
+#include "context.h"
+#include "parser.h"
+#include "symtab.h"
+#include "util.h"
+#include "inliner.h"
+
+/*
+ * An inlined call becomes an AST_INLINE node: the parameters are fresh locals
+ * of the caller declared with the arguments as initializers, in argument order
+ * as the call pushed them, followed by a copy of the callee's body. A return in
+ * the copy leaves its value on the stack and jumps past the body.
+ *
+ * Only leaf functions are inlined: a call copies a body that makes no call of
+ * its own, so an inlined printf or exit path never multiplies the code size.
+ * Functions are rewritten in source order, so a callee defined earlier already
+ * has its own calls inlined and its cost includes them; a function whose calls
+ * were all inlined becomes a leaf. A function in a cycle
+ * of the call graph, or calling itself, is never inlined, which also keeps the
+ * expansion finite. The cycles are the strongly connected components, found
+ * with a single Tarjan walk.
+ *
+ * When the functions are added one at a time (inliner_add) only the earlier
+ * ones are known and each new function is walked when added; its calls only
+ * reach functions already walked. A new cycle needs an edge to a function
+ * called before its definition, so the components are walked again after one
+ * of those.
+ *
+ * Only the last INLINER_WINDOW candidates keep their AST to be inlined, an
+ * older one is freed once generated. The copy of an inlined body shares the
+ * leaves and types of the callee, so a callee is not freed while a function
+ * it was inlined into still has its AST.
+ */
+
+typedef struct {
+     ast_t *func;
+    list_t *calls;     // names of the called functions
+       int cost;       // AST nodes in the body
+      bool leaf;       // no call left in the body
+      bool recursive;
+       int index;      // Tarjan visit order, 0 when not visited
+       int low;
+      bool onstack;
+    // streaming
+    list_t *inlined;   // functions inlined into this one, one per call site
+       int users;      // functions with an AST that inlined this one
+      bool candidate;  // one of the last INLINER_WINDOW candidates
+      bool generated;
+} inliner_func_t;
+
+typedef void (*inliner_visit_t)(compiler_ctx_t *ctx, ast_t **slot);
+
+void inliner_set_limit(compiler_ctx_t *ctx, int n) {
+    ctx->inliner.limit = n;
+}
+
+static void inliner_list(compiler_ctx_t *ctx, list_t *list, inliner_visit_t fn) {
+    list_node_t *node, *tmp;
+
+    if (!list)
+        return;
+    list_for_each_safe(node, tmp, list)
+        fn(ctx, (ast_t**) &node->elem);
+}
+
+static void inliner_children(compiler_ctx_t *ctx, ast_t *ast, inliner_visit_t fn) {
+    switch (ast->type) {
+        case AST_LITERAL:
+        case AST_STRING:
+        case AST_LVAR:
+        case AST_GVAR:
+        case AST_FUNC:
+            break;
+        case AST_FUNCALL:
+            inliner_list(ctx, ast->args, fn);
+            break;
+        case AST_DECL:
+            fn(ctx, &ast->declvar);
+            fn(ctx, &ast->declinit);
+            break;
+        case AST_ARRAY_INIT:
+            inliner_list(ctx, ast->arrayinit, fn);
+            break;
+        case AST_IF:
+        case AST_TERNARY:
+            fn(ctx, &ast->cond);
+            fn(ctx, &ast->then);
+            fn(ctx, &ast->els);
+            break;
+        case AST_FOR:
+            fn(ctx, &ast->forinit);
+            fn(ctx, &ast->forcond);
+            fn(ctx, &ast->forstep);
+            fn(ctx, &ast->forbody);
+            break;
+        case AST_RETURN:
+            fn(ctx, &ast->retval);
+            break;
+        case AST_COMPOUND_STMT:
+            inliner_list(ctx, ast->stmts, fn);
+            break;
+        case AST_STRUCT_REF:
+            fn(ctx, &ast->struc);
+            break;
+        case AST_INLINE:
+            fn(ctx, &ast->inlbody);
+            break;
+        case AST_ADDR:
+        case AST_DEREF:
+        case PUNCT_PREINC:
+        case PUNCT_PREDEC:
+        case PUNCT_POSTINC:
+        case PUNCT_POSTDEC:
+        case '!':
+            fn(ctx, &ast->operand);
+            break;
+        default:
+            fn(ctx, &ast->left);
+            fn(ctx, &ast->right);
+    }
+}
+
+static void inliner_count(compiler_ctx_t *ctx, ast_t **slot) {
+    if (!*slot)
+        return;
+    ctx->inliner.cost++;
+    if ((*slot)->type == AST_FUNCALL)
+        ctx->inliner.ncalls++;
+    inliner_children(ctx, *slot, inliner_count);
+}
+
+static void inliner_collect(compiler_ctx_t *ctx, ast_t **slot) {
+    if (!*slot)
+        return;
+    if ((*slot)->type == AST_FUNCALL)
+        list_push(ctx->inliner.calls, (*slot)->fname);
+    inliner_children(ctx, *slot, inliner_collect);
+}
+
+static list_t* inliner_list_copy(list_t *list) {
+    list_t *r = list_make();
+    for (iter_t i = list_iter(list); !list_iter_end(i);)
+        list_push(r, list_iter_next(&i));
+    return r;
+}
+
+static void inliner_copy(compiler_ctx_t *ctx, ast_t **slot) {
+    ast_t *ast = *slot;
+
+    if (!ast)
+        return;
+    switch (ast->type) {
+        // leaves that are never modified are shared with the callee
+        case AST_LITERAL:
+        case AST_STRING:
+        case AST_GVAR:
+            return;
+        case AST_LVAR:
+            for (int n = 0; n < ctx->inliner.map_len; n++)
+                if (ctx->inliner.map_from[n] == ast) {
+                    *slot = ctx->inliner.map_to[n];
+                    return;
+                }
+            util_error("internal error: %s is not a variable of the inlined function", ast->varname);
+    }
+
+    ast_t *r = util_alloc(sizeof(ast_t));
+    memcpy(r, ast, sizeof(ast_t));
+    switch (r->type) {
+        case AST_FUNCALL:
+            r->args = inliner_list_copy(r->args);
+            break;
+        case AST_ARRAY_INIT:
+            r->arrayinit = inliner_list_copy(r->arrayinit);
+            break;
+        case AST_COMPOUND_STMT:
+            r->stmts = inliner_list_copy(r->stmts);
+            break;
+    }
+    inliner_children(ctx, r, inliner_copy);
+    *slot = r;
+}
+
+// a new local of the caller standing for a variable of the callee
+static ast_t* inliner_var(compiler_ctx_t *ctx, ast_t *v) {
+    ast_t *r = util_alloc(sizeof(ast_t));
+    memcpy(r, v, sizeof(ast_t));
+    r->loff = 0;
+    list_push(ctx->inliner.caller->localvars, r);
+    ctx->inliner.map_from[ctx->inliner.map_len] = v;
+    ctx->inliner.map_to[ctx->inliner.map_len++] = r;
+    return r;
+}
+
+static void inliner_note(compiler_ctx_t *ctx, ast_t *call, inliner_func_t *f, char *why) {
+    if (ctx->inliner.nsites == ctx->inliner.sites_cap) {
+        int cap = ctx->inliner.sites_cap ? ctx->inliner.sites_cap * 2 : 16;
+        ctx->inliner.sites = util_heap(ctx->inliner.sites, ctx->inliner.sites_cap * sizeof(inliner_site_t), cap * sizeof(inliner_site_t));
+        ctx->inliner.sites_cap = cap;
+    }
+    ctx->inliner.sites[ctx->inliner.nsites].caller = ctx->inliner.caller->fname;
+    ctx->inliner.sites[ctx->inliner.nsites].callee = call->fname;
+    ctx->inliner.sites[ctx->inliner.nsites].cost = f->cost;
+    ctx->inliner.sites[ctx->inliner.nsites].why = why;
+    ctx->inliner.nsites++;
+}
+
+static void inliner_connect(compiler_ctx_t *ctx, inliner_func_t *f) {
+    f->index = f->low = ++ctx->inliner.index;
+    list_push(ctx->inliner.stack, f);
+    f->onstack = true;
+    for (iter_t i = list_iter(f->calls); !list_iter_end(i);) {
+        inliner_func_t *g = symtab_get(ctx->inliner.funcs, list_iter_next(&i));
+        if (!g)
+            continue;
+        if (g == f)
+            f->recursive = true;
+        if (!g->index) {
+            inliner_connect(ctx, g);
+            if (g->low < f->low)
+                f->low = g->low;
+        } else if (g->onstack && g->index < f->low) {
+            f->low = g->index;
+        }
+    }
+    if (f->low != f->index)
+        return;
+    // f is the root of a component, more than one function is a cycle
+    bool cycle = false;
+    inliner_func_t *g;
+    do {
+        g = list_pop(ctx->inliner.stack);
+        g->onstack = false;
+        if (g != f)
+            cycle = true;
+        if (cycle)
+            g->recursive = true;
+    } while (g != f);
+}
+
+// walk f, or all the functions when f is NULL or a forward call was seen
+static void inliner_recursion(compiler_ctx_t *ctx, inliner_func_t *f) {
+    arena_t *arena = util_set_arena(util_arena_root());
+
+    if (ctx->inliner.walked != ctx->inliner.forward) {
+        for (iter_t i = list_iter(ctx->inliner.all); !list_iter_end(i);) {
+            inliner_func_t *g = list_iter_next(&i);
+            g->index = 0;
+            g->recursive = false;
+        }
+        ctx->inliner.walked = ctx->inliner.forward;
+        f = NULL;
+    }
+    if (f) {
+        if (!f->index)
+            inliner_connect(ctx, f);
+    } else {
+        for (iter_t i = list_iter(ctx->inliner.all); !list_iter_end(i);) {
+            inliner_func_t *g = list_iter_next(&i);
+            if (!g->index)
+                inliner_connect(ctx, g);
+        }
+    }
+    util_set_arena(arena);
+}
+
+static char* inliner_refuse(compiler_ctx_t *ctx, inliner_func_t *f, ast_t *call) {
+    if (ctx->inliner.streaming)
+        inliner_recursion(ctx, f);
+    if (f->recursive)
+        return "recursive";
+    if (!f->leaf)
+        return "not a leaf";
+    if (f->cost > ctx->inliner.limit)
+        return "too large";
+    if (!f->func)
+        return "freed";
+    if (list_len(call->args) != list_len(f->func->params))
+        return "argument count";
+
+    return NULL;
+}
+
+static ast_t* inliner_call(compiler_ctx_t *ctx, ast_t *call) {
+    inliner_func_t *f = symtab_get(ctx->inliner.funcs, call->fname);
+
+    // functions defined elsewhere are not reported
+    if (!f)
+        return call;
+    char *why = inliner_refuse(ctx, f, call);
+    inliner_note(ctx, call, f, why);
+    if (why)
+        return call;
+    if (ctx->inliner.streaming) {
+        list_push(ctx->inliner.inlined, f);
+        f->users++;
+    }
+
+    ctx->inliner.map_len = 0;
+    int n = list_len(f->func->params) + list_len(f->func->localvars);
+    ctx->inliner.map_from = util_heap(NULL, 0, (n + 1) * sizeof(ast_t*));
+    ctx->inliner.map_to = util_heap(NULL, 0, (n + 1) * sizeof(ast_t*));
+
+    list_t *stmts = list_make();
+    iter_t a = list_iter(call->args);
+    for (iter_t i = list_iter(f->func->params); !list_iter_end(i);)
+        list_push(stmts, parser_ast_decl(ctx, inliner_var(ctx, list_iter_next(&i)), list_iter_next(&a)));
+    for (iter_t i = list_iter(f->func->localvars); !list_iter_end(i);)
+        inliner_var(ctx, list_iter_next(&i));
+    ast_t *body = f->func->body;
+    inliner_copy(ctx, &body);
+    list_push(stmts, body);
+
+    free(ctx->inliner.map_from);
+    free(ctx->inliner.map_to);
+
+    ast_t *r = util_alloc(sizeof(ast_t));
+    r->type = AST_INLINE;
+    r->ctype = call->ctype;
+    r->callee = f->func;
+    r->inlbody = parser_ast_compound_stmt(ctx, stmts);
+    return r;
+}
+
+// arguments first, the copied body is not expanded again
+static void inliner_expand(compiler_ctx_t *ctx, ast_t **slot) {
+    if (!*slot)
+        return;
+    inliner_children(ctx, *slot, inliner_expand);
+    if ((*slot)->type == AST_FUNCALL)
+        *slot = inliner_call(ctx, *slot);
+}
+
+// the call graph outlives the functions, which may be freed once generated
+static inliner_func_t* inliner_register(compiler_ctx_t *ctx, ast_t *func) {
+    arena_t *arena = util_set_arena(util_arena_root());
+
+    if (!ctx->inliner.funcs)
+        ctx->inliner.funcs = symtab_make();
+    inliner_func_t *f = util_alloc(sizeof(inliner_func_t));
+    memset(f, 0, sizeof(inliner_func_t));
+    f->func = func;
+    f->calls = ctx->inliner.calls = list_make();
+    inliner_collect(ctx, &func->body);
+    ctx->inliner.cost = ctx->inliner.ncalls = 0;
+    inliner_count(ctx, &func->body);
+    f->cost = ctx->inliner.cost;
+    f->leaf = !ctx->inliner.ncalls;
+    symtab_put(ctx->inliner.funcs, func->fname, f);
+    if (!ctx->inliner.all) {
+        ctx->inliner.all = list_make();
+        ctx->inliner.stack = list_make();
+    }
+    list_push(ctx->inliner.all, f);
+    if (ctx->inliner.streaming) {
+        if (!ctx->inliner.called)
+            ctx->inliner.called = symtab_make();
+        if (symtab_get(ctx->inliner.called, func->fname))
+            ctx->inliner.forward++;
+        for (iter_t i = list_iter(f->calls); !list_iter_end(i);) {
+            char *name = list_iter_next(&i);
+            symtab_put(ctx->inliner.called, name, name);
+        }
+    }
+    util_set_arena(arena);
+    return f;
+}
+
+// the copies are made in the arena of the caller
+static void inliner_rewrite(compiler_ctx_t *ctx, inliner_func_t *f) {
+    arena_t *arena = util_set_arena(f->func->arena);
+
+    ctx->inliner.caller = f->func;
+    ctx->inliner.inlined = f->inlined = list_make();
+    inliner_expand(ctx, &f->func->body);
+    ctx->inliner.caller = NULL;
+    // later callers see the cost with the inlined calls
+    ctx->inliner.cost = ctx->inliner.ncalls = 0;
+    inliner_count(ctx, &f->func->body);
+    f->cost = ctx->inliner.cost;
+    f->leaf = !ctx->inliner.ncalls;
+    util_set_arena(arena);
+}
+
+int inliner_run(compiler_ctx_t *ctx, list_t *toplevels) {
+    list_t *all = list_make();
+    int inlined = 0;
+
+    if (ctx->inliner.limit <= 0)
+        return 0;
+    for (iter_t i = list_iter(toplevels); !list_iter_end(i);) {
+        ast_t *v = list_iter_next(&i);
+        if (v->type == AST_FUNC)
+            list_push(all, inliner_register(ctx, v));
+    }
+    inliner_recursion(ctx, NULL);
+
+    int first = ctx->inliner.nsites;
+    for (iter_t i = list_iter(all); !list_iter_end(i);)
+        inliner_rewrite(ctx, list_iter_next(&i));
+
+    for (int n = first; n < ctx->inliner.nsites; n++)
+        if (!ctx->inliner.sites[n].why)
+            inlined++;
+    return inlined;
+}
+
+// free the AST of f once nothing can inline it nor shares its nodes
+static void inliner_free(inliner_func_t *f) {
+    if (!f->func || f->candidate || f->users || !f->generated)
+        return;
+    // the list is in the arena freed below
+    for (iter_t i = list_iter(f->inlined); !list_iter_end(i);) {
+        inliner_func_t *g = list_iter_next(&i);
+        g->users--;
+        inliner_free(g);
+    }
+    parser_func_free(f->func);
+    f->func = NULL;
+}
+
+void inliner_add(compiler_ctx_t *ctx, ast_t *func) {
+    if (ctx->inliner.limit <= 0)
+        return;
+    ctx->inliner.streaming = true;
+    inliner_func_t *f = inliner_register(ctx, func);
+    inliner_rewrite(ctx, f);
+    inliner_recursion(ctx, f);
+    if (f->cost > ctx->inliner.limit || f->recursive || !f->leaf)
+        return;
+
+    arena_t *arena = util_set_arena(util_arena_root());
+    if (!ctx->inliner.window)
+        ctx->inliner.window = list_make();
+    f->candidate = true;
+    list_unshift(ctx->inliner.window, f);
+    if (list_len(ctx->inliner.window) > INLINER_WINDOW) {
+        inliner_func_t *old = list_pop(ctx->inliner.window);
+        old->candidate = false;
+        inliner_free(old);
+    }
+    util_set_arena(arena);
+}
+
+void inliner_release(compiler_ctx_t *ctx, ast_t *func) {
+    inliner_func_t *f = ctx->inliner.funcs ? symtab_get(ctx->inliner.funcs, func->fname) : NULL;
+
+    if (!f || f->func != func) {
+        parser_func_free(func);
+        return;
+    }
+    f->generated = true;
+    inliner_free(f);
+}
+
+void inliner_report(compiler_ctx_t *ctx, FILE *fp) {
+    int inlined = 0;
+
+    for (int n = 0; n < ctx->inliner.nsites; n++) {
+        if (ctx->inliner.sites[n].why) {
+            fprintf(fp, "  %-16s %s not inlined: %s (cost %d)\n", ctx->inliner.sites[n].caller, ctx->inliner.sites[n].callee, ctx->inliner.sites[n].why, ctx->inliner.sites[n].cost);
+        } else {
+            fprintf(fp, "  %-16s %s inlined (cost %d)\n", ctx->inliner.sites[n].caller, ctx->inliner.sites[n].callee, ctx->inliner.sites[n].cost);
+            inlined++;
+        }
+    }
+    fprintf(fp, "inlined: %d of %d call sites, limit %d\n", inlined, ctx->inliner.nsites, ctx->inliner.limit);
+}
@@ -0,0 +1,115 @@
+/*
+ * @intern.c
+ *
+ * @brief C for Stack VM
+ * @details
+ * This is based on other projects:
+ *   A minimalist C compiler with x86_64 code generation: https://github.com/jserv/MazuCC
+ *   Others (see individual files)
+ *
+ *   please contact their authors for more information.
+ *
+ * @author Emiliano Augusto Gonzalez (egonzalez . hiperion @ gmail . com)
+ * @date 2024
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/stackvm_c_compiler
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "arena.h"
+#include "c_stackvm.h"
+#include "context.h"
+#include "util.h"
+#include "intern.h"
+
+static char *keywords[KW_MAX] = {
+        [KW_VOID] = "void",
+        [KW_CHAR] = "char",
+        [KW_INT] = "int",
+        [KW_UINT] = "uint",
+#ifdef ALLOW_LONG
+        [KW_LONG] = "long",
+#endif
+        [KW_FLOAT] = "float",
+#ifdef ALLOW_DOUBLE
+        [KW_DOUBLE] = "double",
+#endif
+        [KW_STRUCT] = "struct",
+        [KW_UNION] = "union",
+        [KW_IF] = "if",
+        [KW_ELSE] = "else",
+        [KW_FOR] = "for",
+        [KW_RETURN] = "return",
+};
+
+uint32_t intern_hash(const char *str, int len) {
+    uint32_t h = 2166136261u;
+    for (int n = 0; n < len; n++) {
+        h ^= (unsigned char) str[n];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void intern_grow(compiler_ctx_t *ctx) {
+    intern_entry_t *old = ctx->intern.table;
+    int old_cap = ctx->intern.table_cap;
+
+    ctx->intern.table_cap = old_cap ? old_cap * 2 : INTERN_INIT_SIZE;
+    ctx->intern.table = arena_calloc(util_arena_root(), ctx->intern.table_cap * sizeof(intern_entry_t));
+    for (int n = 0; n < old_cap; n++) {
+        if (!old[n].str)
+            continue;
+        int pos = old[n].hash & (ctx->intern.table_cap - 1);
+        while (ctx->intern.table[pos].str)
+            pos = (pos + 1) & (ctx->intern.table_cap - 1);
+        ctx->intern.table[pos] = old[n];
+    }
+}
+
+intern_entry_t* intern_entry(compiler_ctx_t *ctx, const char *str, int len) {
+    if (!ctx->intern.table) {
+        intern_grow(ctx);
+        for (int kw = KW_NONE + 1; kw < KW_MAX; kw++)
+            intern_entry(ctx, keywords[kw], strlen(keywords[kw]))->kind = kw;
+    }
+    if (ctx->intern.table_qty * 2 >= ctx->intern.table_cap)
+        intern_grow(ctx);
+
+    uint32_t hash = intern_hash(str, len);
+    int pos = hash & (ctx->intern.table_cap - 1);
+    for (; ctx->intern.table[pos].str; pos = (pos + 1) & (ctx->intern.table_cap - 1)) {
+        if (ctx->intern.table[pos].hash == hash && ctx->intern.table[pos].len == len && !memcmp(ctx->intern.table[pos].str, str, len))
+            return &ctx->intern.table[pos];
+    }
+
+    char *s = arena_alloc(util_arena_root(), len + 1);
+    memcpy(s, str, len);
+    s[len] = '\0';
+    ctx->intern.table[pos].str = s;
+    ctx->intern.table[pos].hash = hash;
+    ctx->intern.table[pos].len = len;
+    ctx->intern.table[pos].kind = KW_NONE;
+    ctx->intern.table_qty++;
+    return &ctx->intern.table[pos];
+}
+
+char* intern_keyword_name(int kind) {
+    return (kind > KW_NONE && kind < KW_MAX) ? keywords[kind] : NULL;
+}
+
+char* intern_string(compiler_ctx_t *ctx, const char *str, int len) {
+    return intern_entry(ctx, str, len)->str;
+}
+
+char* intern_cstring(compiler_ctx_t *ctx, const char *str) {
+    return str ? intern_string(ctx, str, strlen(str)) : NULL;
+}
+
+void intern_reset(compiler_ctx_t *ctx) {
+    ctx->intern.table = NULL;
+    ctx->intern.table_cap = 0;
+    ctx->intern.table_qty = 0;
+}
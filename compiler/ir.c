@@ -0,0 +1,174 @@
+/*
+ * @ir.c
+ *
+ * @brief C for Stack VM
+ * @details
+ * This is based on other projects:
+ *   A minimalist C compiler with x86_64 code generation: https://github.com/jserv/MazuCC
+ *   Others (see individual files)
+ *
+ *   please contact their authors for more information.
+ *
+ * @author Emiliano Augusto Gonzalez (egonzalez . hiperion @ gmail . com)
+ * @date 2024
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/stackvm_c_compiler
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "c_stackvm.h"
+#include "parser.h"
+#include "util.h"
+#include "output.h"
+#include "ir.h"
+
+#define IR_INIT_INSNS  64
+#define IR_INIT_LABELS 16
+
+static void* ir_grow(void *ptr, int *cap, int elem, int init) {
+    int old = *cap;
+    *cap = *cap ? *cap * 2 : init;
+    return util_heap(ptr, (size_t) old * elem, (size_t) *cap * elem);
+}
+
+ir_func_t* ir_func_make(char *name) {
+    ir_func_t *func = util_heap(NULL, 0, sizeof(ir_func_t));
+    memset(func, 0, sizeof(ir_func_t));
+    func->name = name;
+    return func;
+}
+
+void ir_func_free(ir_func_t *func) {
+    if (!func)
+        return;
+    free(func->insns);
+    free(func->labels);
+    free(func);
+}
+
+int ir_label_make(compiler_ctx_t *ctx, ir_func_t *func) {
+    if (func->nlabels == func->labels_cap)
+        func->labels = ir_grow(func->labels, &func->labels_cap, sizeof(char*), IR_INIT_LABELS);
+    func->labels[func->nlabels] = parser_make_label(ctx);
+    return func->nlabels++;
+}
+
+ir_insn_t* ir_emit(ir_func_t *func, int op) {
+    if (func->len == func->cap)
+        func->insns = ir_grow(func->insns, &func->cap, sizeof(ir_insn_t), IR_INIT_INSNS);
+    ir_insn_t *insn = &func->insns[func->len++];
+    memset(insn, 0, sizeof(ir_insn_t));
+    insn->op = op;
+    return insn;
+}
+
+void ir_emit_int(ir_func_t *func, int op, int64_t val) {
+    ir_emit(func, op)->ival = val;
+}
+
+void ir_emit_sym(ir_func_t *func, int op, char *sym) {
+    ir_emit(func, op)->sym = sym;
+}
+
+void ir_emit_jump(ir_func_t *func, int op, int label) {
+    ir_emit(func, op)->label = label;
+}
+
+void ir_emit_call(ir_func_t *func, char *fname, int nargs) {
+    ir_insn_t *insn = ir_emit(func, OP_CALL);
+    insn->sym = fname;
+    insn->nargs = nargs;
+}
+
+void ir_place_label(ir_func_t *func, int label) {
+    ir_emit(func, IR_LABEL)->label = label;
+}
+
+bool ir_is_branch(int op) {
+    return op == OP_RET || (op != IR_LABEL && opcodes_info(op)->operand == OPND_LABEL);
+}
+
+int ir_max_depth(ir_func_t *func) {
+    int *at = util_heap(NULL, 0, (func->nlabels + 1) * sizeof(int));
+    int depth = func->nargs, max = depth;
+    bool reachable = true;
+
+    for (int n = 0; n < func->nlabels; n++)
+        at[n] = -1;
+
+    for (int n = 0; n < func->len; n++) {
+        ir_insn_t *insn = &func->insns[n];
+        if (insn->op == IR_LABEL) {
+            if (at[insn->label] >= 0)
+                depth = at[insn->label];
+            else
+                at[insn->label] = depth;
+            reachable = true;
+            continue;
+        }
+        if (!reachable)
+            continue;
+        const opcode_info_t *info = opcodes_info(insn->op);
+        depth += info->push - ((info->pop < 0) ? insn->nargs : info->pop);
+        if (depth > max)
+            max = depth;
+        if (info->operand == OPND_LABEL)
+            at[insn->label] = depth;
+        if (insn->op == OP_JMP || insn->op == OP_RET)
+            reachable = false;
+    }
+
+    free(at);
+    return max;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void ir_print_func(compiler_ctx_t *ctx, ir_func_t *func) {
+    output_str(ctx, func->name);
+    output_str(ctx, ":\n");
+    for (int n = 0; n < func->len; n++) {
+        ir_insn_t *insn = &func->insns[n];
+        if (insn->op == IR_LABEL) {
+            output_str(ctx, func->labels[insn->label]);
+            output_str(ctx, ":\n");
+            continue;
+        }
+        const opcode_info_t *info = opcodes_info(insn->op);
+        output_char(ctx, '\t');
+        output_str(ctx, info->name);
+        switch (info->operand) {
+            case OPND_INT:
+                output_char(ctx, ' ');
+                output_int(ctx, insn->ival);
+                break;
+            case OPND_SYM:
+                output_char(ctx, ' ');
+                output_str(ctx, insn->sym);
+                break;
+            case OPND_LABEL:
+                output_char(ctx, ' ');
+                output_str(ctx, func->labels[insn->label]);
+                break;
+            case OPND_CALL:
+                output_char(ctx, ' ');
+                output_str(ctx, insn->sym);
+                output_str(ctx, ", ");
+                output_int(ctx, insn->nargs);
+                break;
+            case OPND_INT2:
+                output_char(ctx, ' ');
+                output_int(ctx, insn->ival);
+                output_str(ctx, ", ");
+                output_int(ctx, insn->imm);
+                break;
+        }
+        output_char(ctx, '\n');
+    }
+    output_str(ctx, "\t.stack ");
+    output_int(ctx, func->maxstack);
+    output_char(ctx, '\n');
+}
@@ -16,25 +16,125 @@
  */
 
 #include <ctype.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "c_stackvm.h"
+#include "context.h"
+#include "intern.h"
 #include "lexer.h"
 #include "util.h"
 
 #define lexer_make_null(x)    lexer_make_token(TTYPE_NULL,   (uintptr_t) 0)
 #define lexer_make_strtok(x)  lexer_make_token(TTYPE_STRING, (uintptr_t) util_get_cstring(x))
-#define lexer_make_ident(x)   lexer_make_token(TTYPE_IDENT,  (uintptr_t) util_get_cstring(x))
+#define lexer_make_ident(x)   lexer_make_token(TTYPE_IDENT,  (uintptr_t)(x))
+#define lexer_make_keyword(x) lexer_make_token(TTYPE_KEYWORD,(uintptr_t)(x))
 #define lexer_make_punct(x)   lexer_make_token(TTYPE_PUNCT,  (uintptr_t)(x))
 #define lexer_make_number(x)  lexer_make_token(TTYPE_NUMBER, (uintptr_t)(x))
 #define lexer_make_char(x)    lexer_make_token(TTYPE_CHAR,   (uintptr_t)(x))
 
-static bool ungotten = false;
-static token_t ungotten_buf = { 0 };
+static inline int lexer_getc(compiler_ctx_t *ctx) {
+    if (!ctx->lexer.src)
+        return getc(stdin);
+    if (ctx->lexer.src_pos < ctx->lexer.src_len)
+        return (unsigned char) ctx->lexer.src[ctx->lexer.src_pos++];
+    return EOF;
+}
+
+static inline void lexer_ungetc(compiler_ctx_t *ctx, int c) {
+    if (c == EOF)
+        return;
+    if (!ctx->lexer.src)
+        ungetc(c, stdin);
+    else
+        ctx->lexer.src_pos--;
+}
+
+static token_t lexer_make_span(enum token_type type, size_t pos, size_t len) {
+    token_t ret = {
+            .type = type,
+            .priv = 0,
+            .pos = pos,
+            .len = len,
+    };
+    return ret;
+}
+
+void lexer_set_buffer(compiler_ctx_t *ctx, const char *buf, size_t len) {
+    lexer_close(ctx);
+    ctx->lexer.src = buf;
+    ctx->lexer.src_len = len;
+    ctx->lexer.src_pos = 0;
+}
+
+bool lexer_map_file(compiler_ctx_t *ctx, const char *path) {
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0)
+        return false;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return false;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        lexer_set_buffer(ctx, "", 0);
+        return true;
+    }
+
+    void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        return false;
+    madvise(p, st.st_size, MADV_SEQUENTIAL);
+
+    lexer_set_buffer(ctx, p, st.st_size);
+    ctx->lexer.map_len = st.st_size;
+    return true;
+}
+
+void lexer_close(compiler_ctx_t *ctx) {
+    if (ctx->lexer.map_len)
+        munmap((void*) ctx->lexer.src, ctx->lexer.map_len);
+    ctx->lexer.map_len = 0;
+    ctx->lexer.src = NULL;
+    ctx->lexer.src_len = ctx->lexer.src_pos = 0;
+    ctx->lexer.ungotten = false;
+}
+
+char* lexer_token_cstring(compiler_ctx_t *ctx, const token_t tok, char *buf, int size) {
+    if (tok.priv || (get_ttype(tok) != TTYPE_NUMBER && get_ttype(tok) != TTYPE_STRING))
+        return (char*) tok.priv;
+
+    const char *p = ctx->lexer.src + tok.pos;
+    char *r = (buf && tok.len < size) ? buf : util_alloc(tok.len + 1);
+    int len = 0;
+
+    if (get_ttype(tok) == TTYPE_NUMBER) {
+        memcpy(r, p, tok.len);
+        len = tok.len;
+    } else {
+        // escapes were validated by lexer_read_string
+        for (int n = 0; n < tok.len; n++) {
+            if (p[n] == '\\' && p[++n] == 'n')
+                r[len++] = '\n';
+            else
+                r[len++] = p[n];
+        }
+    }
+    r[len] = '\0';
+    return r;
+}
 
-extern void **mkstr;
-extern long mkstr_qty;
+char* lexer_token_text(compiler_ctx_t *ctx, const token_t tok) {
+    return lexer_token_cstring(ctx, tok, NULL, 0);
+}
 
 token_t lexer_make_token(enum token_type type, uintptr_t data) {
     token_t ret = {
@@ -44,9 +144,9 @@ token_t lexer_make_token(enum token_type type, uintptr_t data) {
     return ret;
 }
 
-int lexer_getc_nonspace(void) {
+int lexer_getc_nonspace(compiler_ctx_t *ctx) {
     int c;
-    while ((c = getc(stdin)) != EOF) {
+    while ((c = lexer_getc(ctx)) != EOF) {
         if (isspace(c) || c == '\n' || c == '\r')
             continue;
         return c;
@@ -54,30 +154,36 @@ int lexer_getc_nonspace(void) {
     return EOF;
 }
 
-token_t lexer_read_number(char c) {
+token_t lexer_read_number(compiler_ctx_t *ctx, char c) {
+    if (ctx->lexer.src) {
+        size_t start = ctx->lexer.src_pos - 1;
+        while (ctx->lexer.src_pos < ctx->lexer.src_len && (isalnum((unsigned char) ctx->lexer.src[ctx->lexer.src_pos]) || ctx->lexer.src[ctx->lexer.src_pos] == '.'))
+            ctx->lexer.src_pos++;
+        return lexer_make_span(TTYPE_NUMBER, start, ctx->lexer.src_pos - start);
+    }
+
     string_t s = util_make_string();
-    add_str_ptr(mkstr, mkstr_qty, s.body);
     util_string_append(&s, c);
     while (1) {
-        int c = getc(stdin);
+        int c = lexer_getc(ctx);
         if (!isdigit(c) && !isalpha(c) && c != '.') {
-            ungetc(c, stdin);
+            lexer_ungetc(ctx, c);
             return lexer_make_number(util_get_cstring(s));
         }
         util_string_append(&s, c);
     }
 }
 
-token_t lexer_read_char(void) {
-    char c = getc(stdin);
+token_t lexer_read_char(compiler_ctx_t *ctx) {
+    char c = lexer_getc(ctx);
     if (c == EOF)
         goto err;
     if (c == '\\') {
-        c = getc(stdin);
+        c = lexer_getc(ctx);
         if (c == EOF)
             goto err;
     }
-    char c2 = getc(stdin);
+    char c2 = lexer_getc(ctx);
     if (c2 == EOF)
         goto err;
     if (c2 != '\'')
@@ -88,64 +194,107 @@ err:
     return lexer_make_null(); /* non-reachable */
 }
 
-token_t lexer_read_string(void) {
+static int lexer_read_escape(compiler_ctx_t *ctx) {
+    int c = lexer_getc(ctx);
+    switch (c) {
+        case EOF:
+            util_error("Unterminated \\");
+            break;
+        case '\"':
+            break;
+        case 'n':
+            c = '\n';
+            break;
+        default:
+            util_error("Unknown quote: %c", c);
+    }
+    return c;
+}
+
+token_t lexer_read_string(compiler_ctx_t *ctx) {
+    if (ctx->lexer.src) {
+        size_t start = ctx->lexer.src_pos;
+        while (1) {
+            int c = lexer_getc(ctx);
+            if (c == EOF)
+                util_error("Unterminated string");
+            if (c == '"')
+                break;
+            if (c == '\\')
+                lexer_read_escape(ctx);
+        }
+        return lexer_make_span(TTYPE_STRING, start, ctx->lexer.src_pos - 1 - start);
+    }
+
     string_t s = util_make_string();
-    add_str_ptr(mkstr, mkstr_qty, s.body);
     while (1) {
-        int c = getc(stdin);
+        int c = lexer_getc(ctx);
         if (c == EOF)
             util_error("Unterminated string");
         if (c == '"')
             break;
-        if (c == '\\') {
-            c = getc(stdin);
-            switch (c) {
-                case EOF:
-                    util_error("Unterminated \\");
-                    break;
-                case '\"':
-                    break;
-                case 'n':
-                    c = '\n';
-                    break;
-                default:
-                    util_error("Unknown quote: %c", c);
-            }
-        }
+        if (c == '\\')
+            c = lexer_read_escape(ctx);
         util_string_append(&s, c);
     }
     return lexer_make_strtok(s);
 }
 
-token_t lexer_read_ident(char c) {
-    string_t s = util_make_string();
-    add_str_ptr(mkstr, mkstr_qty, s.body);
-    util_string_append(&s, c);
-    while (1) {
-        int c2 = getc(stdin);
-        if (isalnum(c2) || c2 == '_') {
-            util_string_append(&s, c2);
-        } else {
-            ungetc(c2, stdin);
-            return lexer_make_ident(s);
+token_t lexer_read_ident(compiler_ctx_t *ctx, char c) {
+    intern_entry_t *e;
+
+    if (ctx->lexer.src) {
+        // zero copy: the spelling is only copied the first time it is interned
+        size_t start = ctx->lexer.src_pos - 1;
+        while (ctx->lexer.src_pos < ctx->lexer.src_len && (isalnum((unsigned char) ctx->lexer.src[ctx->lexer.src_pos]) || ctx->lexer.src[ctx->lexer.src_pos] == '_'))
+            ctx->lexer.src_pos++;
+        e = intern_entry(ctx, ctx->lexer.src + start, ctx->lexer.src_pos - start);
+    } else {
+        char buf[LEXER_IDENT_LEN];
+        string_t s = { .body = NULL };
+        int len = 0;
+
+        buf[len++] = c;
+        while (1) {
+            int c2 = lexer_getc(ctx);
+            if (!isalnum(c2) && c2 != '_') {
+                lexer_ungetc(ctx, c2);
+                break;
+            }
+            if (s.body) {
+                util_string_append(&s, c2);
+            } else if (len < LEXER_IDENT_LEN) {
+                buf[len++] = c2;
+            } else {
+                // identifiers longer than the local buffer are rare, spill to the arena
+                s = util_make_string();
+                for (int n = 0; n < len; n++)
+                    util_string_append(&s, buf[n]);
+                util_string_append(&s, c2);
+            }
         }
+        e = s.body ? intern_entry(ctx, s.body, s.len) : intern_entry(ctx, buf, len);
     }
+
+    if (e->kind != KW_NONE)
+        return lexer_make_keyword(e->kind);
+    return lexer_make_ident(e->str);
 }
 
-void lexer_skip_line_comment(void) {
+void lexer_skip_line_comment(compiler_ctx_t *ctx) {
     while (1) {
-        int c = getc(stdin);
+        int c = lexer_getc(ctx);
         if (c == '\n' || c == EOF)
             return;
     }
 }
 
-void lexer_skip_block_comment(void) {
+void lexer_skip_block_comment(compiler_ctx_t *ctx) {
     enum {
         in_comment, asterisk_read
     } state = in_comment;
     while (1) {
-        int c = getc(stdin);
+        int c = lexer_getc(ctx);
         if (state == in_comment) {
             if (c == '*')
                 state = asterisk_read;
@@ -155,34 +304,34 @@ void lexer_skip_block_comment(void) {
     }
 }
 
-token_t lexer_read_rep(int expect, int t1, int t2) {
-    int c = getc(stdin);
+token_t lexer_read_rep(compiler_ctx_t *ctx, int expect, int t1, int t2) {
+    int c = lexer_getc(ctx);
     if (c == expect)
         return lexer_make_punct(t2);
-    ungetc(c, stdin);
+    lexer_ungetc(ctx, c);
     return lexer_make_punct(t1);
 }
 
-token_t lexer_read_token_int(void) {
-    int c = lexer_getc_nonspace();
+token_t lexer_read_token_int(compiler_ctx_t *ctx) {
+    int c = lexer_getc_nonspace(ctx);
     switch (c) {
         case '0' ... '9':
-            return lexer_read_number(c);
+            return lexer_read_number(ctx, c);
         case 'a' ... 'z':
         case 'A' ... 'Z':
         case '_':
-            return lexer_read_ident(c);
+            return lexer_read_ident(ctx, c);
         case '/': {
-            c = getc(stdin);
+            c = lexer_getc(ctx);
             if (c == '/') {
-                lexer_skip_line_comment();
-                return lexer_read_token_int();
+                lexer_skip_line_comment(ctx);
+                return lexer_read_token_int(ctx);
             }
             if (c == '*') {
-                lexer_skip_block_comment();
-                return lexer_read_token_int();
+                lexer_skip_block_comment(ctx);
+                return lexer_read_token_int(ctx);
             }
-            ungetc(c, stdin);
+            lexer_ungetc(ctx, c);
             return lexer_make_punct('/');
         }
         case '*':
@@ -200,29 +349,29 @@ token_t lexer_read_token_int(void) {
         case ':':
             return lexer_make_punct(c);
         case '-':
-            c = getc(stdin);
+            c = lexer_getc(ctx);
             if (c == '-')
                 return lexer_make_punct(PUNCT_DEC);
             if (c == '>')
                 return lexer_make_punct(PUNCT_ARROW);
-            ungetc(c, stdin);
+            lexer_ungetc(ctx, c);
             return lexer_make_punct('-');
         case '=':
-            return lexer_read_rep('=', '=', PUNCT_EQ);
+            return lexer_read_rep(ctx, '=', '=', PUNCT_EQ);
         case '+':
-            return lexer_read_rep('+', '+', PUNCT_INC);
+            return lexer_read_rep(ctx, '+', '+', PUNCT_INC);
         case '&':
-            return lexer_read_rep('&', '&', PUNCT_LOGAND);
+            return lexer_read_rep(ctx, '&', '&', PUNCT_LOGAND);
         case '|':
-            return lexer_read_rep('|', '|', PUNCT_LOGOR);
+            return lexer_read_rep(ctx, '|', '|', PUNCT_LOGOR);
         case '<':
-            return lexer_read_rep('<', '<', PUNCT_LSHIFT);
+            return lexer_read_rep(ctx, '<', '<', PUNCT_LSHIFT);
         case '>':
-            return lexer_read_rep('>', '>', PUNCT_RSHIFT);
+            return lexer_read_rep(ctx, '>', '>', PUNCT_RSHIFT);
         case '"':
-            return lexer_read_string();
+            return lexer_read_string(ctx);
         case '\'':
-            return lexer_read_char();
+            return lexer_read_char(ctx);
         case EOF:
             return lexer_make_null();
         default:
@@ -235,25 +384,25 @@ bool lexer_is_punct(const token_t tok, int c) {
     return (get_ttype(tok) == TTYPE_PUNCT) && (get_punct(tok) == c);
 }
 
-void lexer_unget_token(const token_t tok) {
+void lexer_unget_token(compiler_ctx_t *ctx, const token_t tok) {
     if (get_ttype(tok) == TTYPE_NULL)
         return;
-    if (ungotten)
+    if (ctx->lexer.ungotten)
         util_error("Push back buffer is already full");
-    ungotten = true;
-    ungotten_buf = lexer_make_token(tok.type, tok.priv);
+    ctx->lexer.ungotten = true;
+    ctx->lexer.ungotten_buf = tok;
 }
 
-token_t lexer_peek_token(void) {
-    token_t tok = lexer_read_token();
-    lexer_unget_token(tok);
+token_t lexer_peek_token(compiler_ctx_t *ctx) {
+    token_t tok = lexer_read_token(ctx);
+    lexer_unget_token(ctx, tok);
     return tok;
 }
 
-token_t lexer_read_token(void) {
-    if (ungotten) {
-        ungotten = false;
-        return lexer_make_token(ungotten_buf.type, ungotten_buf.priv);
+token_t lexer_read_token(compiler_ctx_t *ctx) {
+    if (ctx->lexer.ungotten) {
+        ctx->lexer.ungotten = false;
+        return ctx->lexer.ungotten_buf;
     }
-    return lexer_read_token_int();
+    return lexer_read_token_int(ctx);
 }
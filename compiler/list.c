@@ -21,20 +21,15 @@
 #include "util.h"
 #include "list.h"
 
-extern void **mkstr;
-extern long mkstr_qty;
-
 list_t* list_make(void) {
-    list_t *r = malloc(sizeof(list_t));
-    add_str_ptr(mkstr, mkstr_qty, r);
+    list_t *r = util_alloc(sizeof(list_t));
     r->len = 0;
     r->head = r->tail = NULL;
     return r;
 }
 
 void* list_make_node(void *elem) {
-    list_node_t *r = malloc(sizeof(list_node_t));
-    add_str_ptr(mkstr, mkstr_qty, r);
+    list_node_t *r = util_alloc(sizeof(list_node_t));
     r->elem = elem;
     r->next = NULL;
     r->prev = NULL;
@@ -63,14 +58,9 @@ void* list_pop(list_t *list) {
         list->tail->next = NULL;
     else
         list->head = NULL;
+    list->len--;
 
-    for (long n = 0; n < mkstr_qty; n++) {
-        if (mkstr[n] == tail)
-            mkstr[n] = NULL;
-    }
-
-    free(tail);
-    tail = NULL;
+    util_lfree(tail);
     return r;
 }
 
@@ -114,17 +104,7 @@ int list_len(list_t *list) {
 }
 
 void list_free(list_t *list) {
-    list_node_t *node, *tmp;
-    list_for_each_safe (node, tmp, list)
-    {
-        for (long n = 0; n < mkstr_qty; n++) {
-            if (mkstr[n] == node->elem)
-                mkstr[n] = NULL;
-            if (mkstr[n] == node)
-                mkstr[n] = NULL;
-        }
-
-        free(node->elem);
-        free(node);
-    }
+    // nodes and elements live in the arena, they are released with it
+    list->head = list->tail = NULL;
+    list->len = 0;
 }
@@ -0,0 +1,133 @@
+/*
+ * @opcodes.c
+ *
+ * @brief C for Stack VM
+ * @details
+ * This is based on other projects:
+ *   A minimalist C compiler with x86_64 code generation: https://github.com/jserv/MazuCC
+ *   Others (see individual files)
+ *
+ *   please contact their authors for more information.
+ *
+ * @author Emiliano Augusto Gonzalez (egonzalez . hiperion @ gmail . com)
+ * @date 2024
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/stackvm_c_compiler
+ */
+
+#include <string.h>
+
+#include "opcodes.h"
+
+static const opcode_info_t opcodes[OP_MAX] = {
+        [OP_NOP]      = { "nop",       0, 0, OPND_NONE  },
+        [OP_PUSH]     = { "push",      0, 1, OPND_INT   },
+        [OP_DROP]     = { "drop",      1, 0, OPND_NONE  },
+        [OP_DUP]      = { "dup",       1, 2, OPND_NONE  },
+        [OP_SWAP]     = { "swap",      2, 2, OPND_NONE  },
+        [OP_OVER]     = { "over",      2, 3, OPND_NONE  },
+        [OP_LEA]      = { "lea",       0, 1, OPND_INT   },
+        [OP_GADDR]    = { "gaddr",     0, 1, OPND_SYM   },
+        [OP_LD_I8]    = { "ld.i8",     1, 1, OPND_NONE  },
+        [OP_LD_I32]   = { "ld.i32",    1, 1, OPND_NONE  },
+        [OP_LD_U32]   = { "ld.u32",    1, 1, OPND_NONE  },
+        [OP_LD_I64]   = { "ld.i64",    1, 1, OPND_NONE  },
+        [OP_LD_F32]   = { "ld.f32",    1, 1, OPND_NONE  },
+        [OP_LD_F64]   = { "ld.f64",    1, 1, OPND_NONE  },
+        [OP_ST_I8]    = { "st.i8",     2, 0, OPND_NONE  },
+        [OP_ST_I32]   = { "st.i32",    2, 0, OPND_NONE  },
+        [OP_ST_I64]   = { "st.i64",    2, 0, OPND_NONE  },
+        [OP_ST_F32]   = { "st.f32",    2, 0, OPND_NONE  },
+        [OP_ST_F64]   = { "st.f64",    2, 0, OPND_NONE  },
+        [OP_LDL_I8]   = { "ldl.i8",    0, 1, OPND_INT   },
+        [OP_LDL_I32]  = { "ldl.i32",   0, 1, OPND_INT   },
+        [OP_LDL_U32]  = { "ldl.u32",   0, 1, OPND_INT   },
+        [OP_LDL_I64]  = { "ldl.i64",   0, 1, OPND_INT   },
+        [OP_LDL_F32]  = { "ldl.f32",   0, 1, OPND_INT   },
+        [OP_LDL_F64]  = { "ldl.f64",   0, 1, OPND_INT   },
+        [OP_STL_I8]   = { "stl.i8",    1, 0, OPND_INT   },
+        [OP_STL_I32]  = { "stl.i32",   1, 0, OPND_INT   },
+        [OP_STL_I64]  = { "stl.i64",   1, 0, OPND_INT   },
+        [OP_STL_F32]  = { "stl.f32",   1, 0, OPND_INT   },
+        [OP_STL_F64]  = { "stl.f64",   1, 0, OPND_INT   },
+        [OP_ADD]      = { "add",       2, 1, OPND_NONE  },
+        [OP_SUB]      = { "sub",       2, 1, OPND_NONE  },
+        [OP_MUL]      = { "mul",       2, 1, OPND_NONE  },
+        [OP_DIV]      = { "div",       2, 1, OPND_NONE  },
+        [OP_UDIV]     = { "udiv",      2, 1, OPND_NONE  },
+        [OP_AND]      = { "and",       2, 1, OPND_NONE  },
+        [OP_OR]       = { "or",        2, 1, OPND_NONE  },
+        [OP_SHL]      = { "shl",       2, 1, OPND_NONE  },
+        [OP_SHR]      = { "shr",       2, 1, OPND_NONE  },
+        [OP_USHR]     = { "ushr",      2, 1, OPND_NONE  },
+        [OP_LT]       = { "lt",        2, 1, OPND_NONE  },
+        [OP_GT]       = { "gt",        2, 1, OPND_NONE  },
+        [OP_ULT]      = { "ult",       2, 1, OPND_NONE  },
+        [OP_UGT]      = { "ugt",       2, 1, OPND_NONE  },
+        [OP_EQ]       = { "eq",        2, 1, OPND_NONE  },
+        [OP_NOT]      = { "not",       1, 1, OPND_NONE  },
+        [OP_U32]      = { "u32",       1, 1, OPND_NONE  },
+        [OP_SX_I8]    = { "sx.i8",     1, 1, OPND_NONE  },
+        [OP_SX_I32]   = { "sx.i32",    1, 1, OPND_NONE  },
+        [OP_FADD]     = { "fadd",      2, 1, OPND_NONE  },
+        [OP_FSUB]     = { "fsub",      2, 1, OPND_NONE  },
+        [OP_FMUL]     = { "fmul",      2, 1, OPND_NONE  },
+        [OP_FDIV]     = { "fdiv",      2, 1, OPND_NONE  },
+        [OP_FLT]      = { "flt",       2, 1, OPND_NONE  },
+        [OP_FGT]      = { "fgt",       2, 1, OPND_NONE  },
+        [OP_FEQ]      = { "feq",       2, 1, OPND_NONE  },
+        [OP_ITOF]     = { "itof",      1, 1, OPND_NONE  },
+        [OP_FTOI]     = { "ftoi",      1, 1, OPND_NONE  },
+        [OP_JMP]      = { "jmp",       0, 0, OPND_LABEL },
+        [OP_JZ]       = { "jz",        1, 0, OPND_LABEL },
+        [OP_JNZ]      = { "jnz",       1, 0, OPND_LABEL },
+        [OP_CALL]     = { "call",     -1, 1, OPND_CALL  },
+        [OP_RET]      = { "ret",       1, 0, OPND_NONE  },
+        [OP_ENTER]    = { "enter",     0, 0, OPND_INT   },
+
+        [OP_ADDI]     = { "addi",      1, 1, OPND_INT   },
+        [OP_SUBI]     = { "subi",      1, 1, OPND_INT   },
+        [OP_MULI]     = { "muli",      1, 1, OPND_INT   },
+        [OP_LDL2_I32] = { "ldl2.i32",  0, 2, OPND_INT2  },
+        [OP_IXL_I32]  = { "ixl.i32",   1, 1, OPND_INT2  },
+        [OP_INCL_I32] = { "incl.i32",  0, 0, OPND_INT2  },
+        [OP_JLT]      = { "jlt",       2, 0, OPND_LABEL },
+        [OP_JGE]      = { "jge",       2, 0, OPND_LABEL },
+        [OP_JGT]      = { "jgt",       2, 0, OPND_LABEL },
+        [OP_JLE]      = { "jle",       2, 0, OPND_LABEL },
+        [OP_JEQ]      = { "jeq",       2, 0, OPND_LABEL },
+        [OP_JNE]      = { "jne",       2, 0, OPND_LABEL },
+        [OP_PUSHF]    = { "pushf",     0, 1, OPND_INT   },
+};
+
+static const int load_ops[] = { OP_LD_I8, OP_LD_I32, OP_LD_U32, OP_LD_I64, OP_LD_F32, OP_LD_F64 };
+static const int store_ops[] = { OP_ST_I8, OP_ST_I32, OP_ST_I32, OP_ST_I64, OP_ST_F32, OP_ST_F64 };
+static const int load_local_ops[] = { OP_LDL_I8, OP_LDL_I32, OP_LDL_U32, OP_LDL_I64, OP_LDL_F32, OP_LDL_F64 };
+static const int store_local_ops[] = { OP_STL_I8, OP_STL_I32, OP_STL_I32, OP_STL_I64, OP_STL_F32, OP_STL_F64 };
+
+const opcode_info_t* opcodes_info(int op) {
+    return &opcodes[op];
+}
+
+int opcodes_find(const char *name) {
+    for (int op = 0; op < OP_MAX; op++)
+        if (opcodes[op].name && !strcmp(opcodes[op].name, name))
+            return op;
+    return -1;
+}
+
+int opcodes_load(int mt) {
+    return load_ops[mt];
+}
+
+int opcodes_store(int mt) {
+    return store_ops[mt];
+}
+
+int opcodes_load_local(int mt) {
+    return load_local_ops[mt];
+}
+
+int opcodes_store_local(int mt) {
+    return store_local_ops[mt];
+}
@@ -0,0 +1,122 @@
+/*
+ * @output.c
+ *
+ * @brief C for Stack VM
+ * @details
+ * This is based on other projects:
+ *   A minimalist C compiler with x86_64 code generation: https://github.com/jserv/MazuCC
+ *   Others (see individual files)
+ *
+ *   please contact their authors for more information.
+ *
+ * @author Emiliano Augusto Gonzalez (egonzalez . hiperion @ gmail . com)
+ * @date 2024
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/stackvm_c_compiler
+ */
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "c_stackvm.h"
+#include "context.h"
+#include "util.h"
+#include "output.h"
+
+/*
+ * The output is formatted into one buffer and written to the descriptor of
+ * ctx->outfp when it is full, so a large output is never held in memory and a
+ * line costs no system call nor printf parsing. A block that does not fit
+ * (the bytecode image) goes out with the buffer in a single writev.
+ */
+
+static void output_writev(compiler_ctx_t *ctx, struct iovec *iov, int n) {
+    int fd = fileno(ctx->outfp);
+
+    // whatever was written through the FILE goes first
+    fflush(ctx->outfp);
+    while (n > 0) {
+        ssize_t done = writev(fd, iov, n);
+        if (done < 0) {
+            if (errno == EINTR)
+                continue;
+            util_error("Can't write the output: %s", strerror(errno));
+        }
+        for (; n > 0 && (size_t) done >= iov->iov_len; iov++, n--)
+            done -= iov->iov_len;
+        if (n > 0) {
+            iov->iov_base = (char*) iov->iov_base + done;
+            iov->iov_len -= done;
+        }
+    }
+}
+
+static char* output_reserve(compiler_ctx_t *ctx, size_t len) {
+    if (ctx->output.len + len > OUTPUT_BUFFER_SIZE)
+        output_flush(ctx);
+    return ctx->output.buf + ctx->output.len;
+}
+
+void output_flush(compiler_ctx_t *ctx) {
+    struct iovec iov = { ctx->output.buf, ctx->output.len };
+
+    if (!ctx->output.len)
+        return;
+    ctx->output.len = 0;
+    output_writev(ctx, &iov, 1);
+}
+
+void output_write(compiler_ctx_t *ctx, const void *data, size_t len) {
+    // an empty section may have no buffer at all
+    if (!len)
+        return;
+    if (len <= OUTPUT_BUFFER_SIZE / 2) {
+        memcpy(output_reserve(ctx, len), data, len);
+        ctx->output.len += len;
+        return;
+    }
+    struct iovec iov[2] = { { ctx->output.buf, ctx->output.len }, { (void*) data, len } };
+    ctx->output.len = 0;
+    output_writev(ctx, iov[0].iov_len ? iov : iov + 1, iov[0].iov_len ? 2 : 1);
+}
+
+void output_str(compiler_ctx_t *ctx, const char *str) {
+    output_write(ctx, str, strlen(str));
+}
+
+void output_char(compiler_ctx_t *ctx, char c) {
+    *output_reserve(ctx, 1) = c;
+    ctx->output.len++;
+}
+
+void output_int(compiler_ctx_t *ctx, long val) {
+    char buf[24];
+    int n = sizeof(buf);
+    unsigned long u = (val < 0) ? -(unsigned long) val : (unsigned long) val;
+
+    do {
+        buf[--n] = '0' + u % 10;
+        u /= 10;
+    } while (u);
+    if (val < 0)
+        buf[--n] = '-';
+    memcpy(output_reserve(ctx, sizeof(buf) - n), buf + n, sizeof(buf) - n);
+    ctx->output.len += sizeof(buf) - n;
+}
+
+void output_printf(compiler_ctx_t *ctx, const char *fmt, ...) {
+    va_list args;
+    char buf[256];
+
+    va_start(args, fmt);
+    int len = vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    if (len < 0 || len >= (int) sizeof(buf))
+        util_error("internal error: output too long for output_printf");
+    output_write(ctx, buf, len);
+}
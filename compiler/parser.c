@@ -22,25 +22,20 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "arena.h"
 #include "list.h"
 #include "c_stackvm.h"
+#include "context.h"
 #include "parser.h"
 #include "dict.h"
+#include "symtab.h"
 #include "verbose.h"
 #include "lexer.h"
+#include "fold.h"
+#include "intern.h"
+#include "trace.h"
 
-extern void **mkstr;
-extern long mkstr_qty;
 
-list_t *ctypes = &list_empty;
-list_t *strings = &list_empty;
-list_t *flonums = &list_empty;
-
-static dict_t *globalenv = &list_empty_dict;
-static dict_t *localenv = NULL;
-static dict_t *struct_defs = &list_empty_dict;
-static dict_t *union_defs = &list_empty_dict;
-static list_t *localvars = NULL;
 
 static ctype_t *ctype_void = &(ctype_t )  { CTYPE_VOID,  0, NULL };
 static ctype_t *ctype_int = &(ctype_t )   { CTYPE_INT,   4, NULL };
@@ -53,22 +48,35 @@ static ctype_t *ctype_float = &(ctype_t ) { CTYPE_FLOAT, 4, NULL };
 #ifdef ALLOW_DOUBLE
 static ctype_t *ctype_double = &(ctype_t ) { CTYPE_DOUBLE, 8, NULL };
 #endif
-static int labelseq = 0;
 
-ast_t* parser_ast_uop(int type, ctype_t *ctype, ast_t *operand) {
-    ast_t *r = malloc(sizeof(ast_t));
-    add_str_ptr(mkstr, mkstr_qty, r);
+static ast_t* parser_ast_alloc(compiler_ctx_t *ctx) {
+    ctx->parser.nodes++;
+    return util_alloc(sizeof(ast_t));
+}
+
+static void parser_push_scope(compiler_ctx_t *ctx) {
+    ctx->parser.scopes++;
+    symtab_push(ctx->parser.env);
+}
+
+ast_t* parser_ast_uop(compiler_ctx_t *ctx, int type, ctype_t *ctype, ast_t *operand) {
+    ast_t *r = parser_ast_alloc(ctx);
     r->type = type;
     r->ctype = ctype;
     r->operand = operand;
     return r;
 }
 
-ast_t* parser_ast_binop(int type, ast_t *left, ast_t *right) {
-    ast_t *r = malloc(sizeof(ast_t));
-    add_str_ptr(mkstr, mkstr_qty, r);
+ast_t* parser_ast_binop(compiler_ctx_t *ctx, int type, ast_t *left, ast_t *right) {
+    ast_t *r = parser_ast_alloc(ctx);
     r->type = type;
     r->ctype = parser_result_type(type, left->ctype, right->ctype);
+    // comparisons and logical operators yield an int whatever the operand type
+    if (type == '<' || type == '>' || type == PUNCT_EQ || type == PUNCT_LOGAND || type == PUNCT_LOGOR)
+        r->ctype = ctype_int;
+    // an assignment has the type of its left operand
+    if (type == '=')
+        r->ctype = left->ctype;
     if (type != '=' && parser_convert_array(left->ctype)->type != CTYPE_PTR && parser_convert_array(right->ctype)->type == CTYPE_PTR) {
         r->left = right;
         r->right = left;
@@ -79,18 +87,16 @@ ast_t* parser_ast_binop(int type, ast_t *left, ast_t *right) {
     return r;
 }
 
-ast_t* parser_ast_inttype(ctype_t *ctype, long val) {
-    ast_t *r = malloc(sizeof(ast_t));
-    add_str_ptr(mkstr, mkstr_qty, r);
+ast_t* parser_ast_inttype(compiler_ctx_t *ctx, ctype_t *ctype, long val) {
+    ast_t *r = parser_ast_alloc(ctx);
     r->type = AST_LITERAL;
     r->ctype = ctype;
     r->ival = val;
     return r;
 }
 
-ast_t* parser_ast_double(double val) {
-    ast_t *r = malloc(sizeof(ast_t));
-    add_str_ptr(mkstr, mkstr_qty, r);
+ast_t* parser_ast_double(compiler_ctx_t *ctx, double val) {
+    ast_t *r = parser_ast_alloc(ctx);
     r->type = AST_LITERAL;
 #ifdef ALLOW_DOUBLE
     r->ctype = ctype_double;
@@ -98,53 +104,48 @@ ast_t* parser_ast_double(double val) {
     r->ctype = ctype_float;
 #endif
     r->fval = val;
-    list_push(flonums, r);
+    r->flabel = NULL;
     return r;
 }
 
-char* parser_make_label(void) {
+char* parser_make_label(compiler_ctx_t *ctx) {
     string_t s = util_make_string();
-    add_str_ptr(mkstr, mkstr_qty, s.body);
-    util_string_appendf(&s, ".L%d", labelseq++);
+    util_string_appendf(&s, ".L%d", ctx->parser.labelseq++);
     return util_get_cstring(s);
 }
 
-ast_t* parser_ast_lvar(ctype_t *ctype, char *name) {
-    ast_t *r = malloc(sizeof(ast_t));
-    add_str_ptr(mkstr, mkstr_qty, r);
+ast_t* parser_ast_lvar(compiler_ctx_t *ctx, ctype_t *ctype, char *name) {
+    ast_t *r = parser_ast_alloc(ctx);
     r->type = AST_LVAR;
     r->ctype = ctype;
     r->varname = name;
-    dict_put(localenv, name, r);
-    if (localvars)
-        list_push(localvars, r);
+    symtab_put(ctx->parser.env, name, r);
+    if (ctx->parser.localvars)
+        list_push(ctx->parser.localvars, r);
     return r;
 }
 
-ast_t* parser_ast_gvar(ctype_t *ctype, char *name, bool filelocal) {
-    ast_t *r = malloc(sizeof(ast_t));
-    add_str_ptr(mkstr, mkstr_qty, r);
+ast_t* parser_ast_gvar(compiler_ctx_t *ctx, ctype_t *ctype, char *name, bool filelocal) {
+    ast_t *r = parser_ast_alloc(ctx);
     r->type = AST_GVAR;
     r->ctype = ctype;
     r->varname = name;
-    r->glabel = filelocal ? parser_make_label() : name;
-    dict_put(globalenv, name, r);
+    r->glabel = filelocal ? parser_make_label(ctx) : name;
+    symtab_put(ctx->parser.env, name, r);
     return r;
 }
 
-ast_t* parser_ast_string(char *str) {
-    ast_t *r = malloc(sizeof(ast_t));
-    add_str_ptr(mkstr, mkstr_qty, r);
+ast_t* parser_ast_string(compiler_ctx_t *ctx, char *str) {
+    ast_t *r = parser_ast_alloc(ctx);
     r->type = AST_STRING;
     r->ctype = parser_make_array_type(ctype_char, strlen(str) + 1);
     r->sval = str;
-    r->slabel = parser_make_label();
+    r->slabel = parser_make_label(ctx);
     return r;
 }
 
-ast_t* parser_ast_funcall(ctype_t *ctype, char *fname, list_t *args) {
-    ast_t *r = malloc(sizeof(ast_t));
-    add_str_ptr(mkstr, mkstr_qty, r);
+ast_t* parser_ast_funcall(compiler_ctx_t *ctx, ctype_t *ctype, char *fname, list_t *args) {
+    ast_t *r = parser_ast_alloc(ctx);
     r->type = AST_FUNCALL;
     r->ctype = ctype;
     r->fname = fname;
@@ -152,9 +153,8 @@ ast_t* parser_ast_funcall(ctype_t *ctype, char *fname, list_t *args) {
     return r;
 }
 
-ast_t* parser_ast_func(ctype_t *rettype, char *fname, list_t *params, ast_t *body, list_t *localvars) {
-    ast_t *r = malloc(sizeof(ast_t));
-    add_str_ptr(mkstr, mkstr_qty, r);
+ast_t* parser_ast_func(compiler_ctx_t *ctx, ctype_t *rettype, char *fname, list_t *params, ast_t *body, list_t *localvars) {
+    ast_t *r = parser_ast_alloc(ctx);
     r->type = AST_FUNC;
     r->ctype = rettype;
     r->fname = fname;
@@ -164,9 +164,8 @@ ast_t* parser_ast_func(ctype_t *rettype, char *fname, list_t *params, ast_t *bod
     return r;
 }
 
-ast_t* parser_ast_decl(ast_t *var, ast_t *init) {
-    ast_t *r = malloc(sizeof(ast_t));
-    add_str_ptr(mkstr, mkstr_qty, r);
+ast_t* parser_ast_decl(compiler_ctx_t *ctx, ast_t *var, ast_t *init) {
+    ast_t *r = parser_ast_alloc(ctx);
     r->type = AST_DECL;
     r->ctype = NULL;
     r->declvar = var;
@@ -174,18 +173,16 @@ ast_t* parser_ast_decl(ast_t *var, ast_t *init) {
     return r;
 }
 
-ast_t* parser_ast_array_init(list_t *arrayinit) {
-    ast_t *r = malloc(sizeof(ast_t));
-    add_str_ptr(mkstr, mkstr_qty, r);
+ast_t* parser_ast_array_init(compiler_ctx_t *ctx, list_t *arrayinit) {
+    ast_t *r = parser_ast_alloc(ctx);
     r->type = AST_ARRAY_INIT;
     r->ctype = NULL;
     r->arrayinit = arrayinit;
     return r;
 }
 
-ast_t* parser_ast_if(ast_t *cond, ast_t *then, ast_t *els) {
-    ast_t *r = malloc(sizeof(ast_t));
-    add_str_ptr(mkstr, mkstr_qty, r);
+ast_t* parser_ast_if(compiler_ctx_t *ctx, ast_t *cond, ast_t *then, ast_t *els) {
+    ast_t *r = parser_ast_alloc(ctx);
     r->type = AST_IF;
     r->ctype = NULL;
     r->cond = cond;
@@ -194,9 +191,8 @@ ast_t* parser_ast_if(ast_t *cond, ast_t *then, ast_t *els) {
     return r;
 }
 
-ast_t* parser_ast_ternary(ctype_t *ctype, ast_t *cond, ast_t *then, ast_t *els) {
-    ast_t *r = malloc(sizeof(ast_t));
-    add_str_ptr(mkstr, mkstr_qty, r);
+ast_t* parser_ast_ternary(compiler_ctx_t *ctx, ctype_t *ctype, ast_t *cond, ast_t *then, ast_t *els) {
+    ast_t *r = parser_ast_alloc(ctx);
     r->type = AST_TERNARY;
     r->ctype = ctype;
     r->cond = cond;
@@ -205,9 +201,8 @@ ast_t* parser_ast_ternary(ctype_t *ctype, ast_t *cond, ast_t *then, ast_t *els)
     return r;
 }
 
-ast_t* parser_ast_for(ast_t *init, ast_t *cond, ast_t *step, ast_t *body) {
-    ast_t *r = malloc(sizeof(ast_t));
-    add_str_ptr(mkstr, mkstr_qty, r);
+ast_t* parser_ast_for(compiler_ctx_t *ctx, ast_t *init, ast_t *cond, ast_t *step, ast_t *body) {
+    ast_t *r = parser_ast_alloc(ctx);
     r->type = AST_FOR;
     r->ctype = NULL;
     r->forinit = init;
@@ -217,27 +212,24 @@ ast_t* parser_ast_for(ast_t *init, ast_t *cond, ast_t *step, ast_t *body) {
     return r;
 }
 
-ast_t* parser_ast_return(ast_t *retval) {
-    ast_t *r = malloc(sizeof(ast_t));
-    add_str_ptr(mkstr, mkstr_qty, r);
+ast_t* parser_ast_return(compiler_ctx_t *ctx, ast_t *retval) {
+    ast_t *r = parser_ast_alloc(ctx);
     r->type = AST_RETURN;
     r->ctype = NULL;
     r->retval = retval;
     return r;
 }
 
-ast_t* parser_ast_compound_stmt(list_t *stmts) {
-    ast_t *r = malloc(sizeof(ast_t));
-    add_str_ptr(mkstr, mkstr_qty, r);
+ast_t* parser_ast_compound_stmt(compiler_ctx_t *ctx, list_t *stmts) {
+    ast_t *r = parser_ast_alloc(ctx);
     r->type = AST_COMPOUND_STMT;
     r->ctype = NULL;
     r->stmts = stmts;
     return r;
 }
 
-ast_t* parser_ast_struct_ref(ctype_t *ctype, ast_t *struc, char *name) {
-    ast_t *r = malloc(sizeof(ast_t));
-    add_str_ptr(mkstr, mkstr_qty, r);
+ast_t* parser_ast_struct_ref(compiler_ctx_t *ctx, ctype_t *ctype, ast_t *struc, char *name) {
+    ast_t *r = parser_ast_alloc(ctx);
     r->type = AST_STRUCT_REF;
     r->ctype = ctype;
     r->struc = struc;
@@ -246,42 +238,34 @@ ast_t* parser_ast_struct_ref(ctype_t *ctype, ast_t *struc, char *name) {
 }
 
 ctype_t* parser_make_ptr_type(ctype_t *ctype) {
-    ctype_t *r = malloc(sizeof(ctype_t));
-    add_str_ptr(mkstr, mkstr_qty, r);
+    ctype_t *r = util_alloc(sizeof(ctype_t));
     r->type = CTYPE_PTR;
     r->ptr = ctype;
     r->size = 8;
-    list_push(ctypes, r);
     return r;
 }
 
 ctype_t* parser_make_array_type(ctype_t *ctype, int len) {
-    ctype_t *r = malloc(sizeof(ctype_t));
-    add_str_ptr(mkstr, mkstr_qty, r);
+    ctype_t *r = util_alloc(sizeof(ctype_t));
     r->type = CTYPE_ARRAY;
     r->ptr = ctype;
     r->size = (len < 0) ? -1 : ctype->size * len;
     r->len = len;
-    list_push(ctypes, r);
     return r;
 }
 
 ctype_t* parser_make_struct_field_type(ctype_t *ctype, int offset) {
-    ctype_t *r = malloc(sizeof(ctype_t));
-    add_str_ptr(mkstr, mkstr_qty, r);
+    ctype_t *r = util_alloc(sizeof(ctype_t));
     memcpy(r, ctype, sizeof(ctype_t));
     r->offset = offset;
-    list_push(ctypes, r);
     return r;
 }
 
 ctype_t* parser_make_struct_type(dict_t *fields, int size) {
-    ctype_t *r = malloc(sizeof(ctype_t));
-    add_str_ptr(mkstr, mkstr_qty, r);
+    ctype_t *r = util_alloc(sizeof(ctype_t));
     r->type = CTYPE_STRUCT;
     r->fields = fields;
     r->size = size;
-    list_push(ctypes, r);
     return r;
 }
 
@@ -301,7 +285,7 @@ bool parser_is_flotype(ctype_t *ctype) {
 #endif
 }
 
-void parser_ensure_lvalue(ast_t *ast) {
+void parser_ensure_lvalue(compiler_ctx_t *ctx, ast_t *ast) {
     switch (ast->type) {
         case AST_LVAR:
         case AST_GVAR:
@@ -309,49 +293,29 @@ void parser_ensure_lvalue(ast_t *ast) {
         case AST_STRUCT_REF:
             return;
         default:
-            util_error("lvalue expected, but got %s", verbose_ast_to_string(ast, true));
+            util_error("lvalue expected, but got %s", verbose_ast_to_string(ctx, ast, true));
     }
 }
 
-void parser_expect(char punct) {
-    token_t tok = lexer_read_token();
+void parser_expect(compiler_ctx_t *ctx, char punct) {
+    token_t tok = lexer_read_token(ctx);
     if (!lexer_is_punct(tok, punct))
-        util_error("'%c' expected, but got %s", punct, verbose_token_to_string(tok));
+        util_error("'%c' expected, but got %s", punct, verbose_token_to_string(ctx, tok));
 }
 
-bool parser_is_ident(const token_t tok, char *s) {
-    return get_ttype(tok) == TTYPE_IDENT && !strcmp(get_ident(tok), s);
+bool parser_is_keyword(const token_t tok, int kw) {
+    return get_ttype(tok) == TTYPE_KEYWORD && get_keyword(tok) == kw;
 }
 
 bool parser_is_right_assoc(const token_t tok) {
     return get_punct(tok) == '=';
 }
 
-int parser_eval_intexpr(ast_t *ast) {
-    switch (ast->type) {
-        case AST_LITERAL:
-            if (parser_is_inttype(ast->ctype))
-                return ast->ival;
-            util_error("Integer expression expected, but got %s", verbose_ast_to_string(ast, true));
-            break;
-        case '+':
-            return parser_eval_intexpr(ast->left) + parser_eval_intexpr(ast->right);
-        case '-':
-            return parser_eval_intexpr(ast->left) - parser_eval_intexpr(ast->right);
-        case '*':
-            return parser_eval_intexpr(ast->left) * parser_eval_intexpr(ast->right);
-        case '/':
-            return parser_eval_intexpr(ast->left) / parser_eval_intexpr(ast->right);
-        case PUNCT_LSHIFT:
-            return parser_eval_intexpr(ast->left) << parser_eval_intexpr(ast->right);
-        case PUNCT_RSHIFT:
-            return parser_eval_intexpr(ast->left) >> parser_eval_intexpr(ast->right);
-        default:
-            util_error("Integer expression expected, but got %s", verbose_ast_to_string(ast, true));
-            return 0; /* non-reachable */
-    }
-
-    return 0;
+int parser_eval_intexpr(compiler_ctx_t *ctx, ast_t *ast) {
+    ast_t *r = fold_ast(ctx, ast);
+    if (r->type != AST_LITERAL || !parser_is_inttype(r->ctype))
+        util_error("Integer expression expected, but got %s", verbose_ast_to_string(ctx, ast, true));
+    return r->ival;
 }
 
 int parser_priority(const token_t tok) {
@@ -394,31 +358,31 @@ int parser_priority(const token_t tok) {
     }
 }
 
-ast_t* parser_read_func_args(char *fname) {
+ast_t* parser_read_func_args(compiler_ctx_t *ctx, char *fname) {
     list_t *args = list_make();
     while (1) {
-        token_t tok = lexer_read_token();
+        token_t tok = lexer_read_token(ctx);
         if (lexer_is_punct(tok, ')'))
             break;
-        lexer_unget_token(tok);
-        list_push(args, parser_read_expr());
-        tok = lexer_read_token();
+        lexer_unget_token(ctx, tok);
+        list_push(args, parser_read_expr(ctx));
+        tok = lexer_read_token(ctx);
         if (lexer_is_punct(tok, ')'))
             break;
         if (!lexer_is_punct(tok, ','))
-            util_error("Unexpected token: '%s'", verbose_token_to_string(tok));
+            util_error("Unexpected token: '%s'", verbose_token_to_string(ctx, tok));
     }
     if (MAX_ARGS < list_len(args))
         util_error("Too many arguments: %s", fname);
-    return parser_ast_funcall(ctype_int, fname, args);
+    return parser_ast_funcall(ctx, ctype_int, fname, args);
 }
 
-ast_t* parser_read_ident_or_func(char *name) {
-    token_t tok = lexer_read_token();
+ast_t* parser_read_ident_or_func(compiler_ctx_t *ctx, char *name) {
+    token_t tok = lexer_read_token(ctx);
     if (lexer_is_punct(tok, '('))
-        return parser_read_func_args(name);
-    lexer_unget_token(tok);
-    ast_t *v = dict_get(localenv, name);
+        return parser_read_func_args(ctx, name);
+    lexer_unget_token(ctx, tok);
+    ast_t *v = symtab_get(ctx->parser.env, name);
     if (!v)
         util_error("Undefined varaible: %s", name);
     return v;
@@ -451,48 +415,55 @@ bool parser_is_float_token(char *p) {
     return true;
 }
 
-ast_t* parser_read_prim(void) {
-    token_t tok = lexer_read_token();
+ast_t* parser_read_prim(compiler_ctx_t *ctx) {
+    token_t tok = lexer_read_token(ctx);
     switch (get_ttype(tok)) {
         case TTYPE_NULL:
             return NULL;
         case TTYPE_IDENT:
-            return parser_read_ident_or_func(get_ident(tok));
+            return parser_read_ident_or_func(ctx, get_ident(tok));
         case TTYPE_NUMBER: {
-            char *number = get_number(tok);
+            char buf[LEXER_NUMBER_LEN];
+            char *number = lexer_token_cstring(ctx, tok, buf, sizeof(buf));
             if (parser_is_long_token(number))
 #ifdef ALLOW_LONG
-                return parser_ast_inttype(ctype_long, atol(number));
+                return parser_ast_inttype(ctx, ctype_long, atol(number));
 #else
-                return parser_ast_inttype(ctype_int, atoi(number));
+                return parser_ast_inttype(ctx, ctype_int, atoi(number));
 #endif
             if (parser_is_int_token(number)) {
 #ifdef ALLOW_LONG
                 long val = atol(number);
                 if (val & ~(long) UINT_MAX)
-                    return parser_ast_inttype(ctype_long, val);
+                    return parser_ast_inttype(ctx, ctype_long, val);
 #else
                 int val = atoi(number);
                 if (val & ~(int) UINT_MAX)
-                    return parser_ast_inttype(ctype_int, val);
+                    return parser_ast_inttype(ctx, ctype_int, val);
 #endif
-                return parser_ast_inttype(ctype_int, val);
+                return parser_ast_inttype(ctx, ctype_int, val);
             }
             if (parser_is_float_token(number))
-                return parser_ast_double(atof(number));
-            util_error("Malformed number: %s", verbose_token_to_string(tok));
+                return parser_ast_double(ctx, atof(number));
+            util_error("Malformed number: %s", verbose_token_to_string(ctx, tok));
         }
         break;
         case TTYPE_CHAR:
-            return parser_ast_inttype(ctype_char, get_char(tok));
+            return parser_ast_inttype(ctx, ctype_char, get_char(tok));
         case TTYPE_STRING: {
-            ast_t *r = parser_ast_string(get_strtok(tok));
-            list_push(strings, r);
+            // the literals are written with the data section, after the function may be freed
+            arena_t *arena = util_set_arena(util_arena_root());
+            ast_t *r = parser_ast_string(ctx, intern_cstring(ctx, get_strtok(ctx, tok)));
+            list_push(ctx->parser.strings, r);
+            util_set_arena(arena);
             return r;
         }
         case TTYPE_PUNCT:
-            lexer_unget_token(tok);
+            lexer_unget_token(ctx, tok);
             return NULL;
+        case TTYPE_KEYWORD:
+            util_error("Unexpected keyword: %s", verbose_token_to_string(ctx, tok));
+            return NULL; /* non-reachable */
         default:
             util_error("internal error: unknown token type: %d", get_ttype(tok));
             return NULL; /* non-reachable */
@@ -586,11 +557,11 @@ err:
     longjmp(*jmpbuf, 1);
 }
 
-ast_t* parser_read_subscript_expr(ast_t *ast) {
-    ast_t *sub = parser_read_expr();
-    parser_expect(']');
-    ast_t *t = parser_ast_binop('+', ast, sub);
-    return parser_ast_uop(AST_DEREF, t->ctype->ptr, t);
+ast_t* parser_read_subscript_expr(compiler_ctx_t *ctx, ast_t *ast) {
+    ast_t *sub = parser_read_expr(ctx);
+    parser_expect(ctx, ']');
+    ast_t *t = parser_ast_binop(ctx, '+', ast, sub);
+    return parser_ast_uop(ctx, AST_DEREF, t->ctype->ptr, t);
 }
 
 ctype_t* parser_convert_array(ctype_t *ctype) {
@@ -607,204 +578,208 @@ ctype_t* parser_result_type(char op, ctype_t *a, ctype_t *b) {
     return NULL; /* non-reachable */
 }
 
-ast_t* parser_read_unary_expr(void) {
-    token_t tok = lexer_read_token();
+ast_t* parser_read_unary_expr(compiler_ctx_t *ctx) {
+    token_t tok = lexer_read_token(ctx);
     if (get_ttype(tok) != TTYPE_PUNCT) {
-        lexer_unget_token(tok);
-        return parser_read_prim();
+        lexer_unget_token(ctx, tok);
+        return parser_read_prim(ctx);
     }
     if (lexer_is_punct(tok, PUNCT_INC)) {
-        ast_t *operand = parser_read_unary_expr();
-        return parser_ast_uop(PUNCT_PREINC, ctype_int, operand);
+        ast_t *operand = parser_read_unary_expr(ctx);
+        return parser_ast_uop(ctx, PUNCT_PREINC, ctype_int, operand);
     }
     if (lexer_is_punct(tok, PUNCT_DEC)) {
-        ast_t *operand = parser_read_unary_expr();
-        return parser_ast_uop(PUNCT_PREDEC, ctype_int, operand);
+        ast_t *operand = parser_read_unary_expr(ctx);
+        return parser_ast_uop(ctx, PUNCT_PREDEC, ctype_int, operand);
     }
     if (lexer_is_punct(tok, '(')) {
-        ast_t *r = parser_read_expr();
-        parser_expect(')');
+        ast_t *r = parser_read_expr(ctx);
+        parser_expect(ctx, ')');
         return r;
     }
     if (lexer_is_punct(tok, '&')) {
-        ast_t *operand = parser_read_unary_expr();
-        parser_ensure_lvalue(operand);
-        return parser_ast_uop(AST_ADDR, parser_make_ptr_type(operand->ctype), operand);
+        ast_t *operand = parser_read_unary_expr(ctx);
+        parser_ensure_lvalue(ctx, operand);
+        return parser_ast_uop(ctx, AST_ADDR, parser_make_ptr_type(operand->ctype), operand);
     }
     if (lexer_is_punct(tok, '!')) {
-        ast_t *operand = parser_read_unary_expr();
-        return parser_ast_uop('!', ctype_int, operand);
+        ast_t *operand = parser_read_unary_expr(ctx);
+        return parser_ast_uop(ctx, '!', ctype_int, operand);
     }
     if (lexer_is_punct(tok, '*')) {
-        ast_t *operand = parser_read_unary_expr();
+        ast_t *operand = parser_read_unary_expr(ctx);
         ctype_t *ctype = parser_convert_array(operand->ctype);
         if (ctype->type != CTYPE_PTR)
-            util_error("pointer type expected, but got %s", verbose_ast_to_string(operand, true));
+            util_error("pointer type expected, but got %s", verbose_ast_to_string(ctx, operand, true));
         if (ctype->ptr == ctype_void)
-            util_error("pointer to void can not be dereferenced, but got %s", verbose_ast_to_string(operand, true));
-        return parser_ast_uop(AST_DEREF, operand->ctype->ptr, operand);
+            util_error("pointer to void can not be dereferenced, but got %s", verbose_ast_to_string(ctx, operand, true));
+        return parser_ast_uop(ctx, AST_DEREF, operand->ctype->ptr, operand);
     }
-    lexer_unget_token(tok);
-    return parser_read_prim();
+    lexer_unget_token(ctx, tok);
+    return parser_read_prim(ctx);
 }
 
-ast_t* parser_read_cond_expr(ast_t *cond) {
-    ast_t *then = parser_read_expr();
-    parser_expect(':');
-    ast_t *els = parser_read_expr();
-    return parser_ast_ternary(then->ctype, cond, then, els);
+ast_t* parser_read_cond_expr(compiler_ctx_t *ctx, ast_t *cond) {
+    ast_t *then = parser_read_expr(ctx);
+    parser_expect(ctx, ':');
+    ast_t *els = parser_read_expr(ctx);
+    return parser_ast_ternary(ctx, then->ctype, cond, then, els);
 }
 
-ast_t* parser_read_struct_field(ast_t *struc) {
+ast_t* parser_read_struct_field(compiler_ctx_t *ctx, ast_t *struc) {
     if (struc->ctype->type != CTYPE_STRUCT)
-        util_error("struct expected, but got %s", verbose_ast_to_string(struc, true));
-    token_t name = lexer_read_token();
+        util_error("struct expected, but got %s", verbose_ast_to_string(ctx, struc, true));
+    token_t name = lexer_read_token(ctx);
     if (get_ttype(name) != TTYPE_IDENT)
-        util_error("field name expected, but got %s", verbose_token_to_string(name));
+        util_error("field name expected, but got %s", verbose_token_to_string(ctx, name));
     char *ident = get_ident(name);
     ctype_t *field = dict_get(struc->ctype->fields, ident);
-    return parser_ast_struct_ref(field, struc, ident);
+    return parser_ast_struct_ref(ctx, field, struc, ident);
 }
 
-ast_t* parser_read_expr_int(int prec) {
-    ast_t *ast = parser_read_unary_expr();
+ast_t* parser_read_expr_int(compiler_ctx_t *ctx, int prec) {
+    ast_t *ast = parser_read_unary_expr(ctx);
     if (!ast)
         return NULL;
     while (1) {
-        token_t tok = lexer_read_token();
+        token_t tok = lexer_read_token(ctx);
         if (get_ttype(tok) != TTYPE_PUNCT) {
-            lexer_unget_token(tok);
+            lexer_unget_token(ctx, tok);
             return ast;
         }
         int prec2 = parser_priority(tok);
         if (prec2 < 0 || prec <= prec2) {
-            lexer_unget_token(tok);
+            lexer_unget_token(ctx, tok);
             return ast;
         }
         if (lexer_is_punct(tok, '?')) {
-            ast = parser_read_cond_expr(ast);
+            ast = parser_read_cond_expr(ctx, ast);
             continue;
         }
         if (lexer_is_punct(tok, '.')) {
-            ast = parser_read_struct_field(ast);
+            ast = parser_read_struct_field(ctx, ast);
             continue;
         }
         if (lexer_is_punct(tok, PUNCT_ARROW)) {
             if (ast->ctype->type != CTYPE_PTR)
-                util_error("pointer type expected, but got %s %s", verbose_ctype_to_string(ast->ctype), verbose_ast_to_string(ast, true));
-            ast = parser_ast_uop(AST_DEREF, ast->ctype->ptr, ast);
-            ast = parser_read_struct_field(ast);
+                util_error("pointer type expected, but got %s %s", verbose_ctype_to_string(ast->ctype), verbose_ast_to_string(ctx, ast, true));
+            ast = parser_ast_uop(ctx, AST_DEREF, ast->ctype->ptr, ast);
+            ast = parser_read_struct_field(ctx, ast);
             continue;
         }
         if (lexer_is_punct(tok, '[')) {
-            ast = parser_read_subscript_expr(ast);
+            ast = parser_read_subscript_expr(ctx, ast);
             continue;
         }
         if (lexer_is_punct(tok, PUNCT_INC) || lexer_is_punct(tok, PUNCT_DEC)) {
-            parser_ensure_lvalue(ast);
+            parser_ensure_lvalue(ctx, ast);
             if (lexer_is_punct(tok, PUNCT_INC))
-                ast = parser_ast_uop(PUNCT_POSTINC, ast->ctype, ast);
+                ast = parser_ast_uop(ctx, PUNCT_POSTINC, ast->ctype, ast);
             else
-                ast = parser_ast_uop(PUNCT_POSTDEC, ast->ctype, ast);
+                ast = parser_ast_uop(ctx, PUNCT_POSTDEC, ast->ctype, ast);
             continue;
         }
         if (lexer_is_punct(tok, '='))
-            parser_ensure_lvalue(ast);
-        ast_t *rest = parser_read_expr_int(prec2 + (parser_is_right_assoc(tok) ? 1 : 0));
+            parser_ensure_lvalue(ctx, ast);
+        ast_t *rest = parser_read_expr_int(ctx, prec2 + (parser_is_right_assoc(tok) ? 1 : 0));
         if (!rest)
             util_error("second operand missing");
         if (lexer_is_punct(tok, PUNCT_LSHIFT) || lexer_is_punct(tok, PUNCT_RSHIFT)) {
             if ((ast->ctype != ctype_int && ast->ctype != ctype_char) || (rest->ctype != ctype_int && rest->ctype != ctype_char))
                 util_error("invalid operand to shift");
         }
-        ast = parser_ast_binop(get_punct(tok), ast, rest);
+        ast = parser_ast_binop(ctx, get_punct(tok), ast, rest);
     }
 }
 
-ast_t* parser_read_expr(void) {
-    return parser_read_expr_int(MAX_OP_PRIO);
+ast_t* parser_read_expr(compiler_ctx_t *ctx) {
+    return parser_read_expr_int(ctx, MAX_OP_PRIO);
 }
 
 ctype_t* parser_get_ctype(const token_t tok) {
-    if (get_ttype(tok) != TTYPE_IDENT)
+    if (get_ttype(tok) != TTYPE_KEYWORD)
         return NULL;
-    char *ident = get_ident(tok);
-    if (!strcmp(ident, "void"))
-        return ctype_void;
-    if (!strcmp(ident, "int"))
-        return ctype_int;
-    if (!strcmp(ident, "uint"))
-        return ctype_uint;
+    switch (get_keyword(tok)) {
+        case KW_VOID:
+            return ctype_void;
+        case KW_INT:
+            return ctype_int;
+        case KW_UINT:
+            return ctype_uint;
 #ifdef ALLOW_LONG
-    if (!strcmp(ident, "long"))
-        return ctype_long;
+        case KW_LONG:
+            return ctype_long;
 #endif
-    if (!strcmp(ident, "char"))
-        return ctype_char;
-    if (!strcmp(ident, "float"))
-        return ctype_float;
+        case KW_CHAR:
+            return ctype_char;
+        case KW_FLOAT:
+            return ctype_float;
 #ifdef ALLOW_DOUBLE
-    if (!strcmp(ident, "double"))
-        return ctype_double;
+        case KW_DOUBLE:
+            return ctype_double;
 #endif
-    return NULL;
+        default:
+            return NULL;
+    }
 }
 
 bool parser_is_type_keyword(const token_t tok) {
-    return parser_get_ctype(tok) || parser_is_ident(tok, "struct") || parser_is_ident(tok, "union");
+    return parser_get_ctype(tok) || parser_is_keyword(tok, KW_STRUCT) || parser_is_keyword(tok, KW_UNION);
 }
 
-ast_t* parser_read_decl_array_init_int(ctype_t *ctype) {
-    token_t tok = lexer_read_token();
+ast_t* parser_read_decl_array_init_int(compiler_ctx_t *ctx, ctype_t *ctype) {
+    token_t tok = lexer_read_token(ctx);
     if (ctype->ptr->type == CTYPE_CHAR && get_ttype(tok) == TTYPE_STRING)
-        return parser_ast_string(get_strtok(tok));
+        return parser_ast_string(ctx, get_strtok(ctx, tok));
     if (!lexer_is_punct(tok, '{'))
-        util_error("Expected an initializer list for %s, but got %s", verbose_ctype_to_string(ctype), verbose_token_to_string(tok));
+        util_error("Expected an initializer list for %s, but got %s", verbose_ctype_to_string(ctype), verbose_token_to_string(ctx, tok));
     list_t *initlist = list_make();
     while (1) {
-        token_t tok = lexer_read_token();
+        token_t tok = lexer_read_token(ctx);
         if (lexer_is_punct(tok, '}'))
             break;
-        lexer_unget_token(tok);
-        ast_t *init = parser_read_expr();
+        lexer_unget_token(ctx, tok);
+        ast_t *init = parser_read_expr(ctx);
         list_push(initlist, init);
         parser_result_type('=', init->ctype, ctype->ptr);
-        tok = lexer_read_token();
+        tok = lexer_read_token(ctx);
         if (!lexer_is_punct(tok, ','))
-            lexer_unget_token(tok);
+            lexer_unget_token(ctx, tok);
     }
-    return parser_ast_array_init(initlist);
+    return parser_ast_array_init(ctx, initlist);
 }
 
-char* parser_read_struct_union_tag(void) {
-    token_t tok = lexer_read_token();
+char* parser_read_struct_union_tag(compiler_ctx_t *ctx) {
+    token_t tok = lexer_read_token(ctx);
     if (get_ttype(tok) == TTYPE_IDENT)
         return get_ident(tok);
-    lexer_unget_token(tok);
+    lexer_unget_token(ctx, tok);
     return NULL;
 }
 
-dict_t* parser_read_struct_union_fields(void) {
+dict_t* parser_read_struct_union_fields(compiler_ctx_t *ctx) {
     dict_t *r = dict_make(NULL);
-    parser_expect('{');
+    parser_expect(ctx, '{');
     while (1) {
-        if (!parser_is_type_keyword(lexer_peek_token()))
+        if (!parser_is_type_keyword(lexer_peek_token(ctx)))
             break;
         token_t name;
-        ctype_t *fieldtype = parser_read_decl_int(&name);
+        ctype_t *fieldtype = parser_read_decl_int(ctx, &name);
         dict_put(r, get_ident(name), parser_make_struct_field_type(fieldtype, 0));
-        parser_expect(';');
+        parser_expect(ctx, ';');
     }
-    parser_expect('}');
+    parser_expect(ctx, '}');
     return r;
 }
 
-ctype_t* parser_read_union_def(void) {
-    char *tag = parser_read_struct_union_tag();
-    ctype_t *ctype = dict_get(union_defs, tag);
+ctype_t* parser_read_union_def(compiler_ctx_t *ctx) {
+    char *tag = parser_read_struct_union_tag(ctx);
+    ctype_t *ctype = symtab_get(ctx->parser.union_defs, tag);
     if (ctype)
         return ctype;
-    dict_t *fields = parser_read_struct_union_fields();
+    // the tags are not scoped, a definition in a function outlives it
+    arena_t *arena = util_set_arena(util_arena_root());
+    dict_t *fields = parser_read_struct_union_fields(ctx);
     int maxsize = 0;
     for (iter_t i = list_iter(dict_values(fields)); !list_iter_end(i);) {
         ctype_t *fieldtype = list_iter_next(&i);
@@ -812,16 +787,18 @@ ctype_t* parser_read_union_def(void) {
     }
     ctype_t *r = parser_make_struct_type(fields, maxsize);
     if (tag)
-        dict_put(union_defs, tag, r);
+        symtab_put(ctx->parser.union_defs, tag, r);
+    util_set_arena(arena);
     return r;
 }
 
-ctype_t* parser_read_struct_def(void) {
-    char *tag = parser_read_struct_union_tag();
-    ctype_t *ctype = dict_get(struct_defs, tag);
+ctype_t* parser_read_struct_def(compiler_ctx_t *ctx) {
+    char *tag = parser_read_struct_union_tag(ctx);
+    ctype_t *ctype = symtab_get(ctx->parser.struct_defs, tag);
     if (ctype)
         return ctype;
-    dict_t *fields = parser_read_struct_union_fields();
+    arena_t *arena = util_set_arena(util_arena_root());
+    dict_t *fields = parser_read_struct_union_fields(ctx);
     int offset = 0;
     for (iter_t i = list_iter(dict_values(fields)); !list_iter_end(i);) {
         ctype_t *fieldtype = list_iter_next(&i);
@@ -833,28 +810,29 @@ ctype_t* parser_read_struct_def(void) {
     }
     ctype_t *r = parser_make_struct_type(fields, offset);
     if (tag)
-        dict_put(struct_defs, tag, r);
+        symtab_put(ctx->parser.struct_defs, tag, r);
+    util_set_arena(arena);
     return r;
 }
 
-ctype_t* parser_read_decl_spec(void) {
-    token_t tok = lexer_read_token();
-    ctype_t *ctype = parser_is_ident(tok, "struct") ? parser_read_struct_def() : parser_is_ident(tok, "union") ? parser_read_union_def() : parser_get_ctype(tok);
+ctype_t* parser_read_decl_spec(compiler_ctx_t *ctx) {
+    token_t tok = lexer_read_token(ctx);
+    ctype_t *ctype = parser_is_keyword(tok, KW_STRUCT) ? parser_read_struct_def(ctx) : parser_is_keyword(tok, KW_UNION) ? parser_read_union_def(ctx) : parser_get_ctype(tok);
     if (!ctype)
-        util_error("Type expected, but got %s", verbose_token_to_string(tok));
+        util_error("Type expected, but got %s", verbose_token_to_string(ctx, tok));
     while (1) {
-        tok = lexer_read_token();
+        tok = lexer_read_token(ctx);
         if (!lexer_is_punct(tok, '*')) {
-            lexer_unget_token(tok);
+            lexer_unget_token(ctx, tok);
             return ctype;
         }
         ctype = parser_make_ptr_type(ctype);
     }
 }
 
-ast_t* parser_read_decl_init_val(ast_t *var) {
+ast_t* parser_read_decl_init_val(compiler_ctx_t *ctx, ast_t *var) {
     if (var->ctype->type == CTYPE_ARRAY) {
-        ast_t *init = parser_read_decl_array_init_int(var->ctype);
+        ast_t *init = parser_read_decl_array_init_int(ctx, var->ctype);
         int len = (init->type == AST_STRING) ? strlen(init->sval) + 1 : list_len(init->arrayinit);
         if (var->ctype->len == -1) {
             var->ctype->len = len;
@@ -862,29 +840,29 @@ ast_t* parser_read_decl_init_val(ast_t *var) {
         } else if (var->ctype->len != len) {
             util_error("Invalid array initializer: expected %d items but got %d", var->ctype->len, len);
         }
-        parser_expect(';');
-        return parser_ast_decl(var, init);
+        parser_expect(ctx, ';');
+        return parser_ast_decl(ctx, var, init);
     }
-    ast_t *init = parser_read_expr();
-    parser_expect(';');
+    ast_t *init = parser_read_expr(ctx);
+    parser_expect(ctx, ';');
     if (var->type == AST_GVAR)
-        init = parser_ast_inttype(ctype_int, parser_eval_intexpr(init));
-    return parser_ast_decl(var, init);
+        init = parser_ast_inttype(ctx, ctype_int, parser_eval_intexpr(ctx, init));
+    return parser_ast_decl(ctx, var, init);
 }
 
-ctype_t* parser_read_array_dimensions_int(ctype_t *basetype) {
-    token_t tok = lexer_read_token();
+ctype_t* parser_read_array_dimensions_int(compiler_ctx_t *ctx, ctype_t *basetype) {
+    token_t tok = lexer_read_token(ctx);
     if (!lexer_is_punct(tok, '[')) {
-        lexer_unget_token(tok);
+        lexer_unget_token(ctx, tok);
         return NULL;
     }
     int dim = -1;
-    if (!lexer_is_punct(lexer_peek_token(), ']')) {
-        ast_t *size = parser_read_expr();
-        dim = parser_eval_intexpr(size);
+    if (!lexer_is_punct(lexer_peek_token(ctx), ']')) {
+        ast_t *size = parser_read_expr(ctx);
+        dim = parser_eval_intexpr(ctx, size);
     }
-    parser_expect(']');
-    ctype_t *sub = parser_read_array_dimensions_int(basetype);
+    parser_expect(ctx, ']');
+    ctype_t *sub = parser_read_array_dimensions_int(ctx, basetype);
     if (sub) {
         if (sub->len == -1 && dim == -1)
             util_error("Array size is not specified");
@@ -893,205 +871,221 @@ ctype_t* parser_read_array_dimensions_int(ctype_t *basetype) {
     return parser_make_array_type(basetype, dim);
 }
 
-ctype_t* parser_read_array_dimensions(ctype_t *basetype) {
-    ctype_t *ctype = parser_read_array_dimensions_int(basetype);
+ctype_t* parser_read_array_dimensions(compiler_ctx_t *ctx, ctype_t *basetype) {
+    ctype_t *ctype = parser_read_array_dimensions_int(ctx, basetype);
     return ctype ? ctype : basetype;
 }
 
-ast_t* parser_read_decl_init(ast_t *var) {
-    token_t tok = lexer_read_token();
+ast_t* parser_read_decl_init(compiler_ctx_t *ctx, ast_t *var) {
+    token_t tok = lexer_read_token(ctx);
     if (lexer_is_punct(tok, '='))
-        return parser_read_decl_init_val(var);
+        return parser_read_decl_init_val(ctx, var);
     if (var->ctype->len == -1)
         util_error("Missing array initializer");
-    lexer_unget_token(tok);
-    parser_expect(';');
-    return parser_ast_decl(var, NULL);
+    lexer_unget_token(ctx, tok);
+    parser_expect(ctx, ';');
+    return parser_ast_decl(ctx, var, NULL);
 }
 
-ctype_t* parser_read_decl_int(token_t *name) {
-    ctype_t *ctype = parser_read_decl_spec();
-    *name = lexer_read_token();
+ctype_t* parser_read_decl_int(compiler_ctx_t *ctx, token_t *name) {
+    ctype_t *ctype = parser_read_decl_spec(ctx);
+    *name = lexer_read_token(ctx);
     if (get_ttype((*name)) != TTYPE_IDENT)
-        util_error("Identifier expected, but got %s", verbose_token_to_string(*name));
-    return parser_read_array_dimensions(ctype);
+        util_error("Identifier expected, but got %s", verbose_token_to_string(ctx, *name));
+    return parser_read_array_dimensions(ctx, ctype);
 }
 
-ast_t* parser_read_decl(void) {
+ast_t* parser_read_decl(compiler_ctx_t *ctx) {
     token_t varname;
-    ctype_t *ctype = parser_read_decl_int(&varname);
+    ctype_t *ctype = parser_read_decl_int(ctx, &varname);
     if (ctype == ctype_void)
-        util_error("Storage size of '%s' is not known", verbose_token_to_string(varname));
-    ast_t *var = parser_ast_lvar(ctype, get_ident(varname));
-    return parser_read_decl_init(var);
-}
-
-ast_t* parser_read_if_stmt(void) {
-    parser_expect('(');
-    ast_t *cond = parser_read_expr();
-    parser_expect(')');
-    ast_t *then = parser_read_stmt();
-    token_t tok = lexer_read_token();
-    if (get_ttype(tok) != TTYPE_IDENT || strcmp(get_ident(tok), "else")) {
-        lexer_unget_token(tok);
-        return parser_ast_if(cond, then, NULL);
+        util_error("Storage size of '%s' is not known", verbose_token_to_string(ctx, varname));
+    ast_t *var = parser_ast_lvar(ctx, ctype, get_ident(varname));
+    return parser_read_decl_init(ctx, var);
+}
+
+ast_t* parser_read_if_stmt(compiler_ctx_t *ctx) {
+    parser_expect(ctx, '(');
+    ast_t *cond = parser_read_expr(ctx);
+    parser_expect(ctx, ')');
+    ast_t *then = parser_read_stmt(ctx);
+    token_t tok = lexer_read_token(ctx);
+    if (!parser_is_keyword(tok, KW_ELSE)) {
+        lexer_unget_token(ctx, tok);
+        return parser_ast_if(ctx, cond, then, NULL);
     }
-    ast_t *els = parser_read_stmt();
-    return parser_ast_if(cond, then, els);
+    ast_t *els = parser_read_stmt(ctx);
+    return parser_ast_if(ctx, cond, then, els);
 }
 
-ast_t* parser_read_opt_decl_or_stmt(void) {
-    token_t tok = lexer_read_token();
+ast_t* parser_read_opt_decl_or_stmt(compiler_ctx_t *ctx) {
+    token_t tok = lexer_read_token(ctx);
     if (lexer_is_punct(tok, ';'))
         return NULL;
-    lexer_unget_token(tok);
-    return parser_read_decl_or_stmt();
+    lexer_unget_token(ctx, tok);
+    return parser_read_decl_or_stmt(ctx);
 }
 
-ast_t* parser_read_opt_expr(void) {
-    token_t tok = lexer_read_token();
+ast_t* parser_read_opt_expr(compiler_ctx_t *ctx) {
+    token_t tok = lexer_read_token(ctx);
     if (lexer_is_punct(tok, ';'))
         return NULL;
-    lexer_unget_token(tok);
-    ast_t *r = parser_read_expr();
-    parser_expect(';');
+    lexer_unget_token(ctx, tok);
+    ast_t *r = parser_read_expr(ctx);
+    parser_expect(ctx, ';');
     return r;
 }
 
-ast_t* parser_read_for_stmt(void) {
-    parser_expect('(');
-    localenv = dict_make(localenv);
-    ast_t *init = parser_read_opt_decl_or_stmt();
-    ast_t *cond = parser_read_opt_expr();
-    ast_t *step = lexer_is_punct(lexer_peek_token(), ')') ? NULL : parser_read_expr();
-    parser_expect(')');
-    ast_t *body = parser_read_stmt();
-    localenv = dict_parent(localenv);
-    return parser_ast_for(init, cond, step, body);
-}
-
-ast_t* parser_read_return_stmt(void) {
-    ast_t *retval = parser_read_expr();
-    parser_expect(';');
-    return parser_ast_return(retval);
-}
-
-ast_t* parser_read_stmt(void) {
-    token_t tok = lexer_read_token();
-    if (parser_is_ident(tok, "if"))
-        return parser_read_if_stmt();
-    if (parser_is_ident(tok, "for"))
-        return parser_read_for_stmt();
-    if (parser_is_ident(tok, "return"))
-        return parser_read_return_stmt();
+ast_t* parser_read_for_stmt(compiler_ctx_t *ctx) {
+    parser_expect(ctx, '(');
+    parser_push_scope(ctx);
+    ast_t *init = parser_read_opt_decl_or_stmt(ctx);
+    ast_t *cond = parser_read_opt_expr(ctx);
+    ast_t *step = lexer_is_punct(lexer_peek_token(ctx), ')') ? NULL : parser_read_expr(ctx);
+    parser_expect(ctx, ')');
+    ast_t *body = parser_read_stmt(ctx);
+    symtab_pop(ctx->parser.env);
+    return parser_ast_for(ctx, init, cond, step, body);
+}
+
+ast_t* parser_read_return_stmt(compiler_ctx_t *ctx) {
+    ast_t *retval = parser_read_expr(ctx);
+    parser_expect(ctx, ';');
+    return parser_ast_return(ctx, retval);
+}
+
+ast_t* parser_read_stmt(compiler_ctx_t *ctx) {
+    token_t tok = lexer_read_token(ctx);
+    if (parser_is_keyword(tok, KW_IF))
+        return parser_read_if_stmt(ctx);
+    if (parser_is_keyword(tok, KW_FOR))
+        return parser_read_for_stmt(ctx);
+    if (parser_is_keyword(tok, KW_RETURN))
+        return parser_read_return_stmt(ctx);
     if (lexer_is_punct(tok, '{'))
-        return parser_read_compound_stmt();
-    lexer_unget_token(tok);
-    ast_t *r = parser_read_expr();
-    parser_expect(';');
+        return parser_read_compound_stmt(ctx);
+    lexer_unget_token(ctx, tok);
+    ast_t *r = parser_read_expr(ctx);
+    parser_expect(ctx, ';');
     return r;
 }
 
-ast_t* parser_read_decl_or_stmt(void) {
-    token_t tok = lexer_peek_token();
+ast_t* parser_read_decl_or_stmt(compiler_ctx_t *ctx) {
+    token_t tok = lexer_peek_token(ctx);
     if (get_ttype(tok) == TTYPE_NULL)
         return NULL;
-    return parser_is_type_keyword(tok) ? parser_read_decl() : parser_read_stmt();
+    return parser_is_type_keyword(tok) ? parser_read_decl(ctx) : parser_read_stmt(ctx);
 }
 
-ast_t* parser_read_compound_stmt(void) {
-    localenv = dict_make(localenv);
+ast_t* parser_read_compound_stmt(compiler_ctx_t *ctx) {
+    parser_push_scope(ctx);
     list_t *list = list_make();
     while (1) {
-        ast_t *stmt = parser_read_decl_or_stmt();
+        ast_t *stmt = parser_read_decl_or_stmt(ctx);
         if (stmt)
             list_push(list, stmt);
         if (!stmt)
             break;
-        token_t tok = lexer_read_token();
+        token_t tok = lexer_read_token(ctx);
         if (lexer_is_punct(tok, '}'))
             break;
-        lexer_unget_token(tok);
+        lexer_unget_token(ctx, tok);
     }
-    localenv = dict_parent(localenv);
-    return parser_ast_compound_stmt(list);
+    symtab_pop(ctx->parser.env);
+    return parser_ast_compound_stmt(ctx, list);
 }
 
-list_t* parser_read_params(void) {
+list_t* parser_read_params(compiler_ctx_t *ctx) {
     list_t *params = list_make();
-    token_t tok = lexer_read_token();
+    token_t tok = lexer_read_token(ctx);
     if (lexer_is_punct(tok, ')'))
         return params;
-    lexer_unget_token(tok);
+    lexer_unget_token(ctx, tok);
     while (1) {
-        ctype_t *ctype = parser_read_decl_spec();
-        token_t pname = lexer_read_token();
+        ctype_t *ctype = parser_read_decl_spec(ctx);
+        token_t pname = lexer_read_token(ctx);
         if (get_ttype(pname) != TTYPE_IDENT)
-            util_error("Identifier expected, but got %s", verbose_token_to_string(pname));
-        ctype = parser_read_array_dimensions(ctype);
+            util_error("Identifier expected, but got %s", verbose_token_to_string(ctx, pname));
+        ctype = parser_read_array_dimensions(ctx, ctype);
         if (ctype->type == CTYPE_ARRAY)
             ctype = parser_make_ptr_type(ctype->ptr);
-        list_push(params, parser_ast_lvar(ctype, get_ident(pname)));
-        token_t tok = lexer_read_token();
+        list_push(params, parser_ast_lvar(ctx, ctype, get_ident(pname)));
+        token_t tok = lexer_read_token(ctx);
         if (lexer_is_punct(tok, ')'))
             return params;
         if (!lexer_is_punct(tok, ','))
-            util_error("Comma expected, but got %s", verbose_token_to_string(tok));
+            util_error("Comma expected, but got %s", verbose_token_to_string(ctx, tok));
     }
 }
 
-ast_t* parser_read_func_def(ctype_t *rettype, char *fname) {
-    parser_expect('(');
-    localenv = dict_make(globalenv);
-    list_t *params = parser_read_params();
-    parser_expect('{');
-    localenv = dict_make(localenv);
-    localvars = list_make();
-    ast_t *body = parser_read_compound_stmt();
-    ast_t *r = parser_ast_func(rettype, fname, params, body, localvars);
-    localenv = dict_parent(localenv);
-    localenv = dict_parent(localenv);
-    localvars = NULL;
+ast_t* parser_read_func_def(compiler_ctx_t *ctx, ctype_t *rettype, char *fname) {
+    arena_t *arena = util_set_arena(arena_make(util_arena_root(), 0));
+    parser_expect(ctx, '(');
+    parser_push_scope(ctx);
+    list_t *params = parser_read_params(ctx);
+    parser_expect(ctx, '{');
+    parser_push_scope(ctx);
+    ctx->parser.localvars = list_make();
+    ast_t *body = parser_read_compound_stmt(ctx);
+    ast_t *r = fold_ast(ctx, parser_ast_func(ctx, rettype, fname, params, body, ctx->parser.localvars));
+    symtab_pop(ctx->parser.env);
+    symtab_pop(ctx->parser.env);
+    ctx->parser.localvars = NULL;
+    r->arena = util_set_arena(arena);
     return r;
 }
 
-ast_t* parser_read_decl_or_func_def(void) {
-    token_t tok = lexer_peek_token();
+void parser_func_free(ast_t *func) {
+    arena_release(func->arena);
+}
+
+ast_t* parser_read_decl_or_func_def(compiler_ctx_t *ctx) {
+    token_t tok = lexer_peek_token(ctx);
     if (get_ttype(tok) == TTYPE_NULL)
         return NULL;
-    ctype_t *ctype = parser_read_decl_spec();
-    token_t name = lexer_read_token();
+    ctype_t *ctype = parser_read_decl_spec(ctx);
+    token_t name = lexer_read_token(ctx);
     char *ident;
     if (get_ttype(name) != TTYPE_IDENT)
-        util_error("Identifier expected, but got %s", verbose_token_to_string(name));
+        util_error("Identifier expected, but got %s", verbose_token_to_string(ctx, name));
     ident = get_ident(name);
-    tok = lexer_peek_token();
+    tok = lexer_peek_token(ctx);
     if (lexer_is_punct(tok, '('))
-        return parser_read_func_def(ctype, ident);
+        return parser_read_func_def(ctx, ctype, ident);
     if (ctype == ctype_void)
-        util_error("Storage size of '%s' is not known", verbose_token_to_string(name));
-    ctype = parser_read_array_dimensions(ctype);
+        util_error("Storage size of '%s' is not known", verbose_token_to_string(ctx, name));
+    ctype = parser_read_array_dimensions(ctx, ctype);
     if (lexer_is_punct(tok, '=') || ctype->type == CTYPE_ARRAY) {
-        ast_t *var = parser_ast_gvar(ctype, ident, false);
-        return parser_read_decl_init(var);
+        ast_t *var = parser_ast_gvar(ctx, ctype, ident, false);
+        return parser_read_decl_init(ctx, var);
     }
     if (lexer_is_punct(tok, ';')) {
-        lexer_read_token();
-        ast_t *var = parser_ast_gvar(ctype, ident, false);
-        return parser_ast_decl(var, NULL);
+        lexer_read_token(ctx);
+        ast_t *var = parser_ast_gvar(ctx, ctype, ident, false);
+        return parser_ast_decl(ctx, var, NULL);
     }
-    util_error("Don't know how to handle %s", verbose_token_to_string(tok));
+    util_error("Don't know how to handle %s", verbose_token_to_string(ctx, tok));
     return NULL; /* non-reachable */
 }
 
-list_t* parser_read_toplevels(void) {
+void parser_open(compiler_ctx_t *ctx) {
+    ctx->parser.env = symtab_make();
+    ctx->parser.struct_defs = symtab_make();
+    ctx->parser.union_defs = symtab_make();
+}
+
+ast_t* parser_read_toplevel(compiler_ctx_t *ctx) {
+    unsigned long nodes = ctx->parser.nodes;
+    int span = trace_begin(ctx, "parse", NULL);
+    ast_t *ast = parser_read_decl_or_func_def(ctx);
+    trace_end(ctx, span, !ast ? "end of file" : ast->type == AST_FUNC ? ast->fname : ast->declvar->varname, "nodes", ctx->parser.nodes - nodes);
+    return ast;
+}
+
+list_t* parser_read_toplevels(compiler_ctx_t *ctx) {
     list_t *r = list_make();
-    while (1) {
-        ast_t *ast = parser_read_decl_or_func_def();
-        if (!ast)
-            return r;
+    parser_open(ctx);
+    for (ast_t *ast; (ast = parser_read_toplevel(ctx));)
         list_push(r, ast);
-    }
-    list_free(globalenv->list);
     return r;
 }
@@ -0,0 +1,421 @@
+/*
+ * @peephole.c
+ *
+ * @brief C for Stack VM
+ * @details
+ * This is based on other projects:
+ *   A minimalist C compiler with x86_64 code generation: https://github.com/jserv/MazuCC
+ *   Others (see individual files)
+ *
+ *   please contact their authors for more information.
+ *
+ * @author Emiliano Augusto Gonzalez (egonzalez . hiperion @ gmail . com)
+ * @date 2024
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/stackvm_c_compiler
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "c_stackvm.h"
+#include "context.h"
+#include "util.h"
+#include "peephole.h"
+
+#define OP_ANY      -1
+#define PEEPHOLE_SCAN 32 // how far back dup-drop looks for the dup
+
+/*
+ * Every instruction is appended to the output and the rules are tried on the
+ * tail of the output, so a rewrite can enable another one on the instructions
+ * already emitted. Replacements are never longer than their pattern, which
+ * lets the pass work in place. Passes repeat until nothing fires.
+ *
+ * A rule with len 0 has no fixed pattern: span() returns how many tail
+ * instructions it matched and the rewrite works directly on them.
+ */
+
+typedef struct {
+                 char *name;
+                  int len;
+                  int ops[PEEPHOLE_WINDOW];
+                 bool (*cond)(compiler_ctx_t *ctx, ir_insn_t *w);
+                  int (*span)(compiler_ctx_t *ctx, ir_insn_t *insns, int len);
+                  int (*rewrite)(compiler_ctx_t *ctx, ir_insn_t *w, int len, ir_insn_t *out);
+} peephole_rule_t;
+
+static bool peephole_is_pure_push(int op) {
+    return op == OP_PUSH || op == OP_DUP || op == OP_LEA || op == OP_GADDR || (op >= OP_LDL_I8 && op <= OP_LDL_F64);
+}
+
+static bool peephole_is_cond_jump(int op) {
+    return op == OP_JZ || op == OP_JNZ;
+}
+
+static int peephole_store_type(int op) {
+    switch (op) {
+        case OP_STL_I64:
+            return OP_LDL_I64;
+        case OP_STL_F64:
+            return OP_LDL_F64;
+        default:
+            // a stack cell is 64 bits wide, a narrower store truncates the value
+            // and the reload sign or zero extends it, so the reload is not a dup
+            return -1;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////
+
+// x drop ->
+static bool peephole_cond_push_drop(compiler_ctx_t *ctx, ir_insn_t *w) {
+    return peephole_is_pure_push(w[0].op);
+}
+
+static int peephole_empty(compiler_ctx_t *ctx, ir_insn_t *w, int len, ir_insn_t *out) {
+    return 0;
+}
+
+// dup <x> drop -> <x>, when <x> consumes the copy and does not reach the original
+static int peephole_span_dup_drop(compiler_ctx_t *ctx, ir_insn_t *insns, int len) {
+    if (insns[len - 1].op != OP_DROP)
+        return 0;
+    for (int start = len - 2; start >= 0 && start >= len - 1 - PEEPHOLE_SCAN; start--) {
+        int op = insns[start].op;
+        if (op == IR_LABEL || ir_is_branch(op))
+            return 0;
+        if (op != OP_DUP)
+            continue;
+        int depth = 0, low = 0;
+        for (int n = start + 1; n < len - 1; n++) {
+            const opcode_info_t *info = opcodes_info(insns[n].op);
+            depth -= (info->pop < 0) ? insns[n].nargs : info->pop;
+            if (depth < low)
+                low = depth;
+            depth += info->push;
+        }
+        if (depth == -1 && low >= -1)
+            return len - start;
+    }
+    return 0;
+}
+
+static int peephole_dup_drop(compiler_ctx_t *ctx, ir_insn_t *w, int len, ir_insn_t *out) {
+    memmove(out, w + 1, (len - 2) * sizeof(ir_insn_t));
+    return len - 2;
+}
+
+// stl n ldl n -> dup stl n
+static bool peephole_cond_store_reload(compiler_ctx_t *ctx, ir_insn_t *w) {
+    return w[0].ival == w[1].ival && peephole_store_type(w[0].op) == w[1].op;
+}
+
+static int peephole_store_reload(compiler_ctx_t *ctx, ir_insn_t *w, int len, ir_insn_t *out) {
+    memset(&out[0], 0, sizeof(ir_insn_t));
+    out[0].op = OP_DUP;
+    out[1] = w[0];
+    return 2;
+}
+
+// jmp L L: -> L:
+static bool peephole_cond_jump_next(compiler_ctx_t *ctx, ir_insn_t *w) {
+    return w[1].op == IR_LABEL && w[0].label == w[1].label;
+}
+
+// jz L L: -> drop L:
+static bool peephole_cond_branch_next(compiler_ctx_t *ctx, ir_insn_t *w) {
+    return peephole_is_cond_jump(w[0].op) && w[0].label == w[1].label;
+}
+
+static int peephole_branch_next(compiler_ctx_t *ctx, ir_insn_t *w, int len, ir_insn_t *out) {
+    ctx->peephole.label_refs[w[0].label]--;
+    memset(&out[0], 0, sizeof(ir_insn_t));
+    out[0].op = OP_DROP;
+    out[1] = w[1];
+    return 2;
+}
+
+// true if the store drops every bit that the extension ext changes
+static bool peephole_store_truncates(int ext, int op) {
+    switch (ext) {
+        case OP_U32:
+        case OP_SX_I32:
+            return op == OP_STL_I8 || op == OP_STL_I32;
+        case OP_SX_I8:
+            return op == OP_STL_I8;
+        default:
+            return false;
+    }
+}
+
+// u32 stl.i32 n -> stl.i32 n, the store truncates anyway
+static bool peephole_cond_ext_store(compiler_ctx_t *ctx, ir_insn_t *w) {
+    return peephole_store_truncates(w[0].op, w[1].op);
+}
+
+// u32 dup stl.i32 a stl.i32 b -> dup stl.i32 a stl.i32 b
+static bool peephole_cond_ext_dup_store(compiler_ctx_t *ctx, ir_insn_t *w) {
+    return peephole_store_truncates(w[0].op, w[2].op) && peephole_store_truncates(w[0].op, w[3].op);
+}
+
+static int peephole_drop_first(compiler_ctx_t *ctx, ir_insn_t *w, int len, ir_insn_t *out) {
+    for (int n = 1; n < len; n++)
+        out[n - 1] = w[n];
+    return len - 1;
+}
+
+// not not jz -> jz
+static bool peephole_cond_cond_jump(compiler_ctx_t *ctx, ir_insn_t *w) {
+    return peephole_is_cond_jump(w[2].op);
+}
+
+static int peephole_keep_third(compiler_ctx_t *ctx, ir_insn_t *w, int len, ir_insn_t *out) {
+    out[0] = w[2];
+    return 1;
+}
+
+// not jz -> jnz
+static bool peephole_cond_not_jump(compiler_ctx_t *ctx, ir_insn_t *w) {
+    return peephole_is_cond_jump(w[1].op);
+}
+
+static int peephole_not_jump(compiler_ctx_t *ctx, ir_insn_t *w, int len, ir_insn_t *out) {
+    out[0] = w[1];
+    out[0].op = (w[1].op == OP_JZ) ? OP_JNZ : OP_JZ;
+    return 1;
+}
+
+// push c jz L -> jmp L or nothing
+static bool peephole_cond_const_jump(compiler_ctx_t *ctx, ir_insn_t *w) {
+    return peephole_is_cond_jump(w[1].op);
+}
+
+static int peephole_const_jump(compiler_ctx_t *ctx, ir_insn_t *w, int len, ir_insn_t *out) {
+    bool taken = (w[1].op == OP_JZ) ? !w[0].ival : !!w[0].ival;
+    if (!taken) {
+        ctx->peephole.label_refs[w[1].label]--;
+        return 0;
+    }
+    out[0] = w[1];
+    out[0].op = OP_JMP;
+    return 1;
+}
+
+// push a push b op -> push (a op b)
+static bool peephole_cond_fold(compiler_ctx_t *ctx, ir_insn_t *w) {
+    switch (w[2].op) {
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_AND:
+        case OP_OR:
+        case OP_EQ:
+        case OP_LT:
+        case OP_GT:
+            return true;
+        case OP_SHL:
+        case OP_SHR:
+            return w[1].ival >= 0 && w[1].ival < 64;
+        default:
+            return false;
+    }
+}
+
+static int peephole_fold(compiler_ctx_t *ctx, ir_insn_t *w, int len, ir_insn_t *out) {
+    int64_t a = w[0].ival, b = w[1].ival, r = 0;
+    switch (w[2].op) {
+        case OP_ADD:
+            r = (uint64_t) a + (uint64_t) b;
+            break;
+        case OP_SUB:
+            r = (uint64_t) a - (uint64_t) b;
+            break;
+        case OP_MUL:
+            r = (uint64_t) a * (uint64_t) b;
+            break;
+        case OP_AND:
+            r = a & b;
+            break;
+        case OP_OR:
+            r = a | b;
+            break;
+        case OP_EQ:
+            r = a == b;
+            break;
+        case OP_LT:
+            r = a < b;
+            break;
+        case OP_GT:
+            r = a > b;
+            break;
+        case OP_SHL:
+            r = (uint64_t) a << b;
+            break;
+        case OP_SHR:
+            r = a >> b;
+            break;
+    }
+    out[0] = w[0];
+    out[0].ival = r;
+    return 1;
+}
+
+// push 0 add -> , push 1 mul ->
+static bool peephole_cond_identity(compiler_ctx_t *ctx, ir_insn_t *w) {
+    return (w[0].ival == 0 && (w[1].op == OP_ADD || w[1].op == OP_SUB || w[1].op == OP_OR)) || (w[0].ival == 1 && w[1].op == OP_MUL);
+}
+
+// lea a push b add -> lea a+b
+static int peephole_lea_offset(compiler_ctx_t *ctx, ir_insn_t *w, int len, ir_insn_t *out) {
+    out[0] = w[0];
+    out[0].ival += w[1].ival;
+    return 1;
+}
+
+// lea n ld -> ldl n, lea n st -> stl n
+static bool peephole_cond_lea_mem(compiler_ctx_t *ctx, ir_insn_t *w) {
+    return (w[1].op >= OP_LD_I8 && w[1].op <= OP_LD_F64) || (w[1].op >= OP_ST_I8 && w[1].op <= OP_ST_F64);
+}
+
+static int peephole_lea_mem(compiler_ctx_t *ctx, ir_insn_t *w, int len, ir_insn_t *out) {
+    out[0] = w[0];
+    if (w[1].op <= OP_LD_F64)
+        out[0].op = OP_LDL_I8 + (w[1].op - OP_LD_I8);
+    else
+        out[0].op = OP_STL_I8 + (w[1].op - OP_ST_I8);
+    return 1;
+}
+
+// ret x -> ret (up to the next label)
+static bool peephole_cond_dead(compiler_ctx_t *ctx, ir_insn_t *w) {
+    return (w[0].op == OP_RET || w[0].op == OP_JMP) && w[1].op != IR_LABEL;
+}
+
+static int peephole_dead(compiler_ctx_t *ctx, ir_insn_t *w, int len, ir_insn_t *out) {
+    if (opcodes_info(w[1].op)->operand == OPND_LABEL)
+        ctx->peephole.label_refs[w[1].label]--;
+    out[0] = w[0];
+    return 1;
+}
+
+// L: -> when nothing jumps to L
+static bool peephole_cond_unused_label(compiler_ctx_t *ctx, ir_insn_t *w) {
+    return ctx->peephole.label_refs[w[0].label] == 0;
+}
+
+static int peephole_jump_removed(compiler_ctx_t *ctx, ir_insn_t *w, int len, ir_insn_t *out) {
+    ctx->peephole.label_refs[w[0].label]--;
+    out[0] = w[1];
+    return 1;
+}
+
+static const peephole_rule_t rules[] = {
+        { "dup-drop",        0, { 0 },                               NULL,                         peephole_span_dup_drop, peephole_dup_drop },
+        { "push-drop",       2, { OP_ANY, OP_DROP },                 peephole_cond_push_drop,      NULL,                   peephole_empty },
+        { "store-reload",    2, { OP_ANY, OP_ANY },                  peephole_cond_store_reload,   NULL,                   peephole_store_reload },
+        { "ext-store",       2, { OP_ANY, OP_ANY },                  peephole_cond_ext_store,      NULL,                   peephole_drop_first },
+        { "ext-dup-store",   4, { OP_ANY, OP_DUP, OP_ANY, OP_ANY },  peephole_cond_ext_dup_store,  NULL,                   peephole_drop_first },
+        { "jump-next",       2, { OP_JMP, IR_LABEL },                peephole_cond_jump_next,      NULL,                   peephole_jump_removed },
+        { "branch-next",     2, { OP_ANY, IR_LABEL },                peephole_cond_branch_next,    NULL,                   peephole_branch_next },
+        { "not-not-branch",  3, { OP_NOT, OP_NOT, OP_ANY },          peephole_cond_cond_jump,      NULL,                   peephole_keep_third },
+        { "not-branch",      2, { OP_NOT, OP_ANY },                  peephole_cond_not_jump,       NULL,                   peephole_not_jump },
+        { "const-branch",    2, { OP_PUSH, OP_ANY },                 peephole_cond_const_jump,     NULL,                   peephole_const_jump },
+        { "const-fold",      3, { OP_PUSH, OP_PUSH, OP_ANY },        peephole_cond_fold,           NULL,                   peephole_fold },
+        { "identity",        2, { OP_PUSH, OP_ANY },                 peephole_cond_identity,       NULL,                   peephole_empty },
+        { "lea-offset",      3, { OP_LEA, OP_PUSH, OP_ADD },         NULL,                         NULL,                   peephole_lea_offset },
+        { "lea-mem",         2, { OP_LEA, OP_ANY },                  peephole_cond_lea_mem,        NULL,                   peephole_lea_mem },
+        { "dead-code",       2, { OP_ANY, OP_ANY },                  peephole_cond_dead,           NULL,                   peephole_dead },
+        { "unused-label",    1, { IR_LABEL },                        peephole_cond_unused_label,   NULL,                   peephole_empty },
+};
+
+#define PEEPHOLE_RULES (sizeof(rules) / sizeof(rules[0]))
+
+_Static_assert(PEEPHOLE_RULES <= PEEPHOLE_MAX_RULES, "PEEPHOLE_MAX_RULES is too small");
+
+static bool peephole_match(compiler_ctx_t *ctx, const peephole_rule_t *rule, ir_insn_t *w) {
+    for (int n = 0; n < rule->len; n++) {
+        if (rule->ops[n] == OP_ANY) {
+            if (w[n].op == IR_LABEL)
+                return false;
+        } else if (w[n].op != rule->ops[n]) {
+            return false;
+        }
+    }
+    return !rule->cond || rule->cond(ctx, w);
+}
+
+// try the rules on the tail of the output, returns true when one fired
+static bool peephole_tail(compiler_ctx_t *ctx, ir_insn_t *insns, int *out) {
+    ir_insn_t repl[PEEPHOLE_WINDOW];
+
+    for (int r = 0; r < PEEPHOLE_RULES; r++) {
+        const peephole_rule_t *rule = &rules[r];
+        if (ctx->peephole.disabled[r] || rule->len > *out || !*out)
+            continue;
+        if (rule->span) {
+            int len = rule->span(ctx, insns, *out);
+            if (!len)
+                continue;
+            *out += rule->rewrite(ctx, &insns[*out - len], len, &insns[*out - len]) - len;
+            ctx->peephole.fired[r]++;
+            return true;
+        }
+        ir_insn_t *w = &insns[*out - rule->len];
+        if (!peephole_match(ctx, rule, w))
+            continue;
+        int n = rule->rewrite(ctx, w, rule->len, repl);
+        memcpy(w, repl, n * sizeof(ir_insn_t));
+        *out += n - rule->len;
+        ctx->peephole.fired[r]++;
+        return true;
+    }
+    return false;
+}
+
+bool peephole_enable(compiler_ctx_t *ctx, const char *name, bool enable) {
+    bool found = false;
+    for (int r = 0; r < PEEPHOLE_RULES; r++) {
+        if (!name || !strcmp(rules[r].name, name)) {
+            ctx->peephole.disabled[r] = !enable;
+            found = true;
+        }
+    }
+    return found;
+}
+
+int peephole_run(compiler_ctx_t *ctx, ir_func_t *func) {
+    int total = 0, changed;
+
+    ctx->peephole.insns_before += func->len;
+    ctx->peephole.label_refs = util_heap(NULL, 0, (func->nlabels + 1) * sizeof(int));
+    memset(ctx->peephole.label_refs, 0, (func->nlabels + 1) * sizeof(int));
+
+    do {
+        memset(ctx->peephole.label_refs, 0, func->nlabels * sizeof(int));
+        for (int n = 0; n < func->len; n++)
+            if (opcodes_info(func->insns[n].op == IR_LABEL ? OP_NOP : func->insns[n].op)->operand == OPND_LABEL)
+                ctx->peephole.label_refs[func->insns[n].label]++;
+
+        int out = 0;
+        changed = 0;
+        for (int n = 0; n < func->len; n++) {
+            func->insns[out++] = func->insns[n];
+            while (peephole_tail(ctx, func->insns, &out))
+                changed++;
+        }
+        func->len = out;
+        total += changed;
+    } while (changed);
+
+    free(ctx->peephole.label_refs);
+    ctx->peephole.label_refs = NULL;
+    ctx->peephole.insns_after += func->len;
+    return total;
+}
+
+void peephole_stats(compiler_ctx_t *ctx, FILE *fp) {
+    fprintf(fp, "peephole: %lu -> %lu instructions\n", ctx->peephole.insns_before, ctx->peephole.insns_after);
+    for (int r = 0; r < PEEPHOLE_RULES; r++)
+        fprintf(fp, "  %-16s %8lu%s\n", rules[r].name, ctx->peephole.fired[r], ctx->peephole.disabled[r] ? " (disabled)" : "");
+}
@@ -16,29 +16,71 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
 
-static void preprocess_switch_to_if(FILE *file_in, FILE *file_out) {
+#include "util.h"
+#include "preprocess.h"
 
+static void preprocess_reserve(preprocess_buffer_t *buf, size_t size) {
+    if (buf->nalloc >= size)
+        return;
+    // the first size is exact, so a file of known size is allocated once
+    size_t nalloc = buf->nalloc ? buf->nalloc * 2 : size;
+    while (nalloc < size)
+        nalloc *= 2;
+    buf->body = util_heap(buf->body, buf->nalloc, nalloc);
+    buf->nalloc = nalloc;
 }
 
-static void preprocess_include(FILE *file_in, FILE *file_out) {
+static void preprocess_switch_to_if(preprocess_buffer_t *buf, size_t from) {
+
+}
+
+static void preprocess_include(preprocess_buffer_t *buf, size_t from) {
 
 }
 
 ///////////////////////////////////////////////////////////////////
 
-void preprocess_file(FILE *file_in, FILE *file_out) {
-    int c;
+void preprocess_file(FILE *file_in, preprocess_buffer_t *out) {
+    struct stat st;
 
-    preprocess_include(file_in, file_out);
-    preprocess_switch_to_if(file_in, file_out);
+    out->body = NULL;
+    out->len = out->nalloc = 0;
 
-    while ((c = fgetc(file_in)) != EOF) {
-        fputc(c, file_out);
-        printf("%c", c);
+    // regular files are read into a buffer of the right size, pipes grow it chunk by chunk
+    if (fstat(fileno(file_in), &st) == 0 && S_ISREG(st.st_mode))
+        preprocess_reserve(out, st.st_size + 1);
+
+    while (1) {
+        // grow only when full and more input follows, the end of a regular file fits exactly
+        if (out->len + 1 >= out->nalloc) {
+            int c = getc(file_in);
+            if (c == EOF)
+                break;
+            ungetc(c, file_in);
+            preprocess_reserve(out, out->len + PREPROCESS_CHUNK + 1);
+        }
+        size_t room = out->nalloc - out->len - 1;
+        size_t len = fread(out->body + out->len, 1, room < PREPROCESS_CHUNK ? room : PREPROCESS_CHUNK, file_in);
+        if (len == 0)
+            break;
+        size_t from = out->len;
+        out->len += len;
+
+        preprocess_include(out, from);
+        preprocess_switch_to_if(out, from);
     }
+    if (ferror(file_in))
+        util_error("Error reading input");
 
-    printf("\n----------------------------\n\n");
+    preprocess_reserve(out, out->len + 1);
+    out->body[out->len] = '\0';
+}
 
-    rewind(file_out);
+void preprocess_free(preprocess_buffer_t *buf) {
+    free(buf->body);
+    buf->body = NULL;
+    buf->len = buf->nalloc = 0;
 }
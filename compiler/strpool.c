@@ -0,0 +1,95 @@
+/*
+ * @strpool.c
+ *
+ * @brief C for Stack VM
+ * @details
+ * This is based on other projects:
+ *   A minimalist C compiler with x86_64 code generation: https://github.com/jserv/MazuCC
+ *   Others (see individual files)
+ *
+ *   please contact their authors for more information.
+ *
+ * @author Emiliano Augusto Gonzalez (egonzalez . hiperion @ gmail . com)
+ * @date 2024
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/stackvm_c_compiler
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "c_stackvm.h"
+#include "context.h"
+#include "util.h"
+#include "strpool.h"
+
+/*
+ * The literals are sorted by their reversed text, longest first, so a literal
+ * that ends another one (or is identical to it) follows it, or follows another
+ * literal it also ends, and is placed at the matching offset of that data
+ * entry. Every literal keeps its own label: with -fstreaming the code using it
+ * is already written when the pool is built.
+ */
+
+// reversed text, descending
+static int strpool_cmp(const void *a, const void *b) {
+    const char *x = (*(ast_t**) a)->sval, *y = (*(ast_t**) b)->sval;
+    int i = strlen(x), j = strlen(y);
+
+    while (i > 0 && j > 0) {
+        unsigned char cx = x[--i], cy = y[--j];
+        if (cx != cy)
+            return cy - cx;
+    }
+    return (j > 0) - (i > 0);
+}
+
+static void strpool_label(strpool_entry_t *entry, char *label, int offset) {
+    strpool_label_t *l = util_alloc(sizeof(strpool_label_t));
+    l->label = label;
+    l->offset = offset;
+    list_push(entry->labels, l);
+}
+
+list_t* strpool_build(compiler_ctx_t *ctx, list_t *strings) {
+    list_t *pool = list_make();
+    int n = list_len(strings), nall = 0;
+
+    if (!n)
+        return pool;
+    ast_t **all = util_heap(NULL, 0, n * sizeof(ast_t*));
+
+    for (iter_t i = list_iter(strings); !list_iter_end(i);) {
+        ast_t *v = list_iter_next(&i);
+        ctx->strpool.literals++;
+        ctx->strpool.bytes_before += strlen(v->sval) + 1;
+        all[nall++] = v;
+    }
+    qsort(all, nall, sizeof(ast_t*), strpool_cmp);
+
+    strpool_entry_t *owner = NULL;
+    for (int k = 0; k < nall; k++) {
+        ast_t *v = all[k];
+        int len = strlen(v->sval);
+        if (owner && owner->len >= len && !memcmp(owner->str + owner->len - len, v->sval, len)) {
+            strpool_label(owner, v->slabel, owner->len - len);
+            continue;
+        }
+        owner = util_alloc(sizeof(strpool_entry_t));
+        owner->str = v->sval;
+        owner->len = len;
+        owner->labels = list_make();
+        strpool_label(owner, v->slabel, 0);
+        list_push(pool, owner);
+        ctx->strpool.entries++;
+        ctx->strpool.bytes_after += len + 1;
+    }
+
+    free(all);
+    return pool;
+}
+
+void strpool_stats(compiler_ctx_t *ctx, FILE *fp) {
+    fprintf(fp, "strings: %d literals in %d entries, %ld -> %ld bytes (%ld saved)\n", ctx->strpool.literals, ctx->strpool.entries, ctx->strpool.bytes_before, ctx->strpool.bytes_after,
+            ctx->strpool.bytes_before - ctx->strpool.bytes_after);
+}
@@ -0,0 +1,167 @@
+/*
+ * @super.c
+ *
+ * @brief C for Stack VM
+ * @details
+ * This is based on other projects:
+ *   A minimalist C compiler with x86_64 code generation: https://github.com/jserv/MazuCC
+ *   Others (see individual files)
+ *
+ *   please contact their authors for more information.
+ *
+ * @author Emiliano Augusto Gonzalez (egonzalez . hiperion @ gmail . com)
+ * @date 2024
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/stackvm_c_compiler
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "c_stackvm.h"
+#include "context.h"
+#include "util.h"
+#include "super.h"
+
+/*
+ * Superinstruction selection. The instructions are scanned left to right and at
+ * each position the first enabled entry of the table matching there is taken
+ * (the table is sorted longest first, so the selection is greedy). Where nothing
+ * matches, or the superinstruction is disabled because the target VM does not
+ * implement it, the primitive instructions are kept.
+ *
+ * The operands of the fused instruction are those of the first instructions of
+ * the sequence: the immediate of OPND_INT, the two immediates of OPND_INT2, and
+ * the label of the final jump for OPND_LABEL.
+ */
+
+typedef struct {
+                  int op;
+                  int len;
+                  int ops[SUPER_MAX_LEN];
+                 bool (*cond)(ir_insn_t *w);
+} super_t;
+
+static bool super_is_int32(int64_t val) {
+    return val >= INT32_MIN && val <= INT32_MAX;
+}
+
+// ldl.i32 n push c add stl.i32 n
+static bool super_cond_incl(ir_insn_t *w) {
+    return w[0].ival == w[3].ival && super_is_int32(w[1].ival);
+}
+
+static bool super_cond_int2(ir_insn_t *w) {
+    return super_is_int32(w[1].ival);
+}
+
+static const super_t table[] = {
+        { OP_INCL_I32, 4, { OP_LDL_I32, OP_PUSH, OP_ADD, OP_STL_I32 }, super_cond_incl },
+        { OP_IXL_I32,  4, { OP_LDL_I32, OP_PUSH, OP_MUL, OP_ADD },     super_cond_int2 },
+        { OP_LDL2_I32, 2, { OP_LDL_I32, OP_LDL_I32 },                  super_cond_int2 },
+        { OP_ADDI,     2, { OP_PUSH, OP_ADD },                         NULL },
+        { OP_SUBI,     2, { OP_PUSH, OP_SUB },                         NULL },
+        { OP_MULI,     2, { OP_PUSH, OP_MUL },                         NULL },
+        { OP_PUSHF,    2, { OP_PUSH, OP_ITOF },                        NULL },
+        { OP_JLT,      2, { OP_LT, OP_JNZ },                           NULL },
+        { OP_JGE,      2, { OP_LT, OP_JZ },                            NULL },
+        { OP_JGT,      2, { OP_GT, OP_JNZ },                           NULL },
+        { OP_JLE,      2, { OP_GT, OP_JZ },                            NULL },
+        { OP_JEQ,      2, { OP_EQ, OP_JNZ },                           NULL },
+        { OP_JNE,      2, { OP_EQ, OP_JZ },                            NULL },
+};
+
+#define SUPER_ENTRIES (sizeof(table) / sizeof(table[0]))
+
+_Static_assert(SUPER_ENTRIES <= SUPER_MAX_ENTRIES, "SUPER_MAX_ENTRIES is too small");
+
+static bool super_match(const super_t *s, ir_insn_t *w, int avail) {
+    if (s->len > avail)
+        return false;
+    // labels are IR_LABEL instructions, so a sequence never spans a jump target
+    for (int n = 0; n < s->len; n++)
+        if (w[n].op != s->ops[n])
+            return false;
+    return !s->cond || s->cond(w);
+}
+
+static void super_fuse(const super_t *s, ir_insn_t *w, ir_insn_t *out) {
+    ir_insn_t insn = { 0 };
+
+    insn.op = s->op;
+    switch (opcodes_info(s->op)->operand) {
+        case OPND_INT:
+            insn.ival = w[0].ival;
+            break;
+        case OPND_INT2:
+            insn.ival = w[0].ival;
+            insn.imm = w[1].ival;
+            break;
+        case OPND_LABEL:
+            insn.label = w[s->len - 1].label;
+            break;
+    }
+    *out = insn;
+}
+
+bool super_enable(compiler_ctx_t *ctx, const char *name, bool enable) {
+    bool found = false;
+    for (int n = 0; n < SUPER_ENTRIES; n++) {
+        if (!name || !strcmp(opcodes_info(table[n].op)->name, name)) {
+            ctx->super.disabled[n] = !enable;
+            found = true;
+        }
+    }
+    return found;
+}
+
+bool super_select(compiler_ctx_t *ctx, const char *list) {
+    char name[32];
+
+    super_enable(ctx, NULL, false);
+    while (*list) {
+        int len = strcspn(list, ",");
+        if (len >= sizeof(name))
+            return false;
+        memcpy(name, list, len);
+        name[len] = '\0';
+        if (len && !super_enable(ctx, name, true))
+            return false;
+        list += len;
+        if (*list == ',')
+            list++;
+    }
+    return true;
+}
+
+int super_run(compiler_ctx_t *ctx, ir_func_t *func) {
+    int out = 0, selected = 0;
+
+    ctx->super.insns_before += func->len;
+    for (int n = 0; n < func->len;) {
+        ir_insn_t *w = &func->insns[n];
+        int e;
+        for (e = 0; e < SUPER_ENTRIES; e++)
+            if (!ctx->super.disabled[e] && super_match(&table[e], w, func->len - n))
+                break;
+        if (e < SUPER_ENTRIES) {
+            const super_t *s = &table[e];
+            super_fuse(s, w, &func->insns[out++]);
+            ctx->super.fired[e]++;
+            selected++;
+            n += s->len;
+        } else {
+            func->insns[out++] = func->insns[n++];
+        }
+    }
+    func->len = out;
+    ctx->super.insns_after += func->len;
+
+    return selected;
+}
+
+void super_stats(compiler_ctx_t *ctx, FILE *fp) {
+    fprintf(fp, "superinstructions: %lu -> %lu instructions\n", ctx->super.insns_before, ctx->super.insns_after);
+    for (int n = 0; n < SUPER_ENTRIES; n++)
+        fprintf(fp, "  %-16s %8lu%s\n", opcodes_info(table[n].op)->name, ctx->super.fired[n], ctx->super.disabled[n] ? " (disabled)" : "");
+}
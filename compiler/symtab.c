@@ -0,0 +1,135 @@
+/*
+ * @symtab.c
+ *
+ * @brief C for Stack VM
+ * @details
+ * This is based on other projects:
+ *   A minimalist C compiler with x86_64 code generation: https://github.com/jserv/MazuCC
+ *   Others (see individual files)
+ *
+ *   please contact their authors for more information.
+ *
+ * @author Emiliano Augusto Gonzalez (egonzalez . hiperion @ gmail . com)
+ * @date 2024
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/stackvm_c_compiler
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "arena.h"
+#include "util.h"
+#include "symtab.h"
+
+#define symtab_slot(symtab, key) \
+    ((int) (((uint64_t) (uintptr_t) (key) * 0x9E3779B97F4A7C15ull) >> 32) & ((symtab)->cap - 1))
+
+static int symtab_find(symtab_t *symtab, char *key) {
+    int pos = symtab_slot(symtab, key);
+    while (symtab->table[pos].key && symtab->table[pos].key != key)
+        pos = (pos + 1) & (symtab->cap - 1);
+    return pos;
+}
+
+static void symtab_grow(symtab_t *symtab) {
+    symtab_entry_t *old = symtab->table;
+    int old_cap = symtab->cap;
+
+    symtab->cap = old_cap ? old_cap * 2 : SYMTAB_INIT_SIZE;
+    symtab->table = arena_calloc(util_arena_root(), symtab->cap * sizeof(symtab_entry_t));
+    for (int n = 0; n < old_cap; n++)
+        if (old[n].key)
+            symtab->table[symtab_find(symtab, old[n].key)] = old[n];
+}
+
+// backward shift deletion, keeps every probe sequence unbroken without tombstones
+static void symtab_remove(symtab_t *symtab, int pos) {
+    int mask = symtab->cap - 1;
+    int next = pos;
+
+    symtab->table[pos].key = NULL;
+    symtab->table[pos].val = NULL;
+    symtab->qty--;
+    while (1) {
+        next = (next + 1) & mask;
+        if (!symtab->table[next].key)
+            return;
+        int home = symtab_slot(symtab, symtab->table[next].key);
+        if (((next - home) & mask) >= ((next - pos) & mask)) {
+            symtab->table[pos] = symtab->table[next];
+            symtab->table[next].key = NULL;
+            symtab->table[next].val = NULL;
+            pos = next;
+        }
+    }
+}
+
+symtab_t* symtab_make(void) {
+    symtab_t *r = arena_calloc(util_arena_root(), sizeof(symtab_t));
+    symtab_grow(r);
+    return r;
+}
+
+void* symtab_get(symtab_t *symtab, char *key) {
+    if (!key)
+        return NULL;
+    symtab_entry_t *e = &symtab->table[symtab_find(symtab, key)];
+    return e->key ? e->val : NULL;
+}
+
+void symtab_put(symtab_t *symtab, char *key, void *val) {
+    if ((symtab->qty + 1) * 4 >= symtab->cap * 3)
+        symtab_grow(symtab);
+
+    symtab_entry_t *e = &symtab->table[symtab_find(symtab, key)];
+
+    // like dict_t, a second binding in the same scope does not hide the first one
+    if (e->key && e->depth == symtab->depth)
+        return;
+
+    if (symtab->depth > 0) {
+        if (symtab->undo_len == symtab->undo_cap) {
+            int cap = symtab->undo_cap ? symtab->undo_cap * 2 : SYMTAB_INIT_SIZE;
+            symtab->undo = arena_realloc(util_arena_root(), symtab->undo, symtab->undo_cap * sizeof(symtab_undo_t), cap * sizeof(symtab_undo_t));
+            symtab->undo_cap = cap;
+        }
+        symtab_undo_t *u = &symtab->undo[symtab->undo_len++];
+        u->key = key;
+        u->val = e->key ? e->val : NULL;
+        u->depth = e->key ? e->depth : -1;
+    }
+
+    if (!e->key)
+        symtab->qty++;
+    e->key = key;
+    e->val = val;
+    e->depth = symtab->depth;
+}
+
+void symtab_push(symtab_t *symtab) {
+    if (symtab->depth == symtab->marks_cap) {
+        int cap = symtab->marks_cap ? symtab->marks_cap * 2 : SYMTAB_INIT_SIZE;
+        symtab->marks = arena_realloc(util_arena_root(), symtab->marks, symtab->marks_cap * sizeof(int), cap * sizeof(int));
+        symtab->marks_cap = cap;
+    }
+    symtab->marks[symtab->depth++] = symtab->undo_len;
+    symtab->scopes++;
+}
+
+void symtab_pop(symtab_t *symtab) {
+    if (symtab->depth == 0)
+        util_error("internal error: symtab scope underflow");
+
+    int mark = symtab->marks[--symtab->depth];
+    while (symtab->undo_len > mark) {
+        symtab_undo_t *u = &symtab->undo[--symtab->undo_len];
+        int pos = symtab_find(symtab, u->key);
+        if (u->depth < 0) {
+            symtab_remove(symtab, pos);
+        } else {
+            symtab->table[pos].val = u->val;
+            symtab->table[pos].depth = u->depth;
+        }
+    }
+}
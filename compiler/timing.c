@@ -0,0 +1,124 @@
+/*
+ * @timing.c
+ *
+ * @brief C for Stack VM
+ * @details
+ * This is based on other projects:
+ *   A minimalist C compiler with x86_64 code generation: https://github.com/jserv/MazuCC
+ *   Others (see individual files)
+ *
+ *   please contact their authors for more information.
+ *
+ * @author Emiliano Augusto Gonzalez (egonzalez . hiperion @ gmail . com)
+ * @date 2024
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/stackvm_c_compiler
+ */
+
+#include <sys/resource.h>
+#include <time.h>
+
+#include "c_stackvm.h"
+#include "arena.h"
+#include "context.h"
+#include "lexer.h"
+#include "trace.h"
+#include "util.h"
+#include "timing.h"
+
+/*
+ * The parser pulls its tokens from the lexer one at a time, so lexing can not
+ * be timed inside the parse without a clock read per token. The lexer is timed
+ * by a pass of its own instead and the parse phase includes lexing again, so
+ * the lex pass is left out of the total.
+ *
+ * Every phase is also a span of the trace when tracing.
+ */
+
+static const char *names[TIMING_PHASES] = {
+        [TIMING_PREPROCESS] = "preprocess",
+        [TIMING_LEX]        = "lex",
+        [TIMING_PARSE]      = "parse (+lex)",
+        [TIMING_INLINE]     = "inline",
+        [TIMING_DATA]       = "data section",
+        [TIMING_CODEGEN]    = "codegen",
+};
+
+static double timing_clock(clockid_t id) {
+    struct timespec ts;
+
+    clock_gettime(id, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void timing_sample(compiler_ctx_t *ctx, timing_phase_t *t) {
+    arena_stats_t stats;
+    struct rusage ru;
+
+    arena_get_stats(util_arena_root(), &stats);
+    getrusage(RUSAGE_SELF, &ru);
+    t->wall = timing_clock(CLOCK_MONOTONIC);
+    t->cpu = timing_clock(CLOCK_THREAD_CPUTIME_ID);
+    t->allocs = stats.allocs + ctx->util.heap_allocs;
+    t->bytes = stats.bytes + ctx->util.heap_bytes;
+    t->peak_rss = ru.ru_maxrss;
+}
+
+void timing_enable(compiler_ctx_t *ctx, bool enable) {
+    ctx->timing.enabled = enable;
+}
+
+bool timing_enabled(compiler_ctx_t *ctx) {
+    return ctx->timing.enabled;
+}
+
+void timing_begin(compiler_ctx_t *ctx, int phase) {
+    ctx->timing.span = trace_begin(ctx, "phase", names[phase]);
+    if (ctx->timing.enabled)
+        timing_sample(ctx, &ctx->timing.start);
+}
+
+void timing_end(compiler_ctx_t *ctx, int phase) {
+    timing_phase_t now, *p = &ctx->timing.phases[phase];
+
+    trace_end(ctx, ctx->timing.span, NULL, NULL, 0);
+    if (!ctx->timing.enabled)
+        return;
+    timing_sample(ctx, &now);
+    p->wall += now.wall - ctx->timing.start.wall;
+    p->cpu += now.cpu - ctx->timing.start.cpu;
+    p->allocs += now.allocs - ctx->timing.start.allocs;
+    p->bytes += now.bytes - ctx->timing.start.bytes;
+    p->peak_rss = now.peak_rss;
+}
+
+void timing_lex(compiler_ctx_t *ctx, const char *buf, size_t len) {
+    timing_begin(ctx, TIMING_LEX);
+    while (get_ttype(lexer_read_token(ctx)) != TTYPE_NULL)
+        ctx->timing.tokens++;
+    timing_end(ctx, TIMING_LEX);
+    lexer_set_buffer(ctx, buf, len);
+}
+
+void timing_report(compiler_ctx_t *ctx, FILE *fp) {
+    timing_phase_t total = { 0 };
+
+    fprintf(fp, "%-14s %10s %10s %10s %12s %12s\n", "phase", "wall ms", "cpu ms", "allocs", "bytes", "peak RSS KB");
+    for (int n = 0; n < TIMING_PHASES; n++) {
+        timing_phase_t *p = &ctx->timing.phases[n];
+        fprintf(fp, "%-14s %10.3f %10.3f %10lu %12lu %12ld\n", names[n], p->wall * 1e3, p->cpu * 1e3, p->allocs, p->bytes, p->peak_rss);
+        // the lexer runs again in the parse
+        if (n == TIMING_LEX)
+            continue;
+        total.wall += p->wall;
+        total.cpu += p->cpu;
+        total.allocs += p->allocs;
+        total.bytes += p->bytes;
+        if (p->peak_rss > total.peak_rss)
+            total.peak_rss = p->peak_rss;
+    }
+    fprintf(fp, "%-14s %10.3f %10.3f %10lu %12lu %12ld\n", "total", total.wall * 1e3, total.cpu * 1e3, total.allocs, total.bytes, total.peak_rss);
+    fprintf(fp, "the parse reads the tokens again, the lex pass is not in the total\n");
+    fprintf(fp, "produced: %lu tokens, %lu AST nodes, %lu scopes, %d labels\n", ctx->timing.tokens, ctx->parser.nodes, ctx->parser.scopes,
+            ctx->parser.labelseq);
+}
@@ -0,0 +1,165 @@
+/*
+ * @trace.c
+ *
+ * @brief C for Stack VM
+ * @details
+ * This is based on other projects:
+ *   A minimalist C compiler with x86_64 code generation: https://github.com/jserv/MazuCC
+ *   Others (see individual files)
+ *
+ *   please contact their authors for more information.
+ *
+ * @author Emiliano Augusto Gonzalez (egonzalez . hiperion @ gmail . com)
+ * @date 2024
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/stackvm_c_compiler
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "c_stackvm.h"
+#include "context.h"
+#include "util.h"
+#include "trace.h"
+
+/*
+ * A compilation records its spans in its context, with no locking and no
+ * output. When it ends they are moved to the trace of the process, which is
+ * shared by the worker threads, and the whole trace is written once at exit.
+ */
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static trace_event_t *events;
+static int nevents, events_cap;
+static double epoch;
+
+static double trace_now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3 - epoch;
+}
+
+static void trace_reserve(trace_event_t **ev, int *cap, int len) {
+    if (len < *cap)
+        return;
+    while (len >= *cap)
+        *cap = *cap ? *cap * 2 : 256;
+    if (!(*ev = realloc(*ev, *cap * sizeof(trace_event_t))))
+        util_error("Out of memory");
+}
+
+static char* trace_strdup(const char *s) {
+    char *r = strdup(s ? s : "unfinished");
+
+    if (!r)
+        util_error("Out of memory");
+    return r;
+}
+
+void trace_open(void) {
+    epoch = 0;
+    epoch = trace_now();
+}
+
+void trace_enable(compiler_ctx_t *ctx, bool enable) {
+    ctx->trace.enabled = enable;
+}
+
+int trace_begin(compiler_ctx_t *ctx, const char *cat, const char *name) {
+    trace_state_t *t = &ctx->trace;
+
+    if (!t->enabled)
+        return -1;
+    trace_reserve(&t->events, &t->events_cap, t->nevents);
+    trace_event_t *ev = &t->events[t->nevents];
+    ev->name = name ? trace_strdup(name) : NULL;
+    ev->cat = cat;
+    ev->arg = NULL;
+    ev->val = 0;
+    ev->dur = -1;
+    ev->ts = trace_now();
+    return t->nevents++;
+}
+
+void trace_end(compiler_ctx_t *ctx, int span, const char *name, const char *arg, long val) {
+    if (span < 0)
+        return;
+    trace_event_t *ev = &ctx->trace.events[span];
+    ev->dur = trace_now() - ev->ts;
+    if (name) {
+        free(ev->name);
+        ev->name = trace_strdup(name);
+    }
+    ev->arg = arg;
+    ev->val = val;
+}
+
+void trace_collect(compiler_ctx_t *ctx, int tid) {
+    trace_state_t *t = &ctx->trace;
+    double now = trace_now();
+
+    pthread_mutex_lock(&lock);
+    trace_reserve(&events, &events_cap, nevents + t->nevents);
+    for (int n = 0; n < t->nevents; n++) {
+        trace_event_t *ev = &t->events[n];
+        if (ev->dur < 0)
+            ev->dur = now - ev->ts;
+        if (!ev->name)
+            ev->name = trace_strdup(NULL);
+        ev->tid = tid;
+        events[nevents++] = *ev;
+    }
+    pthread_mutex_unlock(&lock);
+
+    free(t->events);
+    t->events = NULL;
+    t->nevents = t->events_cap = 0;
+}
+
+static void trace_string(FILE *fp, const char *s) {
+    fputc('"', fp);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\')
+            fprintf(fp, "\\%c", *s);
+        else if ((unsigned char) *s < 0x20)
+            fprintf(fp, "\\u%04x", *s);
+        else
+            fputc(*s, fp);
+    }
+    fputc('"', fp);
+}
+
+bool trace_write(const char *path) {
+    FILE *fp = fopen(path, "w");
+    int maxtid = -1;
+
+    if (!fp)
+        return false;
+    setvbuf(fp, NULL, _IOFBF, 1 << 16);
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (int n = 0; n < nevents; n++) {
+        trace_event_t *ev = &events[n];
+        fprintf(fp, "{\"name\":");
+        trace_string(fp, ev->name);
+        fprintf(fp, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d", ev->cat, ev->ts, ev->dur, ev->tid);
+        if (ev->arg)
+            fprintf(fp, ",\"args\":{\"%s\":%ld}", ev->arg, ev->val);
+        fprintf(fp, "},\n");
+        if (ev->tid > maxtid)
+            maxtid = ev->tid;
+        free(ev->name);
+    }
+    for (int tid = 0; tid <= maxtid; tid++)
+        fprintf(fp, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"worker %d\"}},\n", tid, tid);
+    fprintf(fp, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"stackvm_c_compiler\"}}\n]}\n");
+
+    free(events);
+    events = NULL;
+    nevents = events_cap = 0;
+    return !fclose(fp);
+}
@@ -16,45 +16,71 @@
  */
 
 #include <stdarg.h>
+#include <setjmp.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <limits.h>
 
+#include "arena.h"
+#include "context.h"
 #include "util.h"
-#include "list.h"
+#include "intern.h"
 
-void **mkstr = NULL;
-long mkstr_qty = 0;
+arena_t* util_arena_root(void) {
+    compiler_ctx_t *ctx = compiler_ctx_current;
 
-static list_t *cstrings = &list_empty;
+    if (!ctx->util.root_arena)
+        ctx->util.root_arena = arena_make(NULL, 0);
+    return ctx->util.root_arena;
+}
 
-void util_free_all(void) {
-    for (long n = 0; n < mkstr_qty; n++) {
-        if (mkstr[n] != NULL)
-            free(mkstr[n]);
-        mkstr[n] = NULL;
-    }
+arena_t* util_get_arena(void) {
+    arena_t *cur = compiler_ctx_current->util.cur_arena;
+
+    return cur ? cur : util_arena_root();
 }
 
-void util_lfree(void *ptr) {
-    long pos = LONG_MAX;
+arena_t* util_set_arena(arena_t *arena) {
+    arena_t *prev = util_get_arena();
+    compiler_ctx_current->util.cur_arena = arena;
+    return prev;
+}
 
-    for (long n = 0; n < mkstr_qty; n++)
-        if ((void*) mkstr[n] == ptr) {
-            pos = n;
-            break;
-        }
+void* util_alloc(size_t size) {
+    return arena_alloc(util_get_arena(), size);
+}
+
+void* util_heap(void *ptr, size_t old_size, size_t size) {
+    void *r = realloc(ptr, size ? size : 1);
 
-    if (pos != LONG_MAX) {
-        mkstr[pos] = NULL;
+    if (!r)
+        util_error("Out of memory (%zu bytes)", size);
+    // the source may be read before a compilation enters its context
+    compiler_ctx_t *ctx = compiler_ctx_current;
+    if (ctx) {
+        ctx->util.heap_allocs++;
+        ctx->util.heap_bytes += (size > old_size) ? size - old_size : 0;
     }
+    return r;
+}
+
+void util_free_all(void) {
+    compiler_ctx_t *ctx = compiler_ctx_current;
 
-    free(ptr);
+    arena_release(ctx->util.root_arena);
+    intern_reset(ctx);
+    ctx->util.root_arena = NULL;
+    ctx->util.cur_arena = NULL;
+}
+
+void util_lfree(void *ptr) {
+    if (compiler_ctx_current->util.root_arena)
+        arena_free(util_get_arena(), ptr);
 }
 
 string_t util_make_string(void) {
-    string_t ret = { .body = calloc(1, INIT_SIZE), .nalloc = INIT_SIZE, .len = 0, };
+    string_t ret = { .body = util_alloc(INIT_SIZE), .nalloc = INIT_SIZE, .len = 0, };
+    ret.body[0] = '\0';
 
     return ret;
 }
@@ -62,57 +88,29 @@ string_t util_make_string(void) {
 void util_realloc_body(string_t *s) {
     int newsize = s->nalloc * 2;
 
-    char *body = realloc(s->body, newsize);
-    s->body = body;
+    s->body = arena_realloc(util_get_arena(), s->body, s->nalloc, newsize);
     s->nalloc = newsize;
-
-    add_str_ptr(mkstr, mkstr_qty, s->body);
-
 }
 
 char* util_get_cstring(const string_t s) {
-    char *r = s.body;
-    list_push(cstrings, r);
-    return r;
+    return s.body;
 }
 
 void util_string_append(string_t *s, char c) {
-    long pos = LONG_MAX;
-
-    if (s->nalloc == (s->len + 1)) {
-        for (long n = 0; n < mkstr_qty; n++)
-            if ((void*) mkstr[n] == (void*) s->body) {
-                pos = n;
-                break;
-            }
-
-        if (pos != LONG_MAX)
-            mkstr[pos] = NULL;
-
+    if (s->nalloc == (s->len + 1))
         util_realloc_body(s);
-    }
     s->body[s->len++] = c;
     s->body[s->len] = '\0';
 }
 
 void util_string_appendf(string_t *s, char *fmt, ...) {
     va_list args;
-    long pos = LONG_MAX;
     while (1) {
         int avail = s->nalloc - s->len;
         va_start(args, fmt);
         int written = vsnprintf(s->body + s->len, avail, fmt, args);
         va_end(args);
         if (avail <= written) {
-            for (long n = 0; n < mkstr_qty; n++)
-                if ((void*) mkstr[n] == (void*) s->body) {
-                    pos = n;
-                    break;
-                }
-
-            if (pos != LONG_MAX)
-                mkstr[pos] = NULL;
-
             util_realloc_body(s);
             continue;
         }
@@ -122,12 +120,17 @@ void util_string_appendf(string_t *s, char *fmt, ...) {
 }
 
 void util_errorf(char *file, int line, char *fmt, ...) {
-    fprintf(stderr, "%s:%d: ", file, line);
+    compiler_ctx_t *ctx = compiler_ctx_current;
+    FILE *fp = (ctx && ctx->errfp) ? ctx->errfp : stderr;
+    fprintf(fp, "%s:%d: ", file, line);
     va_list args;
     va_start(args, fmt);
-    vfprintf(stderr, fmt, args);
-    fprintf(stderr, "\n");
+    vfprintf(fp, fmt, args);
+    fprintf(fp, "\n");
     va_end(args);
+    // a driver that keeps going after a failed compilation frees the context itself
+    if (ctx && ctx->on_error)
+        longjmp(*ctx->on_error, 1);
     util_free_all();
     exit(1);
 }
@@ -20,14 +20,11 @@
 #include <stdio.h>
 
 #include "c_stackvm.h"
+#include "context.h"
+#include "intern.h"
 #include "verbose.h"
 #include "lexer.h"
 
-static int tab = 0;
-static bool cont = false;
-static bool excpt = false;
-static bool no_break = false;
-
 char* verbose_ctype_to_string(ctype_t *ctype) {
     if (!ctype)
         return "(nil)";
@@ -75,21 +72,21 @@ char* verbose_ctype_to_string(ctype_t *ctype) {
     }
 }
 
-void verbose_uop_to_string(string_t *buf, char *op, ast_t *ast) {
-    char *aststr = verbose_ast_to_string(ast->operand, true);
+void verbose_uop_to_string(compiler_ctx_t *ctx, string_t *buf, char *op, ast_t *ast) {
+    char *aststr = verbose_ast_to_string(ctx, ast->operand, true);
     util_string_appendf(buf, "(%s %s)", op, aststr);
     util_lfree(aststr);
 }
 
-void verbose_binop_to_string(string_t *buf, char *op, ast_t *ast) {
-    char *aststr1 = verbose_ast_to_string(ast->left, true);
-    char *aststr2 = verbose_ast_to_string(ast->right, true);
+void verbose_binop_to_string(compiler_ctx_t *ctx, string_t *buf, char *op, ast_t *ast) {
+    char *aststr1 = verbose_ast_to_string(ctx, ast->left, true);
+    char *aststr2 = verbose_ast_to_string(ctx, ast->right, true);
     util_string_appendf(buf, "(%s %s %s)", op, aststr1, aststr2);
     util_lfree(aststr1);
     util_lfree(aststr2);
 }
 
-void verbose_ast_to_string_int(string_t *buf, ast_t *ast, bool first_entry) {
+void verbose_ast_to_string_int(compiler_ctx_t *ctx, string_t *buf, ast_t *ast, bool first_entry) {
     if (!ast) {
         util_string_appendf(buf, "(nil)");
         return;
@@ -151,42 +148,42 @@ void verbose_ast_to_string_int(string_t *buf, ast_t *ast, bool first_entry) {
             util_string_appendf(buf, "(GVAR) %s", ast->varname);
             break;
         case AST_FUNCALL: {
-            if(!excpt)
-                util_string_appendf(buf, "%*s", tab, "");
+            if(!ctx->verbose.excpt)
+                util_string_appendf(buf, "%*s", ctx->verbose.tab, "");
             util_string_appendf(buf, "(FUNCALL) %s %s", verbose_ctype_to_string(ast->ctype), ast->fname);
-            excpt = true;
+            ctx->verbose.excpt = true;
             it;
             for (iter_t i = list_iter(ast->args); !list_iter_end(i);) {
                 util_string_appendf(buf, "\n");
-                char *aststr = verbose_ast_to_string(list_iter_next(&i), true);
-                util_string_appendf(buf, "%*s%s", tab, "", aststr);
+                char *aststr = verbose_ast_to_string(ctx, list_iter_next(&i), true);
+                util_string_appendf(buf, "%*s%s", ctx->verbose.tab, "", aststr);
                 util_lfree(aststr);
             }
             dt;
-            excpt = false;
+            ctx->verbose.excpt = false;
             break;
         }
         case AST_FUNC: {
-            util_string_appendf(buf, "%*s(FUNC) %s %s \n", tab, "", verbose_ctype_to_string(ast->ctype), ast->fname);
+            util_string_appendf(buf, "%*s(FUNC) %s %s \n", ctx->verbose.tab, "", verbose_ctype_to_string(ast->ctype), ast->fname);
             it;
             for (iter_t i = list_iter(ast->params); !list_iter_end(i);) {
                 ast_t *param = list_iter_next(&i);
-                char *aststr4 = verbose_ast_to_string(param, true);
+                char *aststr4 = verbose_ast_to_string(ctx, param, true);
                 util_string_appendf(buf, "%s %s\n", verbose_ctype_to_string(param->ctype), aststr4);
                 util_lfree(aststr4);
             }
 
-            verbose_ast_to_string_int(buf, ast->body, false);
+            verbose_ast_to_string_int(ctx, buf, ast->body, false);
             dt;
             break;
         }
         case AST_DECL: {
-            if (!excpt)
-                util_string_appendf(buf, "%*s", tab, "");
+            if (!ctx->verbose.excpt)
+                util_string_appendf(buf, "%*s", ctx->verbose.tab, "");
             util_string_appendf(buf, "(DECL) %s %s", verbose_ctype_to_string(ast->declvar->ctype), ast->declvar->varname);
             if (ast->declinit) {
                 it;
-                char *aststr = verbose_ast_to_string(ast->declinit, true);
+                char *aststr = verbose_ast_to_string(ctx, ast->declinit, true);
                 util_string_appendf(buf, " %s", aststr);
                 util_lfree(aststr);
                 dt;
@@ -194,44 +191,44 @@ void verbose_ast_to_string_int(string_t *buf, ast_t *ast, bool first_entry) {
         }
             break;
         case AST_ARRAY_INIT:
-            util_string_appendf(buf, "\n%*s(ARRAY_INIT)\n", tab, "");
+            util_string_appendf(buf, "\n%*s(ARRAY_INIT)\n", ctx->verbose.tab, "");
             it;
             for (iter_t i = list_iter(ast->arrayinit); !list_iter_end(i);) {
-                util_string_appendf(buf, "%*s", tab, "");
-                verbose_ast_to_string_int(buf, list_iter_next(&i), false);
+                util_string_appendf(buf, "%*s", ctx->verbose.tab, "");
+                verbose_ast_to_string_int(ctx, buf, list_iter_next(&i), false);
                 util_string_appendf(buf, "\n");
             }
             dt;
-            util_string_appendf(buf, "%*s", tab - TAB_LEN, "");
+            util_string_appendf(buf, "%*s", ctx->verbose.tab - TAB_LEN, "");
             break;
         case AST_IF: {
-            util_string_appendf(buf, "%*s(IF)\n", tab, "");
+            util_string_appendf(buf, "%*s(IF)\n", ctx->verbose.tab, "");
             it;
-            cont = true;
-            excpt = true;
-            char *aststr = verbose_ast_to_string(ast->cond, true);
-            util_string_appendf(buf, "%*s(CONDITION) %s\n", tab, "", aststr);
+            ctx->verbose.cont = true;
+            ctx->verbose.excpt = true;
+            char *aststr = verbose_ast_to_string(ctx, ast->cond, true);
+            util_string_appendf(buf, "%*s(CONDITION) %s\n", ctx->verbose.tab, "", aststr);
             util_lfree(aststr);
-            excpt = false;
+            ctx->verbose.excpt = false;
             it;
-            aststr = verbose_ast_to_string(ast->then, true);
+            aststr = verbose_ast_to_string(ctx, ast->then, true);
             util_string_appendf(buf, "%s", aststr);
             util_lfree(aststr);
             dt;
             if (ast->els) {
                 util_string_appendf(buf, "\n");
-                util_string_appendf(buf, "%*s(ELSE)\n", tab, "");
+                util_string_appendf(buf, "%*s(ELSE)\n", ctx->verbose.tab, "");
                 dt;
-                util_string_appendf(buf, "%*s%s", tab, "", verbose_ast_to_string(ast->els, true));
+                util_string_appendf(buf, "%*s%s", ctx->verbose.tab, "", verbose_ast_to_string(ctx, ast->els, true));
                 it;
             }
             dt;
         }
             break;
         case AST_TERNARY: {
-            char *aststr1 = verbose_ast_to_string(ast->cond, true);
-            char *aststr2 = verbose_ast_to_string(ast->then, true);
-            char *aststr3 = verbose_ast_to_string(ast->els, true);
+            char *aststr1 = verbose_ast_to_string(ctx, ast->cond, true);
+            char *aststr2 = verbose_ast_to_string(ctx, ast->then, true);
+            char *aststr3 = verbose_ast_to_string(ctx, ast->els, true);
             util_string_appendf(buf, "(? %s %s %s)", aststr1, aststr2, aststr3);
             util_lfree(aststr1);
             util_lfree(aststr2);
@@ -239,108 +236,119 @@ void verbose_ast_to_string_int(string_t *buf, ast_t *ast, bool first_entry) {
         }
             break;
         case AST_FOR: {
-            excpt = true;
+            ctx->verbose.excpt = true;
 
-            char *aststr1 = verbose_ast_to_string(ast->forinit, true);
-            char *aststr2 = verbose_ast_to_string(ast->forcond, true);
-            char *aststr3 = verbose_ast_to_string(ast->forstep, true);
-            util_string_appendf(buf, "%*s(FOR %s %s %s) \n", tab, "", aststr1, aststr2, aststr3);
+            char *aststr1 = verbose_ast_to_string(ctx, ast->forinit, true);
+            char *aststr2 = verbose_ast_to_string(ctx, ast->forcond, true);
+            char *aststr3 = verbose_ast_to_string(ctx, ast->forstep, true);
+            util_string_appendf(buf, "%*s(FOR %s %s %s) \n", ctx->verbose.tab, "", aststr1, aststr2, aststr3);
             util_lfree(aststr1);
             util_lfree(aststr2);
             util_lfree(aststr3);
 
-            excpt = false;
+            ctx->verbose.excpt = false;
             it;
-            no_break = true;
-            char *aststr4 = verbose_ast_to_string(ast->forbody, false);
+            ctx->verbose.no_break = true;
+            char *aststr4 = verbose_ast_to_string(ctx, ast->forbody, false);
             util_string_appendf(buf, "%s", aststr4);
             util_lfree(aststr4);
-            no_break = false;
+            ctx->verbose.no_break = false;
             dt;
         }
             break;
         case AST_RETURN: {
-            char *aststr = verbose_ast_to_string(ast->retval, true);
-            util_string_appendf(buf, "%*s(RETURN) %s", tab, "", aststr);
+            char *aststr = verbose_ast_to_string(ctx, ast->retval, true);
+            util_string_appendf(buf, "%*s(RETURN) %s", ctx->verbose.tab, "", aststr);
             util_lfree(aststr);
         }
             break;
         case AST_COMPOUND_STMT: {
-            util_string_appendf(buf, "%*s(COMPOUND_STMT)", tab, "");
+            util_string_appendf(buf, "%*s(COMPOUND_STMT)", ctx->verbose.tab, "");
             it;
-            no_break = true;
+            ctx->verbose.no_break = true;
             for (iter_t i = list_iter(ast->stmts); !list_iter_end(i);) {
-                cont = false;
+                ctx->verbose.cont = false;
                 util_string_appendf(buf, "\n");
-                verbose_ast_to_string_int(buf, list_iter_next(&i), false);
+                verbose_ast_to_string_int(ctx, buf, list_iter_next(&i), false);
             }
-            no_break = false;
+            ctx->verbose.no_break = false;
+            dt;
+            break;
+        }
+        case AST_INLINE: {
+            if (!ctx->verbose.excpt)
+                util_string_appendf(buf, "%*s", ctx->verbose.tab, "");
+            util_string_appendf(buf, "(INLINE) %s %s\n", verbose_ctype_to_string(ast->ctype), ast->callee->fname);
+            it;
+            char *aststr = verbose_ast_to_string(ctx, ast->inlbody, true);
+            util_string_appendf(buf, "%s", aststr);
+            util_lfree(aststr);
             dt;
             break;
         }
         case AST_STRUCT_REF:
-            verbose_ast_to_string_int(buf, ast->struc, false);
+            verbose_ast_to_string_int(ctx, buf, ast->struc, false);
             util_string_appendf(buf, ".");
             util_string_appendf(buf, ast->field);
             break;
         case AST_ADDR:
-            verbose_uop_to_string(buf, "(ADDR)", ast);
+            verbose_uop_to_string(ctx, buf, "(ADDR)", ast);
             break;
         case AST_DEREF:
-            verbose_uop_to_string(buf, "(DEREF)", ast);
+            verbose_uop_to_string(ctx, buf, "(DEREF)", ast);
             break;
         case PUNCT_POSTINC:
-            if (!(cont || first_entry)) {
-                util_string_appendf(buf, "%*s", tab, "");
+            if (!(ctx->verbose.cont || first_entry)) {
+                util_string_appendf(buf, "%*s", ctx->verbose.tab, "");
             }
-            verbose_uop_to_string(buf, "POSTINC", ast);
+            verbose_uop_to_string(ctx, buf, "POSTINC", ast);
             break;
         case PUNCT_PREINC:
-            if (!(cont || first_entry)) {
-                util_string_appendf(buf, "%*s", tab, "");
+            if (!(ctx->verbose.cont || first_entry)) {
+                util_string_appendf(buf, "%*s", ctx->verbose.tab, "");
             }
-            verbose_uop_to_string(buf, "PREINC", ast);
+            verbose_uop_to_string(ctx, buf, "PREINC", ast);
             break;
         case PUNCT_POSTDEC:
-            if (!(cont || first_entry)) {
-                util_string_appendf(buf, "%*s", tab, "");
+            if (!(ctx->verbose.cont || first_entry)) {
+                util_string_appendf(buf, "%*s", ctx->verbose.tab, "");
             }
-            verbose_uop_to_string(buf, "POSTDEC", ast);
+            verbose_uop_to_string(ctx, buf, "POSTDEC", ast);
             break;
         case PUNCT_PREDEC:
-            if (!(cont || first_entry)) {
-                util_string_appendf(buf, "%*s", tab, "");
+            if (!(ctx->verbose.cont || first_entry)) {
+                util_string_appendf(buf, "%*s", ctx->verbose.tab, "");
             }
-            verbose_uop_to_string(buf, "PREDEC", ast);
+            verbose_uop_to_string(ctx, buf, "PREDEC", ast);
             break;
         case PUNCT_LOGAND:
-            verbose_binop_to_string(buf, "and", ast);
+            verbose_binop_to_string(ctx, buf, "and", ast);
             break;
         case PUNCT_LOGOR:
-            verbose_binop_to_string(buf, "or", ast);
+            verbose_binop_to_string(ctx, buf, "or", ast);
             break;
         case PUNCT_LSHIFT:
-            verbose_binop_to_string(buf, "<<", ast);
+            verbose_binop_to_string(ctx, buf, "<<", ast);
             break;
         case PUNCT_RSHIFT:
-            verbose_binop_to_string(buf, ">>", ast);
+            verbose_binop_to_string(ctx, buf, ">>", ast);
             break;
         case '!':
-            verbose_uop_to_string(buf, "!", ast);
-            cont = true;
+            verbose_uop_to_string(ctx, buf, "!", ast);
+            ctx->verbose.cont = true;
             break;
         case '&':
-            verbose_binop_to_string(buf, "&", ast);
+            verbose_binop_to_string(ctx, buf, "&", ast);
             break;
         case '|':
-            verbose_binop_to_string(buf, "|", ast);
+            verbose_binop_to_string(ctx, buf, "|", ast);
             break;
         default:
-            char *left = verbose_ast_to_string(ast->left, true);
-            char *right = verbose_ast_to_string(ast->right, true);
+            char *left = verbose_ast_to_string(ctx, ast->left, true);
+            char *right = verbose_ast_to_string(ctx, ast->right, true);
 
-            if (!(cont || first_entry)) {
-                util_string_appendf(buf, "%*s", tab, "");
+            if (!(ctx->verbose.cont || first_entry)) {
+                util_string_appendf(buf, "%*s", ctx->verbose.tab, "");
             }
 
             if (ast->type == PUNCT_EQ) {
@@ -353,7 +361,7 @@ void verbose_ast_to_string_int(string_t *buf, ast_t *ast, bool first_entry) {
 
             util_string_appendf(buf, "%s %s)", left, right);
 
-            if (!no_break && !(cont || first_entry)) {
+            if (!ctx->verbose.no_break && !(ctx->verbose.cont || first_entry)) {
                 util_string_appendf(buf, "\n");
             }
 
@@ -362,13 +370,13 @@ void verbose_ast_to_string_int(string_t *buf, ast_t *ast, bool first_entry) {
     }
 }
 
-char* verbose_ast_to_string(ast_t *ast, bool first_entry) {
+char* verbose_ast_to_string(compiler_ctx_t *ctx, ast_t *ast, bool first_entry) {
     string_t s = util_make_string();
-    verbose_ast_to_string_int(&s, ast, first_entry);
+    verbose_ast_to_string_int(ctx, &s, ast, first_entry);
     return util_get_cstring(s);
 }
 
-char* verbose_token_to_string(const token_t tok) {
+char* verbose_token_to_string(compiler_ctx_t *ctx, const token_t tok) {
     enum token_type ttype = get_ttype(tok);
 
     if (ttype == TTYPE_NULL)
@@ -380,6 +388,8 @@ char* verbose_token_to_string(const token_t tok) {
             break;
         case TTYPE_IDENT:
             return get_ident(tok);
+        case TTYPE_KEYWORD:
+            return intern_keyword_name(get_keyword(tok));
         case TTYPE_PUNCT:
             if (lexer_is_punct(tok, PUNCT_EQ))
                 util_string_appendf(&s, "==");
@@ -390,9 +400,9 @@ char* verbose_token_to_string(const token_t tok) {
             util_string_append(&s, get_char(tok));
             return util_get_cstring(s);
         case TTYPE_NUMBER:
-            return get_number(tok);
+            return get_number(ctx, tok);
         case TTYPE_STRING:
-            util_string_appendf(&s, "\"%s\"", get_strtok(tok));
+            util_string_appendf(&s, "\"%s\"", get_strtok(ctx, tok));
             return util_get_cstring(s);
     }
 
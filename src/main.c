@@ -15,6 +15,8 @@
  * @see https://github.com/hiperiondev/stackvm_c_compiler
  */
 
+#include <pthread.h>
+#include <setjmp.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
@@ -23,23 +25,85 @@
 
 #include "util.h"
 #include "c_stackvm.h"
+#include "context.h"
 #include "codegenir.h"
 #include "parser.h"
+#include "lexer.h"
 #include "verbose.h"
 #include "preprocess.h"
+#include "constpool.h"
+#include "frame.h"
+#include "inliner.h"
+#include "output.h"
+#include "peephole.h"
+#include "strpool.h"
+#include "super.h"
+#include "timing.h"
+#include "trace.h"
 
-FILE *outfp, *preprfp, *tempfp;
+typedef struct {
+                   char *infile;
+                   char *outfile;  // NULL for stdout
+                   FILE *diagfp;   // diagnostics, a buffer when compiling several files
+                   char *diag;
+                 size_t diag_len;
+    preprocess_buffer_t source;
+                    int status;
+                 double cpu;       // seconds
+} job_t;
 
-static char *outfile = NULL, *infile = NULL;
+static char *outfile = NULL;
+static char **infiles;
+static int ninfiles;
+static int njobs = 1;
 static bool dump_ast;
-extern void **mkstr;
-static char tmpfname[20];
+static bool binary;
+static bool streaming;
+static bool peephole_stats_dump;
+static bool super_stats_dump;
+static bool frame_stats_dump;
+static bool strpool_stats_dump;
+static bool constpool_stats_dump;
+static bool opt_report;
+static bool time_report;
+static char *trace_file;
+
+// set by the command line, copied to the context of each compilation
+static compiler_ctx_t *options;
+
+static job_t *jobs;
+static int next_job;
+static pthread_mutex_t next_job_lock = PTHREAD_MUTEX_INITIALIZER;
 
 static void usage(void) {
-    fprintf(stdout, "stackvm_c_compiler [options] filename\n"
+    fprintf(stdout, "stackvm_c_compiler [options] filename...\n"
             "OPTIONS\n"
-            "  -o filename    Write output to the specified file.\n"
-            "  --dump-ast     Dump abstract syntax tree(AST)\n");
+            "  -o filename    Write output to the specified file. With several input files\n"
+            "                 each one is written next to its input as .s, .svmb or .ast\n"
+            "  -j n           Compile up to n files at the same time\n"
+            "  -fbinary       Write a bytecode image instead of assembly\n"
+            "  -fstreaming    Generate each function once it is parsed and free it, the\n"
+            "                 string literals are written at the end of the output.\n"
+            "                 Only the last 256 small functions can be inlined\n"
+            "  -finline-limit=n\n"
+            "                 Inline leaf functions of up to n AST nodes, 0 disables\n"
+            "                 inlining\n"
+            "  -fopt-report   Print the call sites inlined and the reason for the others,\n"
+            "                 and the tail calls turned into loops\n"
+            "  -fno-peephole[=rule]\n"
+            "                 Disable the peephole optimizer, or one of its rules\n"
+            "  -fpeephole-stats\n"
+            "                 Print how often each peephole rule fired\n"
+            "  -fsuper=list   Only use the superinstructions of a comma separated list\n"
+            "  -fno-super[=name]\n"
+            "                 Do not use superinstructions, or one of them\n"
+            "  -fsuper-stats  Print how often each superinstruction was selected\n"
+            "  -fframe-stats  Print the frame size of each function\n"
+            "  -fstring-stats Print the size of the string literals before and after pooling\n"
+            "  -fconst-stats  Print the size of the float constants before and after pooling\n"
+            "  -ftime-report  Print the time and memory of each phase\n"
+            "  --dump-ast     Dump abstract syntax tree(AST)\n"
+            "  --trace=file   Write a Chrome trace of the phases and functions compiled\n");
 }
 
 static void print_usage_and_exit(void) {
@@ -47,11 +111,26 @@ static void print_usage_and_exit(void) {
     exit(1);
 }
 
+static int parse_jobs(char *arg) {
+    char *end;
+    long n;
+
+    if (!arg)
+        print_usage_and_exit();
+    n = strtol(arg, &end, 10);
+    if (*end || end == arg || n < 1 || n > 1024)
+        print_usage_and_exit();
+    return n;
+}
+
 static void parse_args(int argc, char **argv) {
     if (argc < 2) {
         print_usage_and_exit();
     }
 
+    if (!(infiles = malloc(argc * sizeof(char*))))
+        util_error("Out of memory");
+
     while (true) {
         argc--;
         argv++;
@@ -62,100 +141,343 @@ static void parse_args(int argc, char **argv) {
         if ((*argv)[0] == '-') {
             switch ((*argv)[1]) {
                 case '\0':
-                    infile = "/dev/stdin";
+                    infiles[ninfiles++] = "/dev/stdin";
                     break;
                 case 'o':
                     argc--;
                     argv++;
                     outfile = *argv;
                     break;
+                case 'j':
+                    if ((*argv)[2])
+                        njobs = parse_jobs(*argv + 2);
+                    else {
+                        argc--;
+                        argv++;
+                        njobs = parse_jobs(*argv);
+                    }
+                    break;
+                case 'f':
+                    if (!strcmp(*argv, "-fbinary"))
+                        binary = true;
+                    else if (!strcmp(*argv, "-fstreaming"))
+                        streaming = true;
+                    else if (!strncmp(*argv, "-finline-limit=", 15)) {
+                        char *end;
+                        long limit = strtol(*argv + 15, &end, 10);
+                        if (*end || end == *argv + 15 || limit < 0)
+                            print_usage_and_exit();
+                        inliner_set_limit(options, limit);
+                    } else if (!strcmp(*argv, "-fopt-report"))
+                        opt_report = true;
+                    else if (!strcmp(*argv, "-fno-peephole"))
+                        peephole_enable(options, NULL, false);
+                    else if (!strncmp(*argv, "-fno-peephole=", 14)) {
+                        if (!peephole_enable(options, *argv + 14, false))
+                            print_usage_and_exit();
+                    } else if (!strcmp(*argv, "-fpeephole-stats"))
+                        peephole_stats_dump = true;
+                    else if (!strcmp(*argv, "-fno-super"))
+                        super_enable(options, NULL, false);
+                    else if (!strncmp(*argv, "-fno-super=", 11)) {
+                        if (!super_enable(options, *argv + 11, false))
+                            print_usage_and_exit();
+                    } else if (!strncmp(*argv, "-fsuper=", 8)) {
+                        if (!super_select(options, *argv + 8))
+                            print_usage_and_exit();
+                    } else if (!strcmp(*argv, "-fsuper-stats"))
+                        super_stats_dump = true;
+                    else if (!strcmp(*argv, "-fframe-stats"))
+                        frame_stats_dump = true;
+                    else if (!strcmp(*argv, "-fstring-stats"))
+                        strpool_stats_dump = true;
+                    else if (!strcmp(*argv, "-fconst-stats"))
+                        constpool_stats_dump = true;
+                    else if (!strcmp(*argv, "-ftime-report"))
+                        time_report = true;
+                    else
+                        print_usage_and_exit();
+                    break;
                 case '-':
                     if (!strcmp(*argv, "--dump-ast"))
                         dump_ast = true;
+                    else if (!strncmp(*argv, "--trace=", 8)) {
+                        trace_file = *argv + 8;
+                        if (!*trace_file)
+                            print_usage_and_exit();
+                    }
                     break;
                 default:
                     print_usage_and_exit();
             }
         } else {
-            if (infile)
-                print_usage_and_exit();
-
-            infile = argv[0];
+            infiles[ninfiles++] = argv[0];
         }
     }
+
+    if (!ninfiles) {
+        printf("Input file is not specified\n\n");
+        print_usage_and_exit();
+    }
+    if (ninfiles > 1 && outfile)
+        print_usage_and_exit();
 }
 
-static void open_output_file(void) {
-    if (outfile) {
-        if (!(outfp = fopen(outfile, "w"))) {
-            printf("Can't open file %s\n", outfile);
-            exit(1);
+// foo/bar.c -> foo/bar.s
+static char* output_name(char *infile) {
+    char *ext = dump_ast ? ".ast" : binary ? ".svmb" : ".s";
+    char *base = strrchr(infile, '/') ? strrchr(infile, '/') + 1 : infile;
+    char *dot = strrchr(base, '.');
+    size_t len = (dot && dot != base) ? dot - infile : strlen(infile);
+    char *r = malloc(len + strlen(ext) + 1);
+
+    if (!r)
+        util_error("Out of memory");
+    memcpy(r, infile, len);
+    strcpy(r + len, ext);
+    return r;
+}
+
+// one toplevel at a time, only the inliner candidates are kept
+static void compile_streaming(compiler_ctx_t *ctx) {
+    ast_t *v;
+
+    codegenir_set_binary(ctx, binary);
+    parser_open(ctx);
+    while (true) {
+        timing_begin(ctx, TIMING_PARSE);
+        v = parser_read_toplevel(ctx);
+        timing_end(ctx, TIMING_PARSE);
+        if (!v)
+            break;
+        if (v->type == AST_FUNC) {
+            timing_begin(ctx, TIMING_INLINE);
+            inliner_add(ctx, v);
+            timing_end(ctx, TIMING_INLINE);
         }
-    } else {
-        outfp = stdout;
+        timing_begin(ctx, TIMING_CODEGEN);
+        codegenir_emit_toplevel(ctx, v);
+        timing_end(ctx, TIMING_CODEGEN);
+        if (v->type == AST_FUNC)
+            inliner_release(ctx, v);
     }
+    timing_begin(ctx, TIMING_CODEGEN);
+    codegenir_emit_end(ctx);
+    timing_end(ctx, TIMING_CODEGEN);
 }
-static void open_input_file(void) {
-    srand(time(NULL));
-    for (int i = 0; i < 20; ++i)
-        tmpfname[i] = 'A' + rand() % 26;
 
-    if (!infile) {
-        printf("Input file is not specified\n\n");
-        print_usage_and_exit();
+static int compile_file(compiler_ctx_t *ctx, job_t *job) {
+    FILE *fp;
+
+    if (!(fp = fopen(job->infile, "r"))) {
+        fprintf(ctx->errfp, "Can't open file %s\n", job->infile);
+        return 1;
     }
+    timing_begin(ctx, TIMING_PREPROCESS);
+    preprocess_file(fp, &job->source);
+    timing_end(ctx, TIMING_PREPROCESS);
+    lexer_set_buffer(ctx, job->source.body, job->source.len);
+    fclose(fp);
+    if (timing_enabled(ctx))
+        timing_lex(ctx, job->source.body, job->source.len);
 
-    if (!(preprfp = fopen(infile, "r"))) {
-        printf("a-Can't open file %s\n", outfile);
-        exit(1);
+    if (job->outfile) {
+        if (!(ctx->outfp = fopen(job->outfile, "w"))) {
+            fprintf(ctx->errfp, "Can't open file %s\n", job->outfile);
+            return 1;
+        }
+    } else {
+        ctx->outfp = stdout;
     }
 
-    if (!(tempfp = fopen(tmpfname, "w"))) {
-        printf("b-Can't open file %s\n", outfile);
-        exit(1);
+    if (streaming && !dump_ast) {
+        compile_streaming(ctx);
+        goto end;
+    }
+    timing_begin(ctx, TIMING_PARSE);
+    list_t *toplevels = parser_read_toplevels(ctx);
+    timing_end(ctx, TIMING_PARSE);
+    timing_begin(ctx, TIMING_INLINE);
+    inliner_run(ctx, toplevels);
+    timing_end(ctx, TIMING_INLINE);
+    codegenir_set_binary(ctx, binary && !dump_ast);
+    if (!dump_ast) {
+        timing_begin(ctx, TIMING_DATA);
+        codegenir_emit_data_section(ctx);
+        timing_end(ctx, TIMING_DATA);
     }
 
-    preprocess_file(preprfp, tempfp);
+    timing_begin(ctx, TIMING_CODEGEN);
+    for (iter_t i = list_iter(toplevels); !list_iter_end(i);) {
+        ast_t *v = list_iter_next(&i);
+        if (dump_ast) {
+            char *aststr = verbose_ast_to_string(ctx, v, true);
+            output_str(ctx, aststr);
+            output_str(ctx, " \n");
+            util_lfree(aststr);
+        } else {
+            codegenir_emit_toplevel(ctx, v);
+        }
+    }
 
-    if (!freopen(tmpfname, "r", stdin)) {
-        printf("c-Can't open file %s\n", tmpfname);
-        exit(1);
+    if (dump_ast) {
+        output_str(ctx, "\n---- data section ----\n");
+        codegenir_emit_data_section(ctx);
+        output_str(ctx, "\n----------------------\n");
+    } else {
+        codegenir_emit_end(ctx);
+    }
+    timing_end(ctx, TIMING_CODEGEN);
+end:
+    output_flush(ctx);
+    if (opt_report) {
+        inliner_report(ctx, ctx->errfp);
+        codegenir_report(ctx, ctx->errfp);
     }
+    if (peephole_stats_dump)
+        peephole_stats(ctx, ctx->errfp);
+    if (super_stats_dump)
+        super_stats(ctx, ctx->errfp);
+    if (frame_stats_dump)
+        frame_stats(ctx, ctx->errfp);
+    if (strpool_stats_dump)
+        strpool_stats(ctx, ctx->errfp);
+    if (constpool_stats_dump)
+        constpool_stats(ctx, ctx->errfp);
+    if (time_report)
+        timing_report(ctx, ctx->errfp);
+
+    return 0;
+}
+
+static double cpu_time(void) {
+    struct timespec ts;
 
-    fclose(preprfp);
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double wall_time(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// every compilation has its own context and so its own arena, errors come back here
+static void compile(job_t *job, int tid) {
+    jmp_buf on_error;
+    double start = cpu_time();
+    compiler_ctx_t *ctx = compiler_ctx_make();
+    compiler_ctx_t *prev = compiler_ctx_enter(ctx);
+
+    compiler_ctx_copy_options(ctx, options);
+    timing_enable(ctx, time_report);
+    trace_enable(ctx, trace_file != NULL);
+    // closed with the spans a failure left open by trace_collect
+    trace_begin(ctx, "file", job->infile);
+    ctx->errfp = job->diagfp;
+    ctx->outfp = NULL;
+    ctx->on_error = &on_error;
+    if (setjmp(on_error))
+        job->status = 1;
+    else
+        job->status = compile_file(ctx, job);
+
+    if (trace_file)
+        trace_collect(ctx, tid);
+    lexer_close(ctx);
+    preprocess_free(&job->source);
+    if (ctx->outfp && ctx->outfp != stdout) {
+        fclose(ctx->outfp);
+        // no partial output is left behind to look up to date
+        if (job->status)
+            remove(job->outfile);
+    } else if (ctx->outfp)
+        fflush(ctx->outfp);
+    compiler_ctx_free(ctx);
+    compiler_ctx_enter(prev);
+    job->cpu = cpu_time() - start;
+}
+
+static void* worker(void *arg) {
+    while (true) {
+        pthread_mutex_lock(&next_job_lock);
+        int n = next_job < ninfiles ? next_job++ : -1;
+        pthread_mutex_unlock(&next_job_lock);
+        if (n < 0)
+            return NULL;
+        compile(&jobs[n], (int) (intptr_t) arg);
+    }
 }
 
 int main(int argc, char **argv) {
-    parse_args(argc, argv);
-    open_input_file();
-    open_output_file();
-    mkstr = malloc(sizeof(void*));
+    int failed = 0;
+    double cpu = 0, start;
 
-    list_t *toplevels = parser_read_toplevels();
-    if (!dump_ast)
-        codegenir_emit_data_section();
+    // the options are kept in a context, the one of the main thread between compilations
+    options = compiler_ctx_make();
+    compiler_ctx_enter(options);
+    parse_args(argc, argv);
+    if (trace_file)
+        trace_open();
 
-    for (iter_t i = list_iter(toplevels); !list_iter_end(i);) {
-        ast_t *v = list_iter_next(&i);
-        if (dump_ast) {
-            char *aststr = verbose_ast_to_string(v, true);
-            printf("%s \n", aststr);
-            util_lfree(aststr);
+    if (!(jobs = calloc(ninfiles, sizeof(job_t))))
+        util_error("Out of memory");
+    for (int n = 0; n < ninfiles; n++) {
+        jobs[n].infile = infiles[n];
+        if (ninfiles == 1) {
+            jobs[n].outfile = outfile;
+            jobs[n].diagfp = stderr;
         } else {
-            codegenir_emit_toplevel(v);
+            jobs[n].outfile = output_name(infiles[n]);
+            // the messages of each file are printed together, in the order of the command line
+            if (!(jobs[n].diagfp = open_memstream(&jobs[n].diag, &jobs[n].diag_len)))
+                util_error("Out of memory");
         }
     }
 
-    printf("\n---- data section ----\n");
-    codegenir_emit_data_section();
-    printf("\n----------------------\n");
+    start = wall_time();
+    if (njobs > ninfiles)
+        njobs = ninfiles;
+    if (njobs == 1) {
+        worker(NULL);
+    } else {
+        pthread_t *threads = malloc(njobs * sizeof(pthread_t));
+        if (!threads)
+            util_error("Out of memory");
+        for (int n = 0; n < njobs; n++)
+            if (pthread_create(&threads[n], NULL, worker, (void*) (intptr_t) n))
+                util_error("Can't create thread");
+        for (int n = 0; n < njobs; n++)
+            pthread_join(threads[n], NULL);
+        free(threads);
+    }
+    double wall = wall_time() - start;
+
+    for (int n = 0; n < ninfiles; n++) {
+        if (ninfiles > 1) {
+            fclose(jobs[n].diagfp);
+            if (jobs[n].diag_len)
+                fprintf(stderr, "%s:\n", jobs[n].infile);
+            fwrite(jobs[n].diag, 1, jobs[n].diag_len, stderr);
+            free(jobs[n].diag);
+            free(jobs[n].outfile);
+        }
+        failed += jobs[n].status != 0;
+        cpu += jobs[n].cpu;
+    }
+    if (ninfiles > 1)
+        fprintf(stderr, "%d files, %d failed, %d jobs: wall %.3fs, cpu %.3fs\n", ninfiles, failed, njobs, wall, cpu);
 
-    util_free_all();
+    if (trace_file && !trace_write(trace_file)) {
+        fprintf(stderr, "Can't write trace %s\n", trace_file);
+        failed++;
+    }
 
-    free(mkstr);
-    fclose(outfp);
-    fclose(tempfp);
-    remove(tmpfname);
+    free(jobs);
+    free(infiles);
+    compiler_ctx_free(options);
 
-    return 0;
+    return failed ? 1 : 0;
 }
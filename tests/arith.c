@@ -67,6 +67,17 @@ int test_shift()
     expect(3, 7 >> 1);
 }
 
+int test_store_reload()
+{
+    uint u = 4000000000;
+    int x;
+    int neg = 0;
+    x = u;
+    if (x < 0)
+        neg = 1;
+    expect(1, neg);
+}
+
 int main()
 {
     test_basic();
@@ -76,5 +87,6 @@ int main()
     test_logand();
     test_bitand();
     test_shift();
+    test_store_reload();
     return 0;
 }
@@ -0,0 +1,81 @@
+/* Test integer conversions */
+
+int expect(int a, int b)
+{
+    if (!(a == b)) {
+        printf("Failed\n");
+        printf("  %d expected, but got %d\n", a, b);
+        exit(1);
+    }
+}
+
+char to_char(int x)
+{
+    return x;
+}
+
+uint to_uint(int x)
+{
+    return x;
+}
+
+int from_char(char c)
+{
+    return c;
+}
+
+int test_return()
+{
+    expect(44, to_char(300));
+    expect(0 - 56, to_char(200));
+    expect(1, to_uint(0 - 1) > 0);
+}
+
+int test_assign()
+{
+    char c;
+    int y = 100;
+    expect(1, (c = y * 3) == 44);
+    expect(44, c);
+}
+
+int test_ternary()
+{
+    char c = 1;
+    int y = 100;
+    expect(44, from_char(c ? y * 3 : 0));
+}
+
+int test_argument()
+{
+    int y = 100;
+    expect(44, from_char(y * 3));
+}
+
+int test_unsigned()
+{
+    uint two = 2;
+    uint u;
+    int m = 0 - 1;
+    expect(1, m / two > 100);
+    expect(1, (u = m) > 100);
+}
+
+int test_step()
+{
+    char c = 127;
+    c++;
+    expect(0 - 128, c);
+    expect(0 - 127, ++c);
+}
+
+int main()
+{
+    test_return();
+    test_assign();
+    test_ternary();
+    test_argument();
+    test_unsigned();
+    test_step();
+    return 0;
+}
@@ -0,0 +1,119 @@
+#! /bin/bash
+#
+# Quality of the generated code: compiles each tests/*.c at every optimization
+# level, runs it on the simulator (vm/vm.c) and compares the static code size
+# and the dynamic counts against tests/quality.baseline.
+#
+#   tests/quality.sh             check, fails on a regression beyond the tolerance
+#   tests/quality.sh --update    rewrite the baseline with the current numbers
+#
+# TOLERANCE is the allowed increase of each metric in percent (default 2).
+# The output of every run must match the baseline checksum and end with status 0.
+#
+
+set -e
+cd "$(dirname "$0")/.."
+
+baseline=tests/quality.baseline
+tolerance=${TOLERANCE:-2}
+update=false
+[ "$1" == "--update" ] && update=true
+
+# the compiler has no -O switch, the levels are these sets of options
+levels=(O0 O1 O2 O3)
+declare -A flags=(
+    [O0]="-finline-limit=0 -fno-peephole -fno-super"
+    [O1]="-finline-limit=0 -fno-super"
+    [O2]="-finline-limit=0"
+    [O3]=""
+)
+metrics=(insns code_bytes steps max_stack frame_bytes)
+
+out=$(mktemp -d)
+trap 'rm -rf "$out"' EXIT
+
+gcc -O2 -pthread -Icompiler/include compiler/[a-z]*.c src/main.c -o "$out/svc"
+gcc -O2 -Icompiler/include vm/vm.c compiler/opcodes.c -o "$out/svm"
+
+json_field() {
+    sed -n "s/.*\"$1\":\([0-9]*\).*/\1/p" "$2"
+}
+
+# program level insns code_bytes steps max_stack frame_bytes output
+measure() {
+    local prog=$1 level=$2 base="$out/$1.$2"
+
+    "$out/svc" ${flags[$level]} -fbinary "$3" -o "$base.svmb" 2> "$base.err" || return 1
+    "$out/svc" ${flags[$level]} "$3" -o "$base.s" 2> "$base.err" || return 1
+    "$out/svm" --json="$base.json" "$base.svmb" > "$base.out" 2> "$base.err" || return 2
+    "$out/svm" "$base.s" > "$base.text.out" 2> "$base.err" || return 2
+    cmp -s "$base.out" "$base.text.out" || return 3
+    echo "$prog $level $(json_field insns "$base.json") $(od -An -tu4 -j12 -N4 "$base.svmb" | tr -d ' ')" \
+        "$(json_field steps "$base.json") $(json_field max_stack "$base.json") $(json_field frame_bytes "$base.json")" \
+        "$(cksum < "$base.out" | cut -d' ' -f1)"
+}
+
+declare -A old
+if [ -f "$baseline" ]; then
+    while read -r prog level rest; do
+        [ "${prog:0:1}" == "#" ] || old[$prog.$level]=$rest
+    done < "$baseline"
+fi
+
+failed=0
+current="$out/current"
+echo "# program level ${metrics[*]} output_cksum" > "$current"
+for src in tests/*.c; do
+    prog=$(basename "$src" .c)
+    for level in "${levels[@]}"; do
+        status=0
+        line=$(measure "$prog" "$level" "$src") || status=$?
+        if [ $status -ne 0 ]; then
+            case $status in
+                1) msg="does not compile" ;;
+                2) msg="VM error or nonzero exit status: $(tail -1 "$out/$prog.$level.err")" ;;
+                *) msg="the assembly and the bytecode image give different output" ;;
+            esac
+            if [ -n "${old[$prog.$level]}" ]; then
+                echo "FAIL $prog $level: $msg"
+                failed=1
+            elif [ "$level" == O0 ]; then
+                echo "skip $prog: $msg"
+            fi
+            continue
+        fi
+        echo "$line" >> "$current"
+        $update && continue
+
+        read -r -a now <<< "$line"
+        now=("${now[@]:2}")
+        read -r -a was <<< "${old[$prog.$level]}"
+        if [ ${#was[@]} -eq 0 ]; then
+            echo "new  $prog $level: ${now[*]}"
+            continue
+        fi
+        if [ "${now[5]}" != "${was[5]}" ]; then
+            echo "FAIL $prog $level: output changed"
+            failed=1
+        fi
+        for n in "${!metrics[@]}"; do
+            if [ $((now[n] * 100)) -gt $((was[n] * (100 + tolerance))) ]; then
+                echo "FAIL $prog $level: ${metrics[n]} ${was[n]} -> ${now[n]}"
+                failed=1
+            elif [ "${now[n]}" -lt "${was[n]}" ]; then
+                echo "better $prog $level: ${metrics[n]} ${was[n]} -> ${now[n]}"
+            fi
+        done
+    done
+done
+
+if $update; then
+    cp "$current" "$baseline"
+    echo "$baseline updated"
+    exit 0
+fi
+for key in "${!old[@]}"; do
+    grep -q "^${key%.*} ${key##*.} " "$current" || { echo "FAIL ${key%.*} ${key##*.}: missing"; failed=1; }
+done
+[ $failed -eq 0 ] && echo "code quality ok (tolerance $tolerance%)"
+exit $failed
@@ -0,0 +1,1207 @@
+/*
+ * @vm.c
+ *
+ * @brief C for Stack VM
+ * @details
+ * Reference simulator of the instruction set in opcodes.h. It runs the assembly
+ * (.s) or the bytecode image (.svmb) written by the compiler and measures the
+ * run: instructions executed by opcode, operand stack depth, frame memory, call
+ * depth and calls by function. It is deterministic, so the counts can be
+ * compared between versions of the compiler.
+ *
+ *   gcc -O2 -Icompiler/include vm/vm.c compiler/opcodes.c -o svm
+ *   ./svm [--stats] [--json=file] [--max-steps=n] [--mem=bytes] program.s
+ *
+ * The exit status is the one of the program (return of main or exit), 255 if
+ * the VM stops on an error.
+ *
+ * @author Emiliano Augusto Gonzalez (egonzalez . hiperion @ gmail . com)
+ * @date 2024
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/stackvm_c_compiler
+ */
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "opcodes.h"
+#include "binary.h"
+
+#define VM_STACK_MAX  (1 << 16)
+#define VM_CALLS_MAX  (1 << 16)
+#define VM_MEM_DEFAULT (1 << 20)
+
+// functions of the VM, called with .extern
+enum {
+    VM_NATIVE_PRINTF,
+    VM_NATIVE_EXIT,
+    VM_NATIVES
+};
+
+static const char *natives[VM_NATIVES] = { "printf", "exit" };
+
+typedef union {
+    int64_t i;
+     double f;
+} vm_cell_t;
+
+typedef struct {
+        int op;
+    int32_t a;       // immediate, data address or first of two immediates
+    int32_t b;       // second immediate or argument count
+        int target;  // instruction index of a jump or call, native for extern calls
+} vm_insn_t;
+
+typedef struct {
+    char *name;
+     int value;
+    bool code;
+} vm_sym_t;
+
+typedef struct {
+     uint8_t *data;
+      size_t data_len;
+      size_t data_cap;
+   vm_insn_t *code;
+         int ncode;
+         int code_cap;
+         int entry;
+       char **names;      // name of the label at each instruction, NULL if none
+    vm_sym_t *syms;       // open addressing, text only
+         int syms_cap;
+         int nsyms;
+} vm_prog_t;
+
+typedef struct {
+    int pc;
+    int fp;
+    int sp_frame;
+    int base;
+} vm_frame_t;
+
+typedef struct {
+    uint64_t steps;
+    uint64_t ops[OP_MAX];
+    uint64_t calls;
+    uint64_t *calls_to;   // by callee instruction index
+    uint64_t native_calls[VM_NATIVES];
+         int max_stack;
+         int max_depth;
+         int max_frame;   // bytes of frames in use
+} vm_stats_t;
+
+static const char *path;
+static int line_no;
+
+static void vm_error(const char *fmt, ...) {
+    va_list args;
+
+    va_start(args, fmt);
+    fprintf(stderr, "svm: %s", path);
+    if (line_no)
+        fprintf(stderr, ":%d", line_no);
+    fprintf(stderr, ": ");
+    vfprintf(stderr, fmt, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+    exit(255);
+}
+
+static void* vm_grow(void *p, int *cap, int len, size_t size) {
+    if (len < *cap)
+        return p;
+    while (len >= *cap)
+        *cap = *cap ? *cap * 2 : 256;
+    if (!(p = realloc(p, *cap * size)))
+        vm_error("out of memory");
+    return p;
+}
+
+/////////////////////////////// loading ///////////////////////////////
+
+static unsigned vm_hash(const char *s) {
+    unsigned h = 2166136261u;
+
+    for (; *s; s++)
+        h = (h ^ (unsigned char) *s) * 16777619u;
+    return h;
+}
+
+static vm_sym_t* vm_sym_find(vm_prog_t *prog, const char *name) {
+    if (!prog->syms_cap)
+        return NULL;
+    for (unsigned n = vm_hash(name) & (prog->syms_cap - 1);; n = (n + 1) & (prog->syms_cap - 1)) {
+        if (!prog->syms[n].name)
+            return NULL;
+        if (!strcmp(prog->syms[n].name, name))
+            return &prog->syms[n];
+    }
+}
+
+static void vm_sym_add(vm_prog_t *prog, const char *name, int value, bool code) {
+    if (vm_sym_find(prog, name))
+        vm_error("%s defined twice", name);
+    if ((prog->nsyms + 1) * 2 > prog->syms_cap) {
+        vm_sym_t *old = prog->syms;
+        int old_cap = prog->syms_cap;
+        prog->syms_cap = old_cap ? old_cap * 2 : 256;
+        if (!(prog->syms = calloc(prog->syms_cap, sizeof(vm_sym_t))))
+            vm_error("out of memory");
+        prog->nsyms = 0;
+        for (int n = 0; n < old_cap; n++)
+            if (old[n].name)
+                vm_sym_add(prog, old[n].name, old[n].value, old[n].code);
+        free(old);
+    }
+    unsigned n = vm_hash(name) & (prog->syms_cap - 1);
+    while (prog->syms[n].name)
+        n = (n + 1) & (prog->syms_cap - 1);
+    if (!(prog->syms[n].name = strdup(name)))
+        vm_error("out of memory");
+    prog->syms[n].value = value;
+    prog->syms[n].code = code;
+    prog->nsyms++;
+}
+
+static void vm_data(vm_prog_t *prog, const void *p, size_t len) {
+    if (!len)
+        return;
+    while (prog->data_len + len > prog->data_cap) {
+        prog->data_cap = prog->data_cap ? prog->data_cap * 2 : 4096;
+        if (!(prog->data = realloc(prog->data, prog->data_cap)))
+            vm_error("out of memory");
+    }
+    if (p)
+        memcpy(prog->data + prog->data_len, p, len);
+    else
+        memset(prog->data + prog->data_len, 0, len);
+    prog->data_len += len;
+}
+
+static vm_insn_t* vm_insn(vm_prog_t *prog) {
+    prog->code = vm_grow(prog->code, &prog->code_cap, prog->ncode, sizeof(vm_insn_t));
+    vm_insn_t *insn = &prog->code[prog->ncode++];
+    memset(insn, 0, sizeof(*insn));
+    return insn;
+}
+
+static long vm_number(char **s) {
+    char *end;
+    long v = strtol(*s, &end, 10);
+
+    if (end == *s)
+        vm_error("number expected");
+    for (*s = end; **s == ' ' || **s == ','; (*s)++)
+        ;
+    return v;
+}
+
+static char* vm_word(char **s) {
+    char *w = *s;
+
+    while (**s && **s != ',' && **s != ' ')
+        (*s)++;
+    if (**s) {
+        *(*s)++ = '\0';
+        while (**s == ' ' || **s == ',')
+            (*s)++;
+    }
+    return w;
+}
+
+static int vm_native(const char *name) {
+    for (int n = 0; n < VM_NATIVES; n++)
+        if (!strcmp(natives[n], name))
+            return n;
+    vm_error("unknown extern %s", name);
+    return -1;
+}
+
+static void vm_string(vm_prog_t *prog, char *s) {
+    if (*s++ != '"')
+        vm_error("string expected");
+    for (; *s && *s != '"'; s++) {
+        char c = *s;
+        if (c == '\\') {
+            switch (*++s) {
+                case 'n':
+                    c = '\n';
+                    break;
+                case 't':
+                    c = '\t';
+                    break;
+                case '0':
+                    c = '\0';
+                    break;
+                default:
+                    c = *s;
+            }
+        }
+        vm_data(prog, &c, 1);
+    }
+    vm_data(prog, "", 1);
+}
+
+// pass 0 defines the labels and the data, pass 1 the instructions
+static void vm_load_text_line(vm_prog_t *prog, char *line, int pass, bool *text) {
+    char *s = line;
+
+    if (*s != '\t') {
+        char *colon = strrchr(s, ':');
+        if (!colon || colon[1])
+            vm_error("label expected");
+        *colon = '\0';
+        if (pass) {
+            // a function is named after its own label, not a local one ending the previous function
+            char **name = &prog->names[prog->ncode];
+            if (*text && (!*name || **name == '.')) {
+                free(*name);
+                *name = strdup(s);
+            }
+        } else
+            vm_sym_add(prog, s, *text ? prog->ncode : (int) prog->data_len, *text);
+        return;
+    }
+    s++;
+    char *op = vm_word(&s);
+    if (*op == '.') {
+        if (!strcmp(op, ".text") || !strcmp(op, ".data")) {
+            *text = op[1] == 't';
+        } else if (pass || !strcmp(op, ".extern") || !strcmp(op, ".stack")) {
+        } else if (!strcmp(op, ".string")) {
+            vm_string(prog, s);
+        } else if (!strcmp(op, ".byte")) {
+            int8_t v = vm_number(&s);
+            vm_data(prog, &v, 1);
+        } else if (!strcmp(op, ".long")) {
+            int32_t v = vm_number(&s);
+            vm_data(prog, &v, 4);
+        } else if (!strcmp(op, ".quad")) {
+            int64_t v = strtoll(s, NULL, 10);
+            vm_data(prog, &v, 8);
+        } else if (!strcmp(op, ".float")) {
+            float v = strtof(s, NULL);
+            vm_data(prog, &v, 4);
+        } else if (!strcmp(op, ".double")) {
+            double v = strtod(s, NULL);
+            vm_data(prog, &v, 8);
+        } else if (!strcmp(op, ".zero")) {
+            vm_data(prog, NULL, vm_number(&s));
+        } else if (!strcmp(op, ".align")) {
+            long a = vm_number(&s);
+            if (a > 0 && prog->data_len % a)
+                vm_data(prog, NULL, a - prog->data_len % a);
+        } else
+            vm_error("unknown directive %s", op);
+        return;
+    }
+
+    if (!*text)
+        vm_error("instruction in the data section");
+    if (!pass) {
+        prog->ncode++;
+        return;
+    }
+    vm_insn_t *insn = vm_insn(prog);
+    vm_sym_t *sym;
+    if ((insn->op = opcodes_find(op)) < 0)
+        vm_error("unknown instruction %s", op);
+    switch (opcodes_info(insn->op)->operand) {
+        case OPND_INT:
+            insn->a = vm_number(&s);
+            break;
+        case OPND_INT2:
+            insn->a = vm_number(&s);
+            insn->b = vm_number(&s);
+            break;
+        case OPND_SYM:
+            if (!(sym = vm_sym_find(prog, op = vm_word(&s))) || sym->code)
+                vm_error("undefined data symbol %s", op);
+            insn->a = sym->value;
+            break;
+        case OPND_LABEL:
+            if (!(sym = vm_sym_find(prog, op = vm_word(&s))) || !sym->code)
+                vm_error("undefined label %s", op);
+            insn->target = sym->value;
+            break;
+        case OPND_CALL:
+            op = vm_word(&s);
+            insn->b = vm_number(&s);
+            if ((sym = vm_sym_find(prog, op)) && sym->code)
+                insn->target = sym->value;
+            else {
+                insn->target = -1;
+                insn->a = vm_native(op);
+            }
+            break;
+    }
+}
+
+static void vm_load_text(vm_prog_t *prog, char *buf) {
+    vm_sym_t *main_sym;
+    char **lines = NULL, *scratch;
+    int nlines = 0, lines_cap = 0;
+    size_t longest = 0;
+
+    // the passes parse a copy of each line, the parser writes into it
+    for (char *line = buf; *line;) {
+        char *nl = strchr(line, '\n');
+        lines = vm_grow(lines, &lines_cap, nlines, sizeof(char*));
+        lines[nlines++] = line;
+        if (nl)
+            *nl = '\0';
+        size_t len = strlen(line);
+        if (len && line[len - 1] == '\r')
+            line[--len] = '\0';
+        if (len > longest)
+            longest = len;
+        if (!nl)
+            break;
+        line = nl + 1;
+    }
+    if (!(scratch = malloc(longest + 1)))
+        vm_error("out of memory");
+
+    for (int pass = 0; pass < 2; pass++) {
+        bool text = true;
+        if (pass) {
+            if (!(prog->names = calloc(prog->ncode + 1, sizeof(char*))))
+                vm_error("out of memory");
+            prog->ncode = 0;
+        }
+        for (int n = 0; n < nlines; n++) {
+            if (strspn(lines[n], " \t") == strlen(lines[n]))
+                continue;
+            line_no = n + 1;
+            strcpy(scratch, lines[n]);
+            vm_load_text_line(prog, scratch, pass, &text);
+        }
+    }
+    line_no = 0;
+    free(scratch);
+    free(lines);
+
+    if (!(main_sym = vm_sym_find(prog, "main")) || !main_sym->code)
+        vm_error("main is not defined");
+    prog->entry = main_sym->value;
+}
+
+static uint32_t vm_u32(const uint8_t *p) {
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+static void vm_load_binary(vm_prog_t *prog, uint8_t *buf, size_t len) {
+    uint32_t data_len, code_len, entry, nexterns;
+    int *index_of;
+    int *externs;
+
+    if (len < BINARY_HEADER_LEN || memcmp(buf, BINARY_MAGIC, 4))
+        vm_error("not a bytecode image");
+    if ((buf[4] | buf[5] << 8) != BINARY_VERSION)
+        vm_error("bytecode version %d, expected %d", buf[4] | buf[5] << 8, BINARY_VERSION);
+    data_len = vm_u32(buf + 8);
+    code_len = vm_u32(buf + 12);
+    entry = vm_u32(buf + 16);
+    nexterns = vm_u32(buf + 20);
+    if ((uint64_t) BINARY_HEADER_LEN + data_len + code_len > len)
+        vm_error("truncated image");
+    if (entry == BINARY_NONE)
+        vm_error("main is not defined");
+
+    vm_data(prog, buf + BINARY_HEADER_LEN, data_len);
+
+    uint8_t *code = buf + BINARY_HEADER_LEN + data_len;
+    uint8_t *ext = code + code_len;
+    if (!(externs = calloc(nexterns + 1, sizeof(int))))
+        vm_error("out of memory");
+    for (uint32_t n = 0; n < nexterns; n++) {
+        char name[256];
+        if (ext >= buf + len || ext + 1 + *ext > buf + len)
+            vm_error("truncated externs");
+        memcpy(name, ext + 1, *ext);
+        name[*ext] = '\0';
+        externs[n] = vm_native(name);
+        ext += 1 + *ext;
+    }
+
+    // code offsets to instruction indexes, -1 inside an instruction
+    if (!(index_of = malloc((code_len + 1) * sizeof(int))))
+        vm_error("out of memory");
+    for (uint32_t n = 0; n <= code_len; n++)
+        index_of[n] = -1;
+    for (uint32_t off = 0; off < code_len;) {
+        vm_insn_t *insn = vm_insn(prog);
+        static const int operand_len[] = { [OPND_NONE] = 0, [OPND_INT] = 4, [OPND_SYM] = 4, [OPND_LABEL] = 4, [OPND_CALL] = 5, [OPND_INT2] = 8 };
+        index_of[off] = prog->ncode - 1;
+        if ((insn->op = code[off]) >= OP_MAX)
+            vm_error("bad opcode %d at %u", insn->op, off);
+        int kind = opcodes_info(insn->op)->operand;
+        if (off + 1 + operand_len[kind] > code_len)
+            vm_error("truncated instruction at %u", off);
+        uint8_t *p = code + off + 1;
+        switch (kind) {
+            case OPND_INT:
+            case OPND_SYM:
+                insn->a = vm_u32(p);
+                break;
+            case OPND_INT2:
+                insn->a = vm_u32(p);
+                insn->b = vm_u32(p + 4);
+                break;
+            case OPND_LABEL:
+                insn->target = vm_u32(p);
+                break;
+            case OPND_CALL:
+                insn->target = vm_u32(p);
+                insn->b = p[4];
+                break;
+        }
+        off += 1 + operand_len[kind];
+    }
+
+    if (!(prog->names = calloc(prog->ncode + 1, sizeof(char*))))
+        vm_error("out of memory");
+    for (int n = 0; n < prog->ncode; n++) {
+        vm_insn_t *insn = &prog->code[n];
+        int kind = opcodes_info(insn->op)->operand;
+        uint32_t t = insn->target;
+        if (kind == OPND_CALL && (t & BINARY_EXTERN)) {
+            if ((t & ~BINARY_EXTERN) >= nexterns)
+                vm_error("bad extern %u", t & ~BINARY_EXTERN);
+            insn->a = externs[t & ~BINARY_EXTERN];
+            insn->target = -1;
+        } else if (kind == OPND_LABEL || kind == OPND_CALL) {
+            if (t >= code_len || index_of[t] < 0)
+                vm_error("bad code offset %u", t);
+            insn->target = index_of[t];
+            if (kind == OPND_CALL && !prog->names[insn->target]) {
+                char name[16];
+                snprintf(name, sizeof(name), "@%u", t);
+                prog->names[insn->target] = strdup(name);
+            }
+        }
+    }
+    if (entry >= code_len || index_of[entry] < 0)
+        vm_error("bad entry %u", entry);
+    prog->entry = index_of[entry];
+    if (!prog->names[prog->entry])
+        prog->names[prog->entry] = strdup("main");
+
+    free(index_of);
+    free(externs);
+}
+
+static void vm_load(vm_prog_t *prog, const char *file) {
+    FILE *fp = fopen(file, "rb");
+    uint8_t *buf = NULL;
+    size_t len = 0, cap = 0, n;
+
+    if (!fp)
+        vm_error("can't open");
+    do {
+        if (len + 4096 > cap && !(buf = realloc(buf, cap = (cap + 4096) * 2)))
+            vm_error("out of memory");
+        len += n = fread(buf + len, 1, cap - len - 1, fp);
+    } while (n);
+    fclose(fp);
+    buf[len] = '\0';
+
+    if (len >= 4 && !memcmp(buf, BINARY_MAGIC, 4))
+        vm_load_binary(prog, buf, len);
+    else
+        vm_load_text(prog, (char*) buf);
+    free(buf);
+}
+
+static void vm_free(vm_prog_t *prog) {
+    for (int n = 0; n < prog->syms_cap; n++)
+        free(prog->syms[n].name);
+    for (int n = 0; n <= prog->ncode; n++)
+        free(prog->names[n]);
+    free(prog->syms);
+    free(prog->names);
+    free(prog->code);
+    free(prog->data);
+}
+
+/////////////////////////////// execution ///////////////////////////////
+
+static uint8_t *mem;
+static size_t mem_len;
+
+static uint8_t* vm_addr(int64_t addr, int len) {
+    if (addr < 0 || (uint64_t) addr + len > mem_len)
+        vm_error("memory access out of range: %lld", (long long) addr);
+    return mem + addr;
+}
+
+static char* vm_cstr(int64_t addr) {
+    uint8_t *s = vm_addr(addr, 1);
+    if (!memchr(s, '\0', mem_len - addr))
+        vm_error("unterminated string at %lld", (long long) addr);
+    return (char*) s;
+}
+
+// printf of the program, the arguments are cells converted by the format
+static void vm_printf(vm_cell_t *args, int nargs) {
+    char *fmt = vm_cstr(args[0].i);
+    int arg = 1;
+
+    for (char *s = fmt; *s; s++) {
+        if (*s != '%') {
+            putchar(*s);
+            continue;
+        }
+        if (s[1] == '%') {
+            putchar('%');
+            s++;
+            continue;
+        }
+        char spec[32];
+        int len = 0;
+        spec[len++] = '%';
+        for (s++; *s && strchr("-+ #0123456789.*", *s) && len < 24; s++) {
+            if (*s == '*') {
+                len += snprintf(spec + len, sizeof(spec) - len, "%d", arg < nargs ? (int) args[arg++].i : 0);
+                continue;
+            }
+            spec[len++] = *s;
+        }
+        while (*s == 'l' || *s == 'h' || *s == 'z')
+            s++;
+        if (!*s)
+            break;
+        vm_cell_t v = { 0 };
+        if (arg < nargs)
+            v = args[arg++];
+        switch (*s) {
+            case 'd':
+            case 'i':
+            case 'u':
+            case 'x':
+            case 'X':
+            case 'o':
+                spec[len++] = 'l';
+                spec[len++] = 'l';
+                spec[len++] = *s;
+                spec[len] = '\0';
+                printf(spec, (long long) v.i);
+                break;
+            case 'c':
+                spec[len++] = 'c';
+                spec[len] = '\0';
+                printf(spec, (int) v.i);
+                break;
+            case 's':
+                spec[len++] = 's';
+                spec[len] = '\0';
+                printf(spec, vm_cstr(v.i));
+                break;
+            case 'p':
+                printf("0x%llx", (long long) v.i);
+                break;
+            case 'f':
+            case 'F':
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G':
+                spec[len++] = *s;
+                spec[len] = '\0';
+                printf(spec, v.f);
+                break;
+            default:
+                vm_error("printf: unsupported conversion %%%c", *s);
+        }
+    }
+}
+
+#define POP()      (sp > 0 ? stack[--sp] : (vm_error("operand stack underflow at %d (%s)", pc - 1, opcodes_info(insn->op)->name), stack[0]))
+#define PUSH_I(v)  do { if (sp == VM_STACK_MAX) vm_error("operand stack overflow"); stack[sp++].i = (v); } while (0)
+#define PUSH_F(v)  do { if (sp == VM_STACK_MAX) vm_error("operand stack overflow"); stack[sp++].f = (v); } while (0)
+#define LOCAL(off, len) vm_addr((int64_t) fp + (off), len)
+
+static int32_t vm_ld32(const uint8_t *p) {
+    int32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static void vm_st32(uint8_t *p, int64_t v) {
+    int32_t w = (int32_t) (uint32_t) v;
+    memcpy(p, &w, 4);
+}
+
+static int vm_run(vm_prog_t *prog, vm_stats_t *st, uint64_t max_steps) {
+    static vm_cell_t stack[VM_STACK_MAX];
+    static vm_frame_t calls[VM_CALLS_MAX];
+    int sp = 0, ncalls = 0, pc = prog->entry;
+    int frame_base = (prog->data_len + 15) & ~15;
+    int fp = 0, sp_frame = frame_base;
+    vm_cell_t a, b;
+    int64_t i64;
+    double f64;
+    float f32;
+
+    calls[ncalls++] = (vm_frame_t ) { -1, 0, sp_frame, 0 };
+    st->max_depth = 1;
+    st->calls_to[pc]++;
+
+    for (;;) {
+        if (pc < 0 || pc >= prog->ncode)
+            vm_error("pc out of range: %d", pc);
+        vm_insn_t *insn = &prog->code[pc++];
+        st->ops[insn->op]++;
+        if (++st->steps > max_steps && max_steps)
+            vm_error("more than %llu steps", (unsigned long long) max_steps);
+
+        switch (insn->op) {
+            case OP_NOP:
+                break;
+            case OP_PUSH:
+                PUSH_I(insn->a);
+                break;
+            case OP_DROP:
+                POP();
+                break;
+            case OP_DUP:
+                a = POP();
+                PUSH_I(a.i);
+                PUSH_I(a.i);
+                break;
+            case OP_SWAP:
+                b = POP();
+                a = POP();
+                PUSH_I(b.i);
+                PUSH_I(a.i);
+                break;
+            case OP_OVER:
+                b = POP();
+                a = POP();
+                PUSH_I(a.i);
+                PUSH_I(b.i);
+                PUSH_I(a.i);
+                break;
+            case OP_LEA:
+                PUSH_I((int64_t) fp + insn->a);
+                break;
+            case OP_GADDR:
+                PUSH_I(insn->a);
+                break;
+
+            case OP_LD_I8:
+                a = POP();
+                PUSH_I(*(int8_t*) vm_addr(a.i, 1));
+                break;
+            case OP_LD_I32:
+                a = POP();
+                PUSH_I(vm_ld32(vm_addr(a.i, 4)));
+                break;
+            case OP_LD_U32:
+                a = POP();
+                PUSH_I((uint32_t) vm_ld32(vm_addr(a.i, 4)));
+                break;
+            case OP_LD_I64:
+                memcpy(&i64, vm_addr(POP().i, 8), 8);
+                PUSH_I(i64);
+                break;
+            case OP_LD_F32:
+                memcpy(&f32, vm_addr(POP().i, 4), 4);
+                PUSH_F(f32);
+                break;
+            case OP_LD_F64:
+                memcpy(&f64, vm_addr(POP().i, 8), 8);
+                PUSH_F(f64);
+                break;
+
+            case OP_ST_I8:
+                a = POP();
+                b = POP();
+                *vm_addr(a.i, 1) = (uint8_t) b.i;
+                break;
+            case OP_ST_I32:
+                a = POP();
+                b = POP();
+                vm_st32(vm_addr(a.i, 4), b.i);
+                break;
+            case OP_ST_I64:
+                a = POP();
+                b = POP();
+                memcpy(vm_addr(a.i, 8), &b.i, 8);
+                break;
+            case OP_ST_F32:
+                a = POP();
+                b = POP();
+                f32 = b.f;
+                memcpy(vm_addr(a.i, 4), &f32, 4);
+                break;
+            case OP_ST_F64:
+                a = POP();
+                b = POP();
+                memcpy(vm_addr(a.i, 8), &b.f, 8);
+                break;
+
+            case OP_LDL_I8:
+                PUSH_I(*(int8_t*) LOCAL(insn->a, 1));
+                break;
+            case OP_LDL_I32:
+                PUSH_I(vm_ld32(LOCAL(insn->a, 4)));
+                break;
+            case OP_LDL_U32:
+                PUSH_I((uint32_t) vm_ld32(LOCAL(insn->a, 4)));
+                break;
+            case OP_LDL_I64:
+                memcpy(&i64, LOCAL(insn->a, 8), 8);
+                PUSH_I(i64);
+                break;
+            case OP_LDL_F32:
+                memcpy(&f32, LOCAL(insn->a, 4), 4);
+                PUSH_F(f32);
+                break;
+            case OP_LDL_F64:
+                memcpy(&f64, LOCAL(insn->a, 8), 8);
+                PUSH_F(f64);
+                break;
+
+            case OP_STL_I8:
+                *LOCAL(insn->a, 1) = (uint8_t) POP().i;
+                break;
+            case OP_STL_I32:
+                vm_st32(LOCAL(insn->a, 4), POP().i);
+                break;
+            case OP_STL_I64:
+                a = POP();
+                memcpy(LOCAL(insn->a, 8), &a.i, 8);
+                break;
+            case OP_STL_F32:
+                f32 = POP().f;
+                memcpy(LOCAL(insn->a, 4), &f32, 4);
+                break;
+            case OP_STL_F64:
+                a = POP();
+                memcpy(LOCAL(insn->a, 8), &a.f, 8);
+                break;
+
+            case OP_ADD:
+                b = POP();
+                a = POP();
+                PUSH_I((int64_t) ((uint64_t) a.i + (uint64_t) b.i));
+                break;
+            case OP_SUB:
+                b = POP();
+                a = POP();
+                PUSH_I((int64_t) ((uint64_t) a.i - (uint64_t) b.i));
+                break;
+            case OP_MUL:
+                b = POP();
+                a = POP();
+                PUSH_I((int64_t) ((uint64_t) a.i * (uint64_t) b.i));
+                break;
+            case OP_DIV:
+                b = POP();
+                a = POP();
+                if (!b.i)
+                    vm_error("division by zero at %d", pc - 1);
+                PUSH_I(b.i == -1 ? (int64_t) (0 - (uint64_t) a.i) : a.i / b.i);
+                break;
+            case OP_UDIV:
+                b = POP();
+                a = POP();
+                if (!b.i)
+                    vm_error("division by zero at %d", pc - 1);
+                PUSH_I((int64_t) ((uint64_t) a.i / (uint64_t) b.i));
+                break;
+            case OP_AND:
+                b = POP();
+                a = POP();
+                PUSH_I(a.i & b.i);
+                break;
+            case OP_OR:
+                b = POP();
+                a = POP();
+                PUSH_I(a.i | b.i);
+                break;
+            case OP_SHL:
+                b = POP();
+                a = POP();
+                PUSH_I((int64_t) ((uint64_t) a.i << (b.i & 63)));
+                break;
+            case OP_SHR:
+                b = POP();
+                a = POP();
+                PUSH_I(a.i >> (b.i & 63));
+                break;
+            case OP_USHR:
+                b = POP();
+                a = POP();
+                PUSH_I((int64_t) ((uint64_t) a.i >> (b.i & 63)));
+                break;
+            case OP_LT:
+                b = POP();
+                a = POP();
+                PUSH_I(a.i < b.i);
+                break;
+            case OP_GT:
+                b = POP();
+                a = POP();
+                PUSH_I(a.i > b.i);
+                break;
+            case OP_ULT:
+                b = POP();
+                a = POP();
+                PUSH_I((uint64_t) a.i < (uint64_t) b.i);
+                break;
+            case OP_UGT:
+                b = POP();
+                a = POP();
+                PUSH_I((uint64_t) a.i > (uint64_t) b.i);
+                break;
+            case OP_EQ:
+                b = POP();
+                a = POP();
+                PUSH_I(a.i == b.i);
+                break;
+            case OP_NOT:
+                a = POP();
+                PUSH_I(!a.i);
+                break;
+            case OP_U32:
+                a = POP();
+                PUSH_I((uint32_t) a.i);
+                break;
+            case OP_SX_I8:
+                a = POP();
+                PUSH_I((int8_t) a.i);
+                break;
+            case OP_SX_I32:
+                a = POP();
+                PUSH_I((int32_t) a.i);
+                break;
+
+            case OP_FADD:
+                b = POP();
+                a = POP();
+                PUSH_F(a.f + b.f);
+                break;
+            case OP_FSUB:
+                b = POP();
+                a = POP();
+                PUSH_F(a.f - b.f);
+                break;
+            case OP_FMUL:
+                b = POP();
+                a = POP();
+                PUSH_F(a.f * b.f);
+                break;
+            case OP_FDIV:
+                b = POP();
+                a = POP();
+                PUSH_F(a.f / b.f);
+                break;
+            case OP_FLT:
+                b = POP();
+                a = POP();
+                PUSH_I(a.f < b.f);
+                break;
+            case OP_FGT:
+                b = POP();
+                a = POP();
+                PUSH_I(a.f > b.f);
+                break;
+            case OP_FEQ:
+                b = POP();
+                a = POP();
+                PUSH_I(a.f == b.f);
+                break;
+            case OP_ITOF:
+                a = POP();
+                PUSH_F((double) a.i);
+                break;
+            case OP_FTOI:
+                f64 = POP().f;
+                if (!(f64 > -9223372036854775808.0 && f64 < 9223372036854775808.0))
+                    vm_error("float to int out of range at %d", pc - 1);
+                PUSH_I((int64_t) f64);
+                break;
+
+            case OP_JMP:
+                pc = insn->target;
+                break;
+            case OP_JZ:
+                if (!POP().i)
+                    pc = insn->target;
+                break;
+            case OP_JNZ:
+                if (POP().i)
+                    pc = insn->target;
+                break;
+
+            case OP_CALL:
+                if (sp < insn->b)
+                    vm_error("operand stack underflow at %d (call)", pc - 1);
+                st->calls++;
+                if (insn->target < 0) {
+                    st->native_calls[insn->a]++;
+                    sp -= insn->b;
+                    if (insn->a == VM_NATIVE_EXIT)
+                        return insn->b ? (int) stack[sp].i : 0;
+                    if (!insn->b)
+                        vm_error("printf without format at %d", pc - 1);
+                    vm_printf(&stack[sp], insn->b);
+                    PUSH_I(0);
+                    break;
+                }
+                if (ncalls == VM_CALLS_MAX)
+                    vm_error("call stack overflow");
+                calls[ncalls++] = (vm_frame_t ) { pc, fp, sp_frame, sp - insn->b };
+                if (ncalls > st->max_depth)
+                    st->max_depth = ncalls;
+                st->calls_to[insn->target]++;
+                pc = insn->target;
+                break;
+            case OP_RET:
+                a = POP();
+                ncalls--;
+                pc = calls[ncalls].pc;
+                fp = calls[ncalls].fp;
+                sp_frame = calls[ncalls].sp_frame;
+                sp = calls[ncalls].base;
+                if (pc < 0) {
+                    fflush(stdout);
+                    return (int) a.i;
+                }
+                PUSH_I(a.i);
+                break;
+            case OP_ENTER:
+                fp = sp_frame;
+                if (insn->a < 0 || (size_t) sp_frame + insn->a > mem_len)
+                    vm_error("out of frame memory");
+                sp_frame += insn->a;
+                memset(mem + fp, 0, insn->a);
+                if (sp_frame - frame_base > st->max_frame)
+                    st->max_frame = sp_frame - frame_base;
+                break;
+
+            case OP_ADDI:
+                a = POP();
+                PUSH_I((int64_t) ((uint64_t) a.i + (uint64_t) (int64_t) insn->a));
+                break;
+            case OP_SUBI:
+                a = POP();
+                PUSH_I((int64_t) ((uint64_t) a.i - (uint64_t) (int64_t) insn->a));
+                break;
+            case OP_MULI:
+                a = POP();
+                PUSH_I((int64_t) ((uint64_t) a.i * (uint64_t) (int64_t) insn->a));
+                break;
+            case OP_LDL2_I32:
+                PUSH_I(vm_ld32(LOCAL(insn->a, 4)));
+                PUSH_I(vm_ld32(LOCAL(insn->b, 4)));
+                break;
+            case OP_IXL_I32:
+                a = POP();
+                PUSH_I((int64_t) ((uint64_t) a.i + (uint64_t) ((int64_t) vm_ld32(LOCAL(insn->a, 4)) * insn->b)));
+                break;
+            case OP_INCL_I32:
+                vm_st32(LOCAL(insn->a, 4), (int64_t) vm_ld32(LOCAL(insn->a, 4)) + insn->b);
+                break;
+            case OP_JLT:
+                b = POP();
+                a = POP();
+                if (a.i < b.i)
+                    pc = insn->target;
+                break;
+            case OP_JGE:
+                b = POP();
+                a = POP();
+                if (a.i >= b.i)
+                    pc = insn->target;
+                break;
+            case OP_JGT:
+                b = POP();
+                a = POP();
+                if (a.i > b.i)
+                    pc = insn->target;
+                break;
+            case OP_JLE:
+                b = POP();
+                a = POP();
+                if (a.i <= b.i)
+                    pc = insn->target;
+                break;
+            case OP_JEQ:
+                b = POP();
+                a = POP();
+                if (a.i == b.i)
+                    pc = insn->target;
+                break;
+            case OP_JNE:
+                b = POP();
+                a = POP();
+                if (a.i != b.i)
+                    pc = insn->target;
+                break;
+            case OP_PUSHF:
+                PUSH_F((double) insn->a);
+                break;
+
+            default:
+                vm_error("bad opcode %d at %d", insn->op, pc - 1);
+        }
+        if (sp > st->max_stack)
+            st->max_stack = sp;
+    }
+}
+
+/////////////////////////////// report ///////////////////////////////
+
+static vm_prog_t *sort_prog;
+static vm_stats_t *sort_stats;
+
+static int vm_cmp_ops(const void *x, const void *y) {
+    uint64_t a = sort_stats->ops[*(const int*) x], b = sort_stats->ops[*(const int*) y];
+    return a < b ? 1 : a > b ? -1 : *(const int*) x - *(const int*) y;
+}
+
+static int vm_cmp_funcs(const void *x, const void *y) {
+    uint64_t a = sort_stats->calls_to[*(const int*) x], b = sort_stats->calls_to[*(const int*) y];
+    return a < b ? 1 : a > b ? -1 : strcmp(sort_prog->names[*(const int*) x], sort_prog->names[*(const int*) y]);
+}
+
+// functions called, by decreasing count
+static int vm_funcs(vm_prog_t *prog, vm_stats_t *st, int *funcs) {
+    int nfuncs = 0;
+
+    for (int n = 0; n < prog->ncode; n++)
+        if (st->calls_to[n]) {
+            if (!prog->names[n] && !(prog->names[n] = strdup("?")))
+                vm_error("out of memory");
+            funcs[nfuncs++] = n;
+        }
+    sort_prog = prog;
+    sort_stats = st;
+    qsort(funcs, nfuncs, sizeof(int), vm_cmp_funcs);
+    return nfuncs;
+}
+
+static void vm_report(FILE *fp, vm_prog_t *prog, vm_stats_t *st, int status) {
+    int ops[OP_MAX], nops = 0;
+    int *funcs = malloc((prog->ncode + 1) * sizeof(int));
+    int nfuncs = vm_funcs(prog, st, funcs);
+
+    for (int op = 0; op < OP_MAX; op++)
+        if (st->ops[op])
+            ops[nops++] = op;
+    qsort(ops, nops, sizeof(int), vm_cmp_ops);
+
+    fprintf(fp, "exit status:        %d\n", status);
+    fprintf(fp, "instructions:       %d\n", prog->ncode);
+    fprintf(fp, "steps:              %llu\n", (unsigned long long) st->steps);
+    fprintf(fp, "max operand stack:  %d cells\n", st->max_stack);
+    fprintf(fp, "max call depth:     %d\n", st->max_depth);
+    fprintf(fp, "max frame memory:   %d bytes\n", st->max_frame);
+    fprintf(fp, "calls:              %llu\n", (unsigned long long) st->calls);
+    fprintf(fp, "\n%-12s %12s %7s\n", "opcode", "count", "%");
+    for (int n = 0; n < nops; n++)
+        fprintf(fp, "%-12s %12llu %6.2f%%\n", opcodes_info(ops[n])->name, (unsigned long long) st->ops[ops[n]],
+                100.0 * st->ops[ops[n]] / st->steps);
+    fprintf(fp, "\n%-24s %12s\n", "function", "calls");
+    for (int n = 0; n < nfuncs; n++)
+        fprintf(fp, "%-24s %12llu\n", prog->names[funcs[n]], (unsigned long long) st->calls_to[funcs[n]]);
+    for (int n = 0; n < VM_NATIVES; n++)
+        if (st->native_calls[n])
+            fprintf(fp, "%-24s %12llu (extern)\n", natives[n], (unsigned long long) st->native_calls[n]);
+    free(funcs);
+}
+
+static void vm_json(FILE *fp, vm_prog_t *prog, vm_stats_t *st, int status) {
+    int *funcs = malloc((prog->ncode + 1) * sizeof(int));
+    int nfuncs = vm_funcs(prog, st, funcs);
+    const char *sep = "";
+
+    fprintf(fp, "{\"program\":\"%s\",\"exit\":%d,\"insns\":%d,\"steps\":%llu,\"max_stack\":%d,\"max_depth\":%d,\"frame_bytes\":%d,\"calls\":%llu,\"ops\":{",
+            path, status, prog->ncode, (unsigned long long) st->steps, st->max_stack, st->max_depth, st->max_frame, (unsigned long long) st->calls);
+    for (int op = 0; op < OP_MAX; op++)
+        if (st->ops[op]) {
+            fprintf(fp, "%s\"%s\":%llu", sep, opcodes_info(op)->name, (unsigned long long) st->ops[op]);
+            sep = ",";
+        }
+    fprintf(fp, "},\"functions\":{");
+    sep = "";
+    for (int n = 0; n < nfuncs; n++) {
+        fprintf(fp, "%s\"%s\":%llu", sep, prog->names[funcs[n]], (unsigned long long) st->calls_to[funcs[n]]);
+        sep = ",";
+    }
+    for (int n = 0; n < VM_NATIVES; n++)
+        if (st->native_calls[n]) {
+            fprintf(fp, "%s\"%s\":%llu", sep, natives[n], (unsigned long long) st->native_calls[n]);
+            sep = ",";
+        }
+    fprintf(fp, "}}\n");
+    free(funcs);
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: svm [--stats] [--json=file] [--max-steps=n] [--mem=bytes] program.s|program.svmb\n"
+            "  --stats        Print the instruction counts, stack depth, frame memory and calls\n"
+            "                 to stderr\n"
+            "  --json=file    Write the same as one JSON object, - for stdout\n"
+            "  --max-steps=n  Stop with an error after n instructions\n"
+            "  --mem=bytes    Memory for the frames (default 1 MB)\n");
+    exit(255);
+}
+
+int main(int argc, char **argv) {
+    vm_prog_t prog = { 0 };
+    vm_stats_t stats = { 0 };
+    bool stats_dump = false;
+    char *json = NULL;
+    uint64_t max_steps = 0;
+    size_t frames = VM_MEM_DEFAULT;
+    int status;
+
+    for (argc--, argv++; argc && argv[0][0] == '-' && argv[0][1]; argc--, argv++) {
+        if (!strcmp(*argv, "--stats"))
+            stats_dump = true;
+        else if (!strncmp(*argv, "--json=", 7))
+            json = *argv + 7;
+        else if (!strncmp(*argv, "--max-steps=", 12))
+            max_steps = strtoull(*argv + 12, NULL, 10);
+        else if (!strncmp(*argv, "--mem=", 6) && atol(*argv + 6) > 0)
+            frames = atol(*argv + 6);
+        else
+            usage();
+    }
+    if (argc != 1)
+        usage();
+    path = argv[0];
+
+    vm_load(&prog, path);
+    mem_len = ((prog.data_len + 15) & ~(size_t) 15) + frames;
+    if (!(mem = calloc(mem_len, 1)) || !(stats.calls_to = calloc(prog.ncode + 1, sizeof(uint64_t))))
+        vm_error("out of memory");
+    if (prog.data_len)
+        memcpy(mem, prog.data, prog.data_len);
+
+    status = vm_run(&prog, &stats, max_steps);
+    fflush(stdout);
+
+    if (stats_dump)
+        vm_report(stderr, &prog, &stats, status);
+    if (json) {
+        FILE *fp = strcmp(json, "-") ? fopen(json, "w") : stdout;
+        if (!fp)
+            vm_error("can't write %s", json);
+        vm_json(fp, &prog, &stats, status);
+        if (fp != stdout)
+            fclose(fp);
+    }
+    vm_free(&prog);
+    free(stats.calls_to);
+    free(mem);
+    return status & 0xff;
+}